@@ -1,5 +1,20 @@
 #include <ply-build-repo/Module.h>
 
+static void generateConfigFile(ModuleArgs* args) {
+    if (args->projInst->env->isGenerating) {
+        String configFile = String::format(
+            R"(#pragma once
+#define FLAPGAME_REPO_FOLDER "{}"
+)",
+            fmt::EscapedString{
+                NativePath::join(PLY_WORKSPACE_FOLDER, "repos", args->targetInst->repo->repoName)});
+        FileSystem::native()->makeDirsAndSaveTextIfDifferent(
+            NativePath::join(args->projInst->env->buildFolderPath,
+                             "codegen/flapGame/flapGame/Config.h"),
+            configFile, TextFormat::platformPreference());
+    }
+}
+
 // [ply module="flapGame"]
 void module_flapGame(ModuleArgs* args) {
     args->addSourceFiles("flapGame", false);
@@ -16,18 +31,22 @@ void module_flapGame(ModuleArgs* args) {
     }
     args->addExtern(Visibility::Private, "assimp");
     args->addExtern(Visibility::Private, "soloud");
-    if (args->projInst->env->isGenerating) {
-        String configFile = String::format(
-            R"(#pragma once
-#define FLAPGAME_REPO_FOLDER "{}"
-)",
-            fmt::EscapedString{
-                NativePath::join(PLY_WORKSPACE_FOLDER, "repos", args->targetInst->repo->repoName)});
-        FileSystem::native()->makeDirsAndSaveTextIfDifferent(
-            NativePath::join(args->projInst->env->buildFolderPath,
-                             "codegen/flapGame/flapGame/Config.h"),
-            configFile, TextFormat::platformPreference());
-    }
+    generateConfigFile(args);
+}
+
+// Same game logic as flapGame, built with FLAPGAME_HEADLESS so that it doesn't depend on GL,
+// audio or image loading. Used to run the simulation on machines without a display.
+// [ply module="flapSim"]
+void module_flapSim(ModuleArgs* args) {
+    args->addSourceFiles("flapGame", false);
+    args->addIncludeDir(Visibility::Public, ".");
+    args->addIncludeDir(Visibility::Public,
+                        NativePath::join(args->projInst->env->buildFolderPath, "codegen/flapGame"));
+    args->addTarget(Visibility::Public, "runtime");
+    args->addTarget(Visibility::Public, "math");
+    args->setPreprocessorDefinition(Visibility::Public, "FLAPGAME_HEADLESS", "1");
+    args->addExtern(Visibility::Private, "assimp");
+    generateConfigFile(args);
 }
 
 // [ply extern="soloud" provider="source"]
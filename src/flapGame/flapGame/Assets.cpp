@@ -1,18 +1,22 @@
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/Assets.h>
 #include <assimp/Importer.hpp>  // C++ importer interface
 #include <assimp/scene.h>       // Output data structure
 #include <assimp/postprocess.h> // Post processing flags
 #include <ply-runtime/algorithm/Find.h>
 #include <flapGame/LoadPNG.h>
+#include <flapGame/GameState.h>
+#include <chrono>
 
 namespace flap {
 
 Owned<Assets> Assets::instance;
 
-StringView toStringView(const aiString& aiStr) {
-    return {aiStr.data, safeDemote<u32>(aiStr.length)};
-}
+// Defined in SimAssets.cpp
+StringView toStringView(const aiString& aiStr);
+void extractBirdAnimData(BirdAnimData* bad, const aiScene* scene);
+Array<FallAnimFrame> extractFallAnimation(const aiScene* scene, u32 numFrames);
 
 void applyAlphaChannel(image::Image& dst, image::Image& src) {
     PLY_ASSERT(dst.dims() == src.dims());
@@ -35,23 +39,6 @@ void applyAlphaChannel(image::Image& dst, image::Image& src) {
     }
 }
 
-void extractBones(Array<Bone>* resultBones, const aiNode* srcNode, s32 parentIdx = -1) {
-    for (u32 i = 0; i < srcNode->mNumChildren; i++) {
-        const aiNode* child = srcNode->mChildren[i];
-        u32 boneIdx = resultBones->numItems();
-        Bone& bone = resultBones->append();
-        bone.name = toStringView(child->mName);
-        bone.parentIdx = parentIdx;
-        bone.boneToParent = ((const Float4x4*) &child->mTransformation)->transposed();
-        if (parentIdx >= 0) {
-            bone.boneToModel = (*resultBones)[parentIdx].boneToModel * bone.boneToParent;
-        } else {
-            bone.boneToModel = bone.boneToParent;
-        }
-        extractBones(resultBones, child, boneIdx);
-    }
-}
-
 void insertSorted(VertexPNW2* vertex, u32 boneIndex, float weight) {
     if (weight >= vertex->blendWeights[0]) {
         vertex->blendIndices[1] = vertex->blendIndices[0];
@@ -98,7 +85,8 @@ Owned<DrawMesh> makeQuadDrawMesh() {
 }
 
 Owned<DrawMesh> toDrawMesh(MeshMap* mm, const aiScene* srcScene, const aiMesh* srcMesh,
-                           DrawMesh::VertexType vertexType, ArrayView<Bone> forSkel = {}) {
+                           DrawMesh::VertexType vertexType, ArrayView<Bone> forSkel = {},
+                           SkinPaletteLayout* palette = nullptr) {
     PLY_ASSERT(srcMesh->mMaterialIndex >= 0);
     const aiMaterial* srcMat = srcScene->mMaterials[srcMesh->mMaterialIndex];
     Owned<DrawMesh> out = new DrawMesh;
@@ -130,9 +118,10 @@ Owned<DrawMesh> toDrawMesh(MeshMap* mm, const aiScene* srcScene, const aiMesh* s
         }
         out->vbo = GLBuffer::create(vertices.stringView());
     } else if (vertexType == DrawMesh::VertexType::Skinned) {
-        // Skinned vertices
+        // Skinned vertices. Blend indices refer to slots in the palette shared by every mesh
+        // skinned to forSkel.
         PLY_ASSERT(!forSkel.isEmpty());
-        out->bones.resize(srcMesh->mNumBones);
+        PLY_ASSERT(palette);
         Array<VertexPNW2> vertices;
         vertices.resize(srcMesh->mNumVertices); // all members zero initialized
         for (u32 j = 0; j < srcMesh->mNumVertices; j++) {
@@ -145,23 +134,25 @@ Owned<DrawMesh> toDrawMesh(MeshMap* mm, const aiScene* srcScene, const aiMesh* s
             u32 bi = safeDemote<u32>(find(forSkel, [&](const Bone& bone) {
                 return bone.name == toStringView(meshBone->mName);
             }));
+            Float4x4 baseModelToBone = ((Float4x4*) &meshBone->mOffsetMatrix)->transposed() *
+                                       AxisRot{Axis3::XPos, Axis3::ZPos, Axis3::YNeg}.toFloat4x4() *
+                                       Float4x4::makeScale(0.01f);
+            u32 slot = palette->addSlot(bi, baseModelToBone);
             for (u32 wi = 0; wi < meshBone->mNumWeights; wi++) {
                 const aiVertexWeight& srcVertexWeight = meshBone->mWeights[wi];
                 PLY_ASSERT(srcVertexWeight.mWeight >= 0);
                 VertexPNW2& vertex = vertices[srcVertexWeight.mVertexId];
-                insertSorted(&vertex, mb, srcVertexWeight.mWeight);
+                insertSorted(&vertex, slot, srcVertexWeight.mWeight);
             }
-            out->bones[mb].baseModelToBone =
-                ((Float4x4*) &meshBone->mOffsetMatrix)->transposed() *
-                AxisRot{Axis3::XPos, Axis3::ZPos, Axis3::YNeg}.toFloat4x4() *
-                Float4x4::makeScale(0.01f);
-            out->bones[mb].indexInSkel = bi;
         }
         if (srcMesh->mNumBones == 0) {
             // Force at least one bone to exist. This is needed when loading SickBird's eyes using
             // Assimp 4.1.0. In other Assimp versions, mNumBones is always > 0.
-            out->bones.append();
-            out->bones[0].baseModelToBone = forSkel[0].boneToModel.invertedOrtho();
+            u32 slot = palette->addSlot(0, forSkel[0].boneToModel.invertedOrtho());
+            for (VertexPNW2& vertex : vertices) {
+                vertex.blendIndices[0] = (u16) slot;
+                vertex.blendIndices[1] = (u16) slot;
+            }
         }
         // Normalize weights
         for (VertexPNW2& vertex : vertices) {
@@ -220,7 +211,8 @@ Owned<DrawMesh> toDrawMesh(MeshMap* mm, const aiScene* srcScene, const aiMesh* s
 
 Array<Owned<DrawMesh>> getMeshes(MeshMap* mm, const aiScene* srcScene, const aiNode* srcNode,
                                  DrawMesh::VertexType vertexType, ArrayView<Bone> forSkel = {},
-                                 LambdaView<bool(StringView matName)> filter = {}) {
+                                 LambdaView<bool(StringView matName)> filter = {},
+                                 SkinPaletteLayout* palette = nullptr) {
     Array<Owned<DrawMesh>> result;
     for (u32 m = 0; m < srcNode->mNumMeshes; m++) {
         const aiMesh* srcMesh = srcScene->mMeshes[srcNode->mMeshes[m]];
@@ -234,157 +226,16 @@ Array<Owned<DrawMesh>> getMeshes(MeshMap* mm, const aiScene* srcScene, const aiN
             doAppend = filter(toStringView(matName));
         }
         if (doAppend) {
-            result.append(toDrawMesh(mm, srcScene, srcMesh, vertexType, forSkel));
+            result.append(toDrawMesh(mm, srcScene, srcMesh, vertexType, forSkel, palette));
         }
     }
     for (u32 c = 0; c < srcNode->mNumChildren; c++) {
-        result.extend(getMeshes(mm, srcScene, srcNode->mChildren[c], vertexType, forSkel, filter));
-    }
-    return result;
-}
-
-Quaternion toQuat(const aiQuaternion& q) {
-    return {q.x, q.y, q.z, q.w};
-}
-
-template <typename T, typename Convert>
-auto sampleFromKeys(ArrayView<const T> keys, float time, const Convert& convert) {
-    PLY_ASSERT(keys.numItems > 0);
-    u32 i = 0;
-    for (; i < keys.numItems; i++) {
-        if (keys[i].mTime > time)
-            break;
-    }
-    if (i == 0) {
-        return convert(keys[i].mValue);
-    } else if (i >= keys.numItems) {
-        return convert(keys.back().mValue);
-    } else {
-        const T& k0 = keys[i - 1];
-        const T& k1 = keys[i];
-        float f = unmix((float) k0.mTime, (float) k1.mTime, time);
-        return mix(convert(k0.mValue), convert(k1.mValue), f);
-    }
-}
-
-QuatPosScale sampleAnimCurve(const aiNodeAnim* channel, float time) {
-    QuatPosScale result;
-    result.quat = sampleFromKeys<aiQuatKey>({channel->mRotationKeys, channel->mNumRotationKeys},
-                                            time, toQuat);
-    result.pos = sampleFromKeys<aiVectorKey>({channel->mPositionKeys, channel->mNumPositionKeys},
-                                             time, [](const aiVector3D& v) {
-                                                 return Float3{v.x, v.y, v.z};
-                                             });
-    result.scale = sampleFromKeys<aiVectorKey>({channel->mScalingKeys, channel->mNumScalingKeys},
-                                               time, [](const aiVector3D& v) {
-                                                   return Float3{v.x, v.y, v.z};
-                                               });
-    return result;
-}
-
-Array<Float4x4> sampleAnimationToPose(ArrayView<const Bone> skel,
-                                      const aiAnimation* srcAnim = nullptr, float time = 0) {
-    Array<Float4x4> poseBoneToParent;
-    poseBoneToParent.resize(skel.numItems);
-    for (u32 i = 0; i < skel.numItems; i++) {
-        poseBoneToParent[i] = skel[i].boneToParent;
-    }
-    for (u32 c = 0; c < srcAnim->mNumChannels; c++) {
-        const aiNodeAnim* srcChannel = srcAnim->mChannels[c];
-        s32 bi = find(skel, [&](const Bone& bone) {
-            return bone.name == toStringView(srcChannel->mNodeName);
-        });
-        if (bi >= 0) {
-            poseBoneToParent[bi] = sampleAnimCurve(srcChannel, time).toFloat4x4();
-        }
-    }
-    return poseBoneToParent;
-}
-
-Array<PoseBone> extractPose(ArrayView<const Bone> skel, const aiAnimation* srcAnim, float srcTime,
-                            const std::initializer_list<StringView>& boneNames) {
-    Array<Float4x4> poseBoneToParent = sampleAnimationToPose(skel, srcAnim, srcTime);
-    Array<PoseBone> result;
-    for (StringView boneName : boneNames) {
-        u32 bi =
-            safeDemote<u32>(find(skel, [&](const Bone& bone) { return bone.name == boneName; }));
-        const Bone& bone = skel[bi];
-        Float4x4 delta = poseBoneToParent[bi].invertedOrtho() * bone.boneToParent;
-        float zAngle = atan2f(delta[1].x, delta[0].x);
-        result.append(bi, zAngle);
+        result.extend(getMeshes(mm, srcScene, srcNode->mChildren[c], vertexType, forSkel, filter,
+                                palette));
     }
     return result;
 }
 
-void extractBirdAnimData(BirdAnimData* bad, const aiScene* scene) {
-    const aiNode* basePoseFromNode = scene->mRootNode->FindNode("Body");
-    PLY_ASSERT(basePoseFromNode->mNumMeshes > 0);
-    PLY_UNUSED(basePoseFromNode);
-    extractBones(&bad->birdSkel, scene->mRootNode->FindNode("BirdSkel"));
-    PLY_ASSERT(scene->mNumAnimations == 1);
-    bad->loWingPose = extractPose(bad->birdSkel, scene->mAnimations[0], 0,
-                                  {"W0_L", "W1_L", "W2_L", "W0_R", "W1_R", "W2_R"});
-    bad->hiWingPose = extractPose(bad->birdSkel, scene->mAnimations[0], 8,
-                                  {"W0_L", "W1_L", "W2_L", "W0_R", "W1_R", "W2_R"});
-    bad->eyePoses[0] =
-        extractPose(bad->birdSkel, scene->mAnimations[0], 0, {"Pupil_L", "Pupil_R"});
-    bad->eyePoses[1] =
-        extractPose(bad->birdSkel, scene->mAnimations[0], 8, {"Pupil_L", "Pupil_R"});
-    bad->eyePoses[2] =
-        extractPose(bad->birdSkel, scene->mAnimations[0], 16, {"Pupil_L", "Pupil_R"});
-    bad->eyePoses[3] =
-        extractPose(bad->birdSkel, scene->mAnimations[0], 24, {"Pupil_L", "Pupil_R"});
-    for (u32 i = 0; i < 5; i++) {
-        TongueBone& tongueBone = bad->tongueBones.append();
-        String boneName = String::format("T{}", i);
-        tongueBone.boneIndex = safeDemote<u32>(
-            find(bad->birdSkel, [&](const Bone& bone) { return bone.name == boneName; }));
-        if (i > 0) {
-            const Bone& parentBone = bad->birdSkel[bad->tongueBones[i - 1].boneIndex];
-            const Bone& curBone = bad->birdSkel[tongueBone.boneIndex];
-            bad->tongueBones[i - 1].length = curBone.boneToParent[3].asFloat3().length();
-            bad->tongueBones[i - 1].midPoint =
-                (parentBone.boneToModel * Float4{curBone.boneToParent[3].asFloat3() * 0.5f, 1.f})
-                    .asFloat3();
-        }
-    }
-    bad->tongueBones.pop();
-    bad->tongueRootRot =
-        Quaternion::fromOrtho(bad->birdSkel[bad->tongueBones[0].boneIndex].boneToModel);
-}
-
-Array<FallAnimFrame> extractFallAnimation(const aiScene* scene, u32 numFrames) {
-    auto findChannel = [&](StringView name) -> const aiNodeAnim* {
-        PLY_ASSERT(scene->mNumAnimations == 1);
-        const aiAnimation* srcAnim = scene->mAnimations[0];
-        ArrayView<const aiNodeAnim* const> channels = {srcAnim->mChannels, srcAnim->mNumChannels};
-        s32 index = find(channels,
-                         [&](const aiNodeAnim* ch) { return toStringView(ch->mNodeName) == name; });
-        PLY_ASSERT(index >= 0);
-        return channels[safeDemote<u32>(index)];
-    };
-    const aiNodeAnim* gravChan = findChannel("GravityAndAngle");
-    const aiNodeAnim* recoilChan = findChannel("Recoil");
-    const aiNodeAnim* birdChan = findChannel("Bird");
-
-    Array<FallAnimFrame> frames;
-    frames.reserve(numFrames);
-    float angle = 0.f;
-    for (u32 i = 0; i < numFrames; i++) {
-        FallAnimFrame& frame = frames.append();
-        frame.verticalDrop = sampleAnimCurve(gravChan, (float) i).pos.z / -100.f;
-        frame.recoilDistance = sampleAnimCurve(recoilChan, (float) i).pos.x;
-        Quaternion quat = sampleAnimCurve(birdChan, (float) i).quat;
-        // Expect a z axis rotation:
-        PLY_ASSERT(cross(quat.asFloat3(), {0, 0, 1}).length2() < 1e-6f);
-        float srcAngle = atan2(quat.z, quat.w) * 2.f;
-        float delta = wrap(srcAngle - angle + Pi, 2 * Pi) - Pi;
-        angle += delta;
-        frame.rotationAngle = angle;
-    }
-    return frames;
-}
-
 struct GroupMeshes {
     StringView name;
     ArrayView<const DrawMesh> drawMeshes;
@@ -410,11 +261,46 @@ DrawGroup loadDrawGroup(const aiScene* srcScene, const aiNode* srcNode, const Me
     return dg;
 }
 
-void Assets::load(StringView assetsPath) {
+InstancedDrawGroup InstancedDrawGroup::create(const DrawGroup& group, s32 minRepeat,
+                                              s32 maxRepeat, float repeatSpacing) {
+    InstancedDrawGroup idg;
+    Array<Float4x4> xforms;
+    for (u32 i = 0; i < group.instances.numItems(); i++) {
+        const DrawMesh* drawMesh = group.instances[i].drawMesh;
+        bool seen = false;
+        for (const Batch& batch : idg.batches) {
+            seen = seen || (batch.drawMesh == drawMesh);
+        }
+        if (seen)
+            continue;
+
+        // Add every instance of this mesh, in every repeat of the group
+        Batch& batch = idg.batches.append();
+        batch.drawMesh = drawMesh;
+        batch.firstInstance = xforms.numItems();
+        for (s32 r = minRepeat; r <= maxRepeat; r++) {
+            Float3 groupPos = group.groupRelWorld + Float3{repeatSpacing * r, 0, 0};
+            for (u32 j = i; j < group.instances.numItems(); j++) {
+                if (group.instances[j].drawMesh == drawMesh) {
+                    xforms.append(Float4x4::makeTranslation(groupPos) *
+                                  Float4x4::makeScale(group.groupScale) *
+                                  group.instances[j].itemToGroup);
+                }
+            }
+        }
+        batch.numInstances = xforms.numItems() - batch.firstInstance;
+    }
+    idg.instanceXforms = GLBuffer::create(xforms.stringView());
+    return idg;
+}
+
+void Assets::load(StringView assetsPath, StringView cachePath) {
     PLY_ASSERT(FileSystem::native()->exists(assetsPath) == ExistsResult::Directory);
     Assets* assets = new Assets;
     assets->rootPath = assetsPath;
+    assets->cachePath = cachePath;
     Assets::instance = assets;
+    SimAssets::instance = assets;
     using VT = DrawMesh::VertexType;
     {
         Assimp::Importer importer;
@@ -425,11 +311,14 @@ void Assets::load(StringView assetsPath) {
         auto getMaterial = [&](const aiNode* src, Array<Owned<MeshWithMaterial>>& dst,
                                StringView materialName, VT vt) -> UberShader::Props* {
             ArrayView<Bone> bones;
+            SkinPaletteLayout* palette = nullptr;
             if (vt == VT::Skinned) {
                 bones = assets->bad.birdSkel;
+                palette = &assets->birdSkinLayout;
             }
             Array<Owned<DrawMesh>> meshes = getMeshes(
-                nullptr, scene, src, vt, bones, [&](StringView m) { return materialName == m; });
+                nullptr, scene, src, vt, bones, [&](StringView m) { return materialName == m; },
+                palette);
             PLY_ASSERT(meshes.numItems() == 1);
             Owned<MeshWithMaterial> mm = new MeshWithMaterial;
             UberShader::Props* props = &mm->matProps;
@@ -605,6 +494,15 @@ void Assets::load(StringView assetsPath) {
         assets->shrubGroup = loadDrawGroup(scene, scene->mRootNode->FindNode("ShrubGroup"), &mm);
         assets->cloudGroup = loadDrawGroup(scene, scene->mRootNode->FindNode("CloudGroup"), &mm);
         assets->cityGroup = loadDrawGroup(scene, scene->mRootNode->FindNode("CityGroup"), &mm);
+        assets->shrubGroupScale = assets->shrubGroup.groupScale;
+        assets->cityGroupScale = assets->cityGroup.groupScale;
+        // Same repeats as drawn by renderGamePanel before instancing
+        assets->shrubInstances =
+            InstancedDrawGroup::create(assets->shrubGroup, -1, 1,
+                                       GameState::ShrubRepeat * assets->shrubGroup.groupScale);
+        assets->cityInstances =
+            InstancedDrawGroup::create(assets->cityGroup, -3, 3,
+                                       GameState::BuildingRepeat * assets->cityGroup.groupScale);
     }
     {
         Assimp::Importer importer;
@@ -814,17 +712,29 @@ void Assets::load(StringView assetsPath) {
     assets->sdfCommon = SDFCommon::create();
     assets->sdfOutline = SDFOutline::create();
     {
+        auto startTime = std::chrono::steady_clock::now();
         String ttfBuffer = FileSystem::native()->loadBinary(
             NativePath::join(assetsPath, "poppins-bold-694-webfont.ttf"));
         PLY_ASSERT(FileSystem::native()->lastResult() == FSResult::OK);
-        assets->sdfFont = SDFFont::bake(ttfBuffer, 48.f);
+        if (cachePath) {
+            assets->sdfFont =
+                SDFFont::loadOrBake(ttfBuffer, 48.f, NativePath::join(cachePath, "sdfFont.bin"),
+                                    &assets->fontLoadInfo);
+        } else {
+            assets->sdfFont = SDFFont::bake(ttfBuffer, 48.f);
+        }
+        std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - startTime;
+        assets->fontLoadSeconds = loadTime.count();
     }
 
     // Load shaders
     assets->matShader = MaterialShader::create();
     assets->texMatShader = TexturedMaterialShader::create();
     assets->duotoneShader = UberShader::create(UberShader::Flags::Duotone);
+    assets->duotoneInstancedShader =
+        UberShader::create(UberShader::Flags::Duotone | UberShader::Flags::Instanced);
     assets->pipeShader = PipeShader::create();
+    assets->pipeInstancedShader = PipeShader::create(true);
     assets->skinnedShader = UberShader::create(UberShader::Flags::Skinned);
     assets->flatShader = FlatShader::create();
     assets->starShader = StarShader::create();
@@ -833,11 +743,88 @@ void Assets::load(StringView assetsPath) {
     assets->texturedShader = TexturedShader::create();
     assets->hypnoShader = HypnoShader::create();
     assets->copyShader = CopyShader::create();
+    assets->layerShader = LayerShader::create();
     assets->gradientShader = GradientShader::create();
     assets->puffShader = PuffShader::create();
     assets->shapeShader = ShapeShader::create();
     assets->colorCorrectShader = ColorCorrectShader::create();
 
+    // Create uniform buffers for the camera and for materials that don't change
+    assets->cameraUniforms.init();
+    CameraUniforms::instance = &assets->cameraUniforms;
+    assets->birdSkinLayout.numSkelBones = assets->bad.birdSkel.numItems();
+    {
+        Float3 skyColor = fromSRGB(Float3{80 / 255.f, 203 / 255.f, 1});
+        UberShader::Props* props = &assets->dirtProps;
+        props->diffuse = {1.1f, 0.9f, 0.2f};
+        props->diffuse2 = {0.08f, 0.02f, 0};
+        props->texID = assets->gradientTexture.id;
+
+        props = &assets->shrubProps;
+        props->lightDir = Float3{1, -1, 0}.normalized();
+        props->diffuse = mix(Float3{0.065f, 0.99f, 0.1f} * 1.f, skyColor, 0.04f);
+        props->diffuse2 = mix(Float3{0.065f, 0.99f, 0.1f} * 0.5f, skyColor, 0.05f);
+        props->diffuseClamp = {0.28f, 1.1f, 0.28f};
+        props->specLightDir = Float3{1, -1, 0.2f}.normalized();
+        props->specular = Float3{0.7f, 1, 0} * 0.07f;
+        props->specPower = 4.f;
+        props->rim = {mix(Float3{1, 1, 1}, skyColor, 0.3f) * 0.1f, 1.f};
+        props->rimFactor = {1.6f, 4.5f};
+
+        props = &assets->cityProps;
+        props->diffuse = Float3{0.95f, 1.15f, 0.35f} * 2.2f;
+        props->diffuse2 = Float3{0.2f, 1.f, 1.f} * 2.f;
+        props->diffuseClamp = {-1.f, 1.f, 0.4f};
+        props->rim = {Float3{0.f, 1.f, 1.f} * 0.7f, 0.3f};
+        props->rimFactor = {2.f, 2.f};
+        props->specular = {0, 0, 0};
+        props->texID = assets->windowTexture.id;
+
+        for (UberShader::Props* p : {&assets->dirtProps, &assets->shrubProps, &assets->cityProps}) {
+            assets->propsUBOs.append(UberShader::createPropsUBO(p));
+        }
+        for (Array<Owned<MeshWithMaterial>>* mms : {&assets->birdMeshes, &assets->sickBirdMeshes}) {
+            for (MeshWithMaterial* mm : *mms) {
+                assets->propsUBOs.append(UberShader::createPropsUBO(&mm->matProps));
+            }
+        }
+    }
+
+    // Build VAOs for the mesh/shader pairs drawn by renderGamePanel. Other draws set up their
+    // vertex attributes each time.
+    {
+        GLint defaultVAO = 0;
+        GL_CHECK(GetIntegerv(GL_VERTEX_ARRAY_BINDING, &defaultVAO));
+        GLVertexArray::defaultID = (GLuint) defaultVAO;
+        for (const Array<Owned<MeshWithMaterial>>* mms :
+             {&assets->birdMeshes, &assets->sickBirdMeshes}) {
+            for (const MeshWithMaterial* mm : *mms) {
+                buildVAO(assets->skinnedShader.get(), &mm->mesh);
+            }
+        }
+        for (const DrawMesh* dm : assets->eyeWhite) {
+            buildVAO(assets->pipeShader.get(), dm);
+        }
+        for (const DrawMesh* dm : assets->pipe) {
+            buildVAO(assets->pipeShader.get(), dm);
+            buildVAO(assets->pipeInstancedShader.get(), dm);
+        }
+        for (const DrawMesh* dm : assets->floorStripe) {
+            buildVAO(assets->texMatShader.get(), dm);
+        }
+        for (const DrawMesh* dm : assets->floor) {
+            buildVAO(assets->matShader.get(), dm);
+        }
+        for (const DrawMesh* dm : assets->dirt) {
+            buildVAO(assets->duotoneShader.get(), dm);
+        }
+        for (const InstancedDrawGroup* idg : {&assets->shrubInstances, &assets->cityInstances}) {
+            for (const InstancedDrawGroup::Batch& batch : idg->batches) {
+                buildVAO(assets->duotoneInstancedShader.get(), batch.drawMesh);
+            }
+        }
+    }
+
     // Load sounds
     assets->titleMusic.load(
         NativePath::join(assetsPath, "FlapHero.ogg").withNullTerminator().bytes);
@@ -873,3 +860,5 @@ void Assets::load(StringView assetsPath) {
 }
 
 } // namespace flap
+
+#endif // !FLAPGAME_HEADLESS
@@ -1,5 +1,7 @@
 #pragma once
 #include <flapGame/Core.h>
+#include <flapGame/SimAssets.h>
+#include <flapGame/Audio.h>
 #include <flapGame/GLHelpers.h>
 #include <flapGame/Text.h>
 #include <flapGame/Shaders.h>
@@ -8,39 +10,6 @@
 
 namespace flap {
 
-struct Bone {
-    String name;
-    s32 parentIdx = -1;
-    Float4x4 boneToParent = Float4x4::identity();
-    Float4x4 boneToModel = Float4x4::identity();
-};
-
-struct PoseBone {
-    u32 boneIndex = 0;
-    float zAngle = 0;
-};
-
-struct TongueBone {
-    u32 boneIndex = 0;
-    Float3 midPoint = {0, 0, 0};
-    float length = 0;
-};
-
-struct BirdAnimData {
-    Array<Bone> birdSkel;
-    Array<PoseBone> loWingPose;
-    Array<PoseBone> hiWingPose;
-    Array<PoseBone> eyePoses[4];
-    Quaternion tongueRootRot = {0, 0, 0, 1};
-    Array<TongueBone> tongueBones;
-};
-
-struct FallAnimFrame {
-    float verticalDrop = 0;
-    float recoilDistance = 0;
-    float rotationAngle = 0;
-};
-
 struct DrawGroup {
     struct Instance {
         Float4x4 itemToGroup = Float4x4::identity();
@@ -52,8 +21,29 @@ struct DrawGroup {
     float groupScale = 0.f;
 };
 
-struct Assets {
+// A DrawGroup repeated along the X axis, with every instance transform stored in one GL buffer so
+// that each distinct mesh is drawn with a single instanced call. Transforms are relative to the
+// group's scroll offset (GameState::shrubX or buildingX), which is applied at draw time, so the
+// buffer is built once at load time and doesn't change as the offset scrolls and wraps.
+struct InstancedDrawGroup {
+    struct Batch {
+        const DrawMesh* drawMesh = nullptr;
+        u32 firstInstance = 0;
+        u32 numInstances = 0;
+    };
+
+    GLBuffer instanceXforms; // Float4x4 item-to-group transforms, grouped by mesh
+    Array<Batch> batches;
+
+    static InstancedDrawGroup create(const DrawGroup& group, s32 minRepeat, s32 maxRepeat,
+                                     float repeatSpacing);
+};
+
+struct Assets : SimAssets {
     String rootPath;
+    String cachePath; // Where baked data is cached between runs. Not cached if empty.
+    SDFFont::LoadInfo fontLoadInfo;
+    double fontLoadSeconds = 0;
 
     struct MeshWithMaterial {
         DrawMesh mesh;
@@ -62,6 +52,7 @@ struct Assets {
 
     Array<Owned<MeshWithMaterial>> birdMeshes;
     Array<Owned<MeshWithMaterial>> sickBirdMeshes;
+    SkinPaletteLayout birdSkinLayout; // Shared by birdMeshes and sickBirdMeshes
     Array<Owned<DrawMesh>> eyeWhite;
     Array<Owned<DrawMesh>> floor;
     Array<Owned<DrawMesh>> floorStripe;
@@ -84,9 +75,8 @@ struct Assets {
     DrawGroup shrubGroup;
     DrawGroup cloudGroup;
     DrawGroup cityGroup;
-
-    BirdAnimData bad;
-    Array<FallAnimFrame> fallAnim;
+    InstancedDrawGroup shrubInstances;
+    InstancedDrawGroup cityInstances;
 
     Texture flashTexture;
     Texture speedLimitTexture;
@@ -114,7 +104,9 @@ struct Assets {
     Owned<MaterialShader> matShader;
     Owned<TexturedMaterialShader> texMatShader;
     Owned<UberShader> duotoneShader;
+    Owned<UberShader> duotoneInstancedShader;
     Owned<PipeShader> pipeShader;
+    Owned<PipeShader> pipeInstancedShader;
     Owned<UberShader> skinnedShader;
     Owned<FlatShader> flatShader;
     Owned<StarShader> starShader;
@@ -123,19 +115,27 @@ struct Assets {
     Owned<TexturedShader> texturedShader;
     Owned<HypnoShader> hypnoShader;
     Owned<CopyShader> copyShader;
+    Owned<LayerShader> layerShader;
     Owned<GradientShader> gradientShader;
     Owned<PuffShader> puffShader;
     Owned<ShapeShader> shapeShader;
     Owned<ColorCorrectShader> colorCorrectShader;
 
+    // Uniform buffers
+    CameraUniforms cameraUniforms;
+    UberShader::Props dirtProps;
+    UberShader::Props shrubProps; // texID is set per mesh at draw time
+    UberShader::Props cityProps;
+    Array<GLBuffer> propsUBOs; // Owns the buffers referenced by Props::ubo
+
     // Sounds
     SoLoud::Wav titleMusic;
     SoLoud::Wav transitionSound;
     SoLoud::Wav swipeSound;
-    FixedArray<SoLoud::Wav, 4> passNotes;
+    FixedArray<SoLoud::Wav, NumPassNotes> passNotes;
     SoLoud::Wav finalScoreSound;
     SoLoud::Wav playerHitSound;
-    FixedArray<SoLoud::Wav, 2> flapSounds;
+    FixedArray<SoLoud::Wav, NumFlapSounds> flapSounds;
     SoLoud::Wav bounceSound;
     SoLoud::Wav enterPipeSound;
     SoLoud::Wav exitPipeSound;
@@ -146,7 +146,7 @@ struct Assets {
 
     static Owned<Assets> instance;
 
-    static void load(StringView assetsPath);
+    static void load(StringView assetsPath, StringView cachePath = {});
 };
 
 } // namespace flap
@@ -0,0 +1,71 @@
+#include <flapGame/Core.h>
+#include <flapGame/Audio.h>
+#if !FLAPGAME_HEADLESS
+#include <flapGame/Assets.h>
+#endif
+
+namespace flap {
+
+#if FLAPGAME_HEADLESS
+
+Voice playSound(Sound, float, u32) {
+    return 0;
+}
+
+void setVoiceSpeed(Voice, float) {
+}
+
+void fadeVoice(Voice, float, float) {
+}
+
+#else // !FLAPGAME_HEADLESS
+
+extern SoLoud::Soloud gSoLoud; // SoLoud engine
+
+SoLoud::Wav& getWav(Sound sound, u32 variant) {
+    Assets* a = Assets::instance;
+    switch (sound) {
+        case Sound::Transition:
+            return a->transitionSound;
+        case Sound::PassNote:
+            return a->passNotes[variant];
+        case Sound::FinalScore:
+            return a->finalScoreSound;
+        case Sound::PlayerHit:
+            return a->playerHitSound;
+        case Sound::Flap:
+            return a->flapSounds[variant];
+        case Sound::Bounce:
+            return a->bounceSound;
+        case Sound::EnterPipe:
+            return a->enterPipeSound;
+        case Sound::ExitPipe:
+            return a->exitPipeSound;
+        case Sound::ButtonUp:
+            return a->buttonUpSound;
+        case Sound::ButtonDown:
+            return a->buttonDownSound;
+        case Sound::Wobble:
+            return a->wobbleSound;
+        case Sound::Fall:
+            return a->fallSound;
+    }
+    PLY_ASSERT(0);
+    return a->bounceSound;
+}
+
+Voice playSound(Sound sound, float volume, u32 variant) {
+    return gSoLoud.play(getWav(sound, variant), volume);
+}
+
+void setVoiceSpeed(Voice voice, float relativeSpeed) {
+    gSoLoud.setRelativePlaySpeed(voice, relativeSpeed);
+}
+
+void fadeVoice(Voice voice, float toVolume, float time) {
+    gSoLoud.fadeVolume(voice, toVolume, time);
+}
+
+#endif // !FLAPGAME_HEADLESS
+
+} // namespace flap
@@ -0,0 +1,35 @@
+#pragma once
+#include <flapGame/Core.h>
+
+namespace flap {
+
+// Sounds triggered by the game logic. Game logic refers to sounds by ID instead of using SoLoud
+// directly, so that it can be built without audio. When FLAPGAME_HEADLESS is set, the functions
+// below do nothing.
+enum class Sound {
+    Transition,
+    PassNote,
+    FinalScore,
+    PlayerHit,
+    Flap,
+    Bounce,
+    EnterPipe,
+    ExitPipe,
+    ButtonUp,
+    ButtonDown,
+    Wobble,
+    Fall,
+};
+
+constexpr u32 NumPassNotes = 4;
+constexpr u32 NumFlapSounds = 2;
+
+// Same as SoLoud::handle
+using Voice = unsigned int;
+
+// variant selects one of the pass notes or flap sounds
+Voice playSound(Sound sound, float volume = -1.f, u32 variant = 0);
+void setVoiceSpeed(Voice voice, float relativeSpeed);
+void fadeVoice(Voice voice, float toVolume, float time);
+
+} // namespace flap
@@ -0,0 +1,134 @@
+#include <flapGame/Core.h>
+#include <flapGame/BirdBatch.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAPGAME_BIRDBATCH_SSE2 1
+#include <emmintrin.h>
+#else
+#define FLAPGAME_BIRDBATCH_SSE2 0
+#endif
+
+namespace flap {
+
+void BirdBatch::resize(u32 numBirds) {
+    this->posX.resize(numBirds);
+    this->posY.resize(numBirds);
+    this->posZ.resize(numBirds);
+    this->zVel.resize(numBirds);
+    this->curGravity.resize(numBirds);
+    this->gravApproach.resize(numBirds);
+    this->angle.resize(numBirds);
+    this->timeScale.resize(numBirds);
+}
+
+void BirdBatch::setBird(u32 index, const GameState* gs) {
+    auto playing = gs->mode.playing();
+    PLY_ASSERT(playing);
+    this->posX[index] = gs->bird.pos[0].x;
+    this->posY[index] = gs->bird.pos[0].y;
+    this->posZ[index] = gs->bird.pos[0].z;
+    this->zVel[index] = playing->zVel[0];
+    this->curGravity[index] = playing->curGravity;
+    this->gravApproach[index] = playing->gravApproach;
+    this->angle[index] = gs->rotator.angle() ? gs->rotator.angle()->angle : 0.f;
+    this->timeScale[index] = 1.f;
+}
+
+static PLY_INLINE void stepOneBird(BirdBatch* batch, u32 i, float dt) {
+    float dtScaled = dt * batch->timeScale[i];
+    float curGravity = stepGravity(batch->curGravity[i], batch->gravApproach[i], dtScaled);
+    float zVel0 = batch->zVel[i];
+    float zVel1 = stepZVel(zVel0, curGravity, dtScaled);
+    Float3 pos1 = stepBirdPos({batch->posX[i], batch->posY[i], batch->posZ[i]}, zVel0, zVel1,
+                              dtScaled);
+    batch->posX[i] = pos1.x;
+    batch->posY[i] = pos1.y;
+    batch->posZ[i] = pos1.z;
+    batch->zVel[i] = zVel1;
+    batch->curGravity[i] = curGravity;
+    batch->angle[i] = stepBirdAngle(batch->angle[i], zVel1, curGravity, dt);
+}
+
+void BirdBatch::stepScalar(float dt) {
+    for (u32 i = 0; i < this->numBirds(); i++) {
+        stepOneBird(this, i, dt);
+    }
+}
+
+#if FLAPGAME_BIRDBATCH_SSE2
+// Returns mask ? a : b
+static PLY_INLINE __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static PLY_INLINE __m128 getTargetAngle4(__m128 zVel) {
+    __m128 targetAngle = _mm_set1_ps((float) (-0.1 * Pi));
+    __m128 clamped = _mm_min_ps(_mm_max_ps(zVel, _mm_set1_ps(-15.f)), _mm_set1_ps(15.f));
+    __m128 negClamped = _mm_xor_ps(clamped, _mm_set1_ps(-0.f));
+    targetAngle = _mm_add_ps(targetAngle, _mm_mul_ps(negClamped, _mm_set1_ps(0.01f)));
+    __m128 excess = _mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(_mm_set1_ps(-15.f), zVel));
+    __m128 extra = _mm_min_ps(_mm_mul_ps(excess, _mm_set1_ps(0.04f)), _mm_set1_ps(0.55f * Pi));
+    return select(_mm_cmpgt_ps(excess, _mm_setzero_ps()), _mm_add_ps(targetAngle, extra),
+                  targetAngle);
+}
+#endif
+
+void BirdBatch::step(float dt) {
+    u32 i = 0;
+#if FLAPGAME_BIRDBATCH_SSE2
+    __m128 vDT = _mm_set1_ps(dt);
+    __m128 vNormalGravity = _mm_set1_ps(GameState::NormalGravity);
+    __m128 vOne = _mm_set1_ps(1.f);
+    __m128 vNegOne = _mm_set1_ps(-1.f);
+    u32 numBirds4 = this->numBirds() & ~3u;
+    for (; i < numBirds4; i += 4) {
+        __m128 dtScaled = _mm_mul_ps(vDT, _mm_loadu_ps(&this->timeScale[i]));
+
+        // stepGravity
+        __m128 curGravity = _mm_loadu_ps(&this->curGravity[i]);
+        __m128 gravStep = _mm_mul_ps(dtScaled, _mm_loadu_ps(&this->gravApproach[i]));
+        curGravity = select(_mm_cmpgt_ps(vNormalGravity, curGravity),
+                            _mm_min_ps(_mm_add_ps(curGravity, gravStep), vNormalGravity),
+                            _mm_max_ps(_mm_sub_ps(curGravity, gravStep), vNormalGravity));
+
+        // stepZVel
+        __m128 zVel0 = _mm_loadu_ps(&this->zVel[i]);
+        __m128 zVel1 = _mm_max_ps(_mm_sub_ps(zVel0, _mm_mul_ps(curGravity, dtScaled)),
+                                  _mm_set1_ps(GameState::TerminalVelocity));
+
+        // stepBirdPos
+        __m128 midZ = _mm_mul_ps(_mm_add_ps(zVel0, zVel1), _mm_set1_ps(0.5f));
+        __m128 posX = _mm_add_ps(_mm_loadu_ps(&this->posX[i]),
+                                 _mm_mul_ps(_mm_set1_ps(GameState::ScrollRate), dtScaled));
+        __m128 posY =
+            _mm_add_ps(_mm_loadu_ps(&this->posY[i]), _mm_mul_ps(_mm_setzero_ps(), dtScaled));
+        __m128 posZ =
+            _mm_min_ps(_mm_add_ps(_mm_loadu_ps(&this->posZ[i]), _mm_mul_ps(midZ, dtScaled)),
+                       _mm_set1_ps(22.f));
+
+        // stepBirdAngle
+        __m128 useZ = _mm_mul_ps(
+            zVel1, _mm_add_ps(vOne, _mm_mul_ps(_mm_sub_ps(vNormalGravity, curGravity),
+                                               _mm_set1_ps(0.012f))));
+        __m128 angle = _mm_loadu_ps(&this->angle[i]);
+        __m128 delta = _mm_sub_ps(getTargetAngle4(useZ), angle);
+        __m128 sgn = select(_mm_cmpgt_ps(delta, _mm_setzero_ps()), vOne, vNegOne);
+        __m128 turn = _mm_min_ps(_mm_mul_ps(vDT, _mm_set1_ps(12.f)),
+                                 _mm_mul_ps(_mm_mul_ps(delta, sgn), _mm_set1_ps(0.15f)));
+        angle = _mm_add_ps(angle, _mm_mul_ps(sgn, turn));
+
+        _mm_storeu_ps(&this->posX[i], posX);
+        _mm_storeu_ps(&this->posY[i], posY);
+        _mm_storeu_ps(&this->posZ[i], posZ);
+        _mm_storeu_ps(&this->zVel[i], zVel1);
+        _mm_storeu_ps(&this->curGravity[i], curGravity);
+        _mm_storeu_ps(&this->angle[i], angle);
+    }
+#endif
+    // Remaining birds
+    for (; i < this->numBirds(); i++) {
+        stepOneBird(this, i, dt);
+    }
+}
+
+} // namespace flap
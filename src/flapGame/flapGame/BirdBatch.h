@@ -0,0 +1,79 @@
+#pragma once
+#include <flapGame/Core.h>
+#include <flapGame/GameState.h>
+
+namespace flap {
+
+//---------------------------------------------------------------------------
+// Per-step integration of a bird in Mode::Playing. updateMovement calls these directly, and
+// BirdBatch performs exactly the same floating-point operations in the same order, so that both
+// produce bit-identical results and recordings replay the same either way.
+//---------------------------------------------------------------------------
+PLY_INLINE float getTargetAngle(float zVel) {
+    float targetAngle = -0.1 * Pi;
+    targetAngle += -clamp(zVel, -15.f, 15.f) * 0.01f;
+    float excess = max(0.f, -15.f - zVel);
+    if (excess > 0) {
+        targetAngle += min(excess * 0.04f, 0.55f * Pi);
+    }
+    return targetAngle;
+}
+
+// Moves curGravity toward NormalGravity
+PLY_INLINE float stepGravity(float curGravity, float gravApproach, float dtScaled) {
+    float step = dtScaled * gravApproach;
+    if (GameState::NormalGravity > curGravity) {
+        return min(curGravity + step, GameState::NormalGravity);
+    } else {
+        return max(curGravity - step, GameState::NormalGravity);
+    }
+}
+
+PLY_INLINE float stepZVel(float zVel0, float curGravity, float dtScaled) {
+    return max(zVel0 - curGravity * dtScaled, GameState::TerminalVelocity);
+}
+
+PLY_INLINE Float3 stepBirdPos(const Float3& pos0, float zVel0, float zVel1, float dtScaled) {
+    Float3 midVel = {GameState::ScrollRate, 0, (zVel0 + zVel1) * 0.5f};
+    Float3 pos1 = pos0 + midVel * dtScaled;
+    pos1.z = min(pos1.z, 22.f);
+    return pos1;
+}
+
+PLY_INLINE float stepBirdAngle(float angle, float zVel1, float curGravity, float dt) {
+    float useZ = zVel1;
+    useZ *= 1.f + (GameState::NormalGravity - curGravity) * 0.012f;
+    float delta = getTargetAngle(useZ) - angle;
+    float sgn = delta > 0 ? 1.f : -1.f;
+    return angle + sgn * min(dt * 12.f, delta * sgn * 0.15f);
+}
+
+//---------------------------------------------------------------------------
+// Structure-of-arrays state for many birds in Mode::Playing, advanced in lockstep. Only free flight
+// is covered: jumps, collisions, teleports and camera transitions are left to the caller, the same
+// way updateMovement handles them around the functions above.
+//---------------------------------------------------------------------------
+struct BirdBatch {
+    Array<float> posX;
+    Array<float> posY;
+    Array<float> posZ;
+    Array<float> zVel;
+    Array<float> curGravity;
+    Array<float> gravApproach;
+    Array<float> angle;
+    Array<float> timeScale;
+
+    PLY_INLINE u32 numBirds() const {
+        return this->posX.numItems();
+    }
+    void resize(u32 numBirds);
+    // Copies the bird state from a GameState in Mode::Playing
+    void setBird(u32 index, const GameState* gs);
+
+    // Uses SSE2 when available, four birds at a time
+    void step(float dt);
+    // Reference implementation, one bird at a time
+    void stepScalar(float dt);
+};
+
+} // namespace flap
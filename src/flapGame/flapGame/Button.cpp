@@ -1,12 +1,10 @@
 #include <flapGame/Core.h>
 #include <flapGame/Button.h>
 #include <flapGame/DrawContext.h>
-#include <flapGame/Assets.h>
+#include <flapGame/Audio.h>
 
 namespace flap {
 
-extern SoLoud::Soloud gSoLoud; // SoLoud engine
-
 float Button::getScale() {
     const DrawContext* dc = DrawContext::instance();
     float scale = 1.f;
@@ -28,13 +26,13 @@ Button::Result Button::doInput(bool down, bool isInside) {
     if (down) {
         if (isInside) {
             this->state.down().switchTo();
-            gSoLoud.play(Assets::instance->buttonDownSound, 1.f);
+            playSound(Sound::ButtonDown, 1.f);
             return Button::Handled;
         }
     } else {
         if (isInside) {
             this->state.released().switchTo();
-            gSoLoud.play(Assets::instance->buttonUpSound, 1.5f);
+            playSound(Sound::ButtonUp, 1.5f);
             this->wasClicked = true;
             return Button::Clicked;
         } else {
@@ -0,0 +1,45 @@
+#include <flapGame/Core.h>
+#include <flapGame/CheckpointQueue.h>
+
+namespace flap {
+
+void CheckpointQueue::push(float x) {
+    PLY_ASSERT(this->isEmpty() || x >= (*this)[this->count - 1]);
+    if (this->count >= this->ring.numItems()) {
+        // Grow the ring buffer, preserving the order of existing checkpoints
+        Array<float> newRing;
+        newRing.resize(max(this->ring.numItems() * 2, 16u));
+        for (u32 i = 0; i < this->count; i++) {
+            newRing[i] = (*this)[i];
+        }
+        this->ring = std::move(newRing);
+        this->head = 0;
+    }
+    this->count++;
+    (*this)[this->count - 1] = x;
+}
+
+u32 CheckpointQueue::passUpTo(float x) {
+    // Find the first checkpoint after x
+    u32 lo = 0;
+    u32 hi = this->count;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if (x >= (*this)[mid]) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    this->head = (this->head + lo) & (this->ring.numItems() - 1);
+    this->count -= lo;
+    return lo;
+}
+
+void CheckpointQueue::adjustX(float amount) {
+    for (u32 i = 0; i < this->count; i++) {
+        (*this)[i] += amount;
+    }
+}
+
+} // namespace flap
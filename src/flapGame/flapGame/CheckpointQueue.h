@@ -0,0 +1,37 @@
+#pragma once
+#include <flapGame/Core.h>
+
+namespace flap {
+
+// Sorted queue of checkpoint x-coordinates, stored in a ring buffer so that passing a checkpoint
+// doesn't shift the remaining ones. Checkpoints must be pushed in increasing order.
+struct CheckpointQueue {
+    Array<float> ring; // Capacity is a power of two
+    u32 head = 0;
+    u32 count = 0;
+
+    PLY_INLINE u32 numItems() const {
+        return this->count;
+    }
+    PLY_INLINE bool isEmpty() const {
+        return this->count == 0;
+    }
+    PLY_INLINE float& operator[](u32 i) {
+        PLY_ASSERT(i < this->count);
+        return this->ring[(this->head + i) & (this->ring.numItems() - 1)];
+    }
+    PLY_INLINE float operator[](u32 i) const {
+        return const_cast<CheckpointQueue*>(this)->operator[](i);
+    }
+    void push(float x);
+    PLY_INLINE void clear() {
+        this->head = 0;
+        this->count = 0;
+    }
+    // Removes every checkpoint at or before x and returns how many were removed. Uses a binary
+    // search, so fast-forwarding past many checkpoints at once is cheap.
+    u32 passUpTo(float x);
+    void adjustX(float amount);
+};
+
+} // namespace flap
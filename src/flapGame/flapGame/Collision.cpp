@@ -1,6 +1,13 @@
 #include <flapGame/Core.h>
 #include <flapGame/Collision.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAPGAME_COLLISION_SSE2 1
+#include <emmintrin.h>
+#else
+#define FLAPGAME_COLLISION_SSE2 0
+#endif
+
 namespace flap {
 
 SphCylCollResult::Type sphereCylinderCollisionTest(const Float3& spherePos, float sphereRadius,
@@ -88,4 +95,139 @@ SphCylCollResult::Type sphereCylinderCollisionTest(const Float3& spherePos, floa
     return type;
 }
 
+float pointCylinderDistance(const Float3& pos, float cylRadius) {
+    // Cylinder cap is centered at (0, 0, 0) and extends down the -Z axis
+    float u = pos.asFloat2().length() - cylRadius;
+    float v = pos.z;
+    if (u <= 0 || v <= 0) {
+        return max(u, v);
+    }
+    return sqrtf(u * u + v * v);
+}
+
+SphCylCollResult::Type sweptSphereCylinderCollisionTest(const Float3& spherePos0,
+                                                        const Float3& spherePos1,
+                                                        float sphereRadius,
+                                                        const Float3x4& cylToWorld,
+                                                        float cylRadius, float* outTime,
+                                                        SphCylCollResult* result) {
+    // Contact is detected once the sphere is within Tolerance of the cylinder surface. The
+    // sphere's radius is grown by twice that amount when computing the result, so that
+    // sphereCylinderCollisionTest always reports the contact.
+    static constexpr float Tolerance = 0.001f;
+    static constexpr u32 MaxIterations = 64;
+
+    Float3x4 worldToCyl = cylToWorld.invertedOrtho();
+    Float3 p0 = worldToCyl * spherePos0;
+    Float3 delta = worldToCyl.asFloat3x3() * (spherePos1 - spherePos0);
+    float length = delta.length();
+
+    // Conservative advancement: the sphere can always move by its distance from the cylinder
+    // without touching it.
+    float t = 0;
+    for (u32 i = 0;; i++) {
+        float dist = pointCylinderDistance(p0 + delta * t, cylRadius) - sphereRadius;
+        if (dist <= Tolerance)
+            break;
+        if (length <= 0 || i >= MaxIterations)
+            return SphCylCollResult::None;
+        t += dist / length;
+        if (t > 1.f)
+            return SphCylCollResult::None;
+    }
+
+    SphCylCollResult::Type type = sphereCylinderCollisionTest(
+        p0 + delta * t, sphereRadius + Tolerance * 2.f, cylRadius, result);
+    if (type != SphCylCollResult::None) {
+        result->penetrationDepth = max(0.f, result->penetrationDepth - Tolerance * 2.f);
+        result->pos = cylToWorld * result->pos;
+        result->norm = cylToWorld.asFloat3x3() * result->norm;
+        *outTime = t;
+    }
+    return type;
+}
+
+void CylinderBatch::clear() {
+    for (Array<float>& elements : this->worldToCyl) {
+        elements.clear();
+    }
+    this->cylToWorld.clear();
+}
+
+void CylinderBatch::add(const Float3x4& cylToWorld) {
+    Float3x4 worldToCyl = cylToWorld.invertedOrtho();
+    for (u32 col = 0; col < 4; col++) {
+        this->worldToCyl[col * 3].append(worldToCyl[col].x);
+        this->worldToCyl[col * 3 + 1].append(worldToCyl[col].y);
+        this->worldToCyl[col * 3 + 2].append(worldToCyl[col].z);
+    }
+    this->cylToWorld.append(cylToWorld);
+}
+
+SphCylCollResult::Type sphereCylinderCollisionTestBatch(const Float3& spherePos,
+                                                        float sphereRadius,
+                                                        const CylinderBatch& batch,
+                                                        float cylRadius, u32* outIndex,
+                                                        SphCylCollResult* result) {
+    SphCylCollResult::Type bestType = SphCylCollResult::None;
+    auto testOne = [&](u32 i) {
+        SphCylCollResult candidate;
+        SphCylCollResult::Type type = sphereCylinderCollisionTest(
+            spherePos, sphereRadius, batch.cylToWorld[i], cylRadius, &candidate);
+        if (type != SphCylCollResult::None &&
+            (bestType == SphCylCollResult::None ||
+             candidate.penetrationDepth > result->penetrationDepth)) {
+            bestType = type;
+            *result = candidate;
+            *outIndex = i;
+        }
+    };
+
+    u32 i = 0;
+#if FLAPGAME_COLLISION_SSE2
+    // Same trivial rejects as sphereCylinderCollisionTest, widened by a small margin so that
+    // rounding differences never reject a cylinder that the scalar test would accept. Surviving
+    // cylinders are passed to the scalar test.
+    static constexpr float Margin = 0.001f;
+    const Array<float>* m = batch.worldToCyl;
+    __m128 sx = _mm_set1_ps(spherePos.x);
+    __m128 sy = _mm_set1_ps(spherePos.y);
+    __m128 sz = _mm_set1_ps(spherePos.z);
+    __m128 maxV = _mm_set1_ps(sphereRadius + Margin);
+    float maxU = cylRadius + sphereRadius + Margin;
+    __m128 maxU2 = _mm_set1_ps(maxU * maxU);
+    u32 numCylinders4 = batch.numCylinders() & ~3u;
+    for (; i < numCylinders4; i += 4) {
+        __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[0][i]), sx),
+                                         _mm_mul_ps(_mm_loadu_ps(&m[3][i]), sy)),
+                              _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[6][i]), sz),
+                                         _mm_loadu_ps(&m[9][i])));
+        __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[1][i]), sx),
+                                         _mm_mul_ps(_mm_loadu_ps(&m[4][i]), sy)),
+                              _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[7][i]), sz),
+                                         _mm_loadu_ps(&m[10][i])));
+        __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[2][i]), sx),
+                                         _mm_mul_ps(_mm_loadu_ps(&m[5][i]), sy)),
+                              _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[8][i]), sz),
+                                         _mm_loadu_ps(&m[11][i])));
+        __m128 u2 = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+        int candidates =
+            _mm_movemask_ps(_mm_and_ps(_mm_cmplt_ps(z, maxV), _mm_cmplt_ps(u2, maxU2)));
+        while (candidates) {
+            u32 lane = 0;
+            while (!(candidates & (1 << lane))) {
+                lane++;
+            }
+            candidates &= ~(1 << lane);
+            testOne(i + lane);
+        }
+    }
+#endif
+    // Remaining cylinders
+    for (; i < batch.numCylinders(); i++) {
+        testOne(i);
+    }
+    return bestType;
+}
+
 } // namespace flap
@@ -23,4 +23,41 @@ SphCylCollResult::Type sphereCylinderCollisionTest(const Float3& spherePos, floa
                                                    const Float3x4& cylToWorld, float cylRadius,
                                                    SphCylCollResult* result);
 
+// Distance from a point to the surface of the cylinder, in cylinder space. Negative inside.
+float pointCylinderDistance(const Float3& pos, float cylRadius);
+
+// Moves a sphere from spherePos0 to spherePos1 and finds the first contact with the cylinder using
+// conservative advancement. If there's a contact, *outTime receives the fraction of the motion at
+// which it occurs, and *result describes it the same way as sphereCylinderCollisionTest. Contacts
+// that are already overlapping at spherePos0 are reported at time 0.
+SphCylCollResult::Type sweptSphereCylinderCollisionTest(const Float3& spherePos0,
+                                                        const Float3& spherePos1,
+                                                        float sphereRadius,
+                                                        const Float3x4& cylToWorld,
+                                                        float cylRadius, float* outTime,
+                                                        SphCylCollResult* result);
+
+// Structure-of-arrays copy of many cylinder transforms, so that one sphere can be tested against
+// all of them at once. Transforms are inverted once, when they're added to the batch.
+struct CylinderBatch {
+    Array<float> worldToCyl[12]; // Column-major: element [col * 3 + row]
+    Array<Float3x4> cylToWorld;
+
+    PLY_INLINE u32 numCylinders() const {
+        return this->cylToWorld.numItems();
+    }
+    void clear();
+    void add(const Float3x4& cylToWorld);
+};
+
+// Tests a sphere against every cylinder in the batch, four at a time using SSE2 when available.
+// Returns the contact with the greatest penetration depth, or the first such contact in case of a
+// tie, and stores its cylinder index in *outIndex. The contact is identical to what
+// sphereCylinderCollisionTest returns for that cylinder; only trivial rejects are vectorized.
+SphCylCollResult::Type sphereCylinderCollisionTestBatch(const Float3& spherePos,
+                                                        float sphereRadius,
+                                                        const CylinderBatch& batch,
+                                                        float cylRadius, u32* outIndex,
+                                                        SphCylCollResult* result);
+
 } // namespace flap
@@ -3,8 +3,11 @@
 #include <ply-runtime/Base.h>
 #include <ply-runtime/algorithm/Sort.h>
 #include <ply-math/Base.h>
+// FLAPGAME_HEADLESS is set by the flapSim module, which builds the game logic without GL or audio
+#if !FLAPGAME_HEADLESS
 #include <image/Image.h>
 #include <soloud.h>
+#endif
 
 namespace flap {
 using namespace ply;
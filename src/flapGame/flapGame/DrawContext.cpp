@@ -21,6 +21,6 @@ ViewportFrustum fitFrustumInViewport(const Rect& viewport, const Rect& frustum,
     }
 }
 
-DrawContext* DrawContext::instance_ = nullptr;
+thread_local DrawContext* DrawContext::instance_ = nullptr;
 
 } // namespace flap
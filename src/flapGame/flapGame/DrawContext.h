@@ -4,6 +4,8 @@
 namespace flap {
 
 struct GameState;
+struct DrawList;
+struct RenderStats;
 
 struct ViewportFrustum {
     Rect viewport; // Viewport extents relative to render target
@@ -37,8 +39,10 @@ struct DrawContext {
     float fracTime = 0;
     float intervalFrac = 0;
     Rect visibleExtents = {{0, 0}, {0, 0}};
+    DrawList* drawList = nullptr;
+    RenderStats* stats = nullptr;
 
-    static DrawContext* instance_;
+    static thread_local DrawContext* instance_;
     static PLY_INLINE DrawContext* instance() {
         PLY_ASSERT(instance_);
         return instance_;
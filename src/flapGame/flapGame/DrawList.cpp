@@ -0,0 +1,297 @@
+#include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
+#include <flapGame/DrawList.h>
+#include <flapGame/Public.h>
+#include <ply-runtime/algorithm/Find.h>
+
+namespace flap {
+
+// Sort key layout, from most to least significant bits:
+// pass (4) | shader (8) | texture (16) | mesh (16) | depth (20)
+static constexpr u32 DepthBits = 20;
+static constexpr float MaxSortDepth = 512.f;
+
+template <typename T>
+static u32 getSmallID(Array<T>& ids, T ptr) {
+    s32 index = find(ids, ptr);
+    if (index < 0) {
+        index = ids.numItems();
+        ids.append(ptr);
+    }
+    return (u32) index;
+}
+
+static DrawList::Command& addCommand(DrawList* dl, DrawList::Pass pass,
+                                     DrawList::Command::Type type, const void* shader,
+                                     const Float4x4& modelToCamera, const DrawMesh* drawMesh,
+                                     GLuint texID) {
+    u32 shaderID = getSmallID<const void*>(dl->shaderIDs, shader);
+    u32 meshID = getSmallID(dl->meshIDs, drawMesh);
+    PLY_ASSERT(shaderID < 256 && meshID < 65536);
+
+    // Front to back within each group, so that hidden fragments fail the depth test early
+    float depth = clamp(-modelToCamera[3].z / MaxSortDepth, 0.f, 1.f);
+    u64 key = (u64(pass) << 60) | (u64(shaderID) << 52) | (u64(texID & 0xffff) << 36) |
+              (u64(meshID) << DepthBits) | u64(depth * ((1 << DepthBits) - 1));
+    dl->sortItems.append({key, dl->commands.numItems()});
+
+    DrawList::Command& cmd = dl->commands.append();
+    cmd.type = type;
+    cmd.shader = shader;
+    cmd.drawMesh = drawMesh;
+    cmd.texID = texID;
+    cmd.modelToCamera = modelToCamera;
+    return cmd;
+}
+
+void DrawList::draw(Pass pass, const UberShader* shader, const Float4x4& modelToCamera,
+                    const DrawMesh* drawMesh, const SkinPalette* palette,
+                    const UberShader::Props* props) {
+    GLuint texID = 0;
+    if (shader->flags & UberShader::Flags::Duotone) {
+        texID = (props ? props : &UberShader::defaultProps)->texID;
+    }
+    Command& cmd = addCommand(this, pass, Command::Uber, shader, modelToCamera, drawMesh, texID);
+    cmd.palette = palette;
+    if (props) {
+        cmd.hasProps = true;
+        cmd.uberProps = *props;
+    }
+}
+
+void DrawList::drawInstanced(Pass pass, const UberShader* shader, const Float4x4& groupToCamera,
+                             const DrawMesh* drawMesh, GLuint instanceVBO, u32 firstInstance,
+                             u32 numInstances, const UberShader::Props* props) {
+    PLY_ASSERT(shader->flags & UberShader::Flags::Instanced);
+    PLY_ASSERT(numInstances > 0);
+    this->draw(pass, shader, groupToCamera, drawMesh, {}, props);
+    Command& cmd = this->commands.back();
+    cmd.instanceVBO = instanceVBO;
+    cmd.firstInstance = firstInstance;
+    cmd.numInstances = numInstances;
+}
+
+void DrawList::draw(Pass pass, const PipeShader* shader, const Float4x4& modelToCamera,
+                    const Float2& normalSkew, const DrawMesh* drawMesh, GLuint texID) {
+    Command& cmd = addCommand(this, pass, Command::Pipe, shader, modelToCamera, drawMesh, texID);
+    cmd.normalSkew = normalSkew;
+}
+
+void DrawList::drawInstanced(Pass pass, const PipeShader* shader, const Float4x4& worldToCamera,
+                             const Float2& normalSkew, const DrawMesh* drawMesh, GLuint texID,
+                             GLuint instanceVBO, u32 firstInstance, u32 numInstances) {
+    PLY_ASSERT(shader->instanced);
+    PLY_ASSERT(numInstances > 0);
+    this->draw(pass, shader, worldToCamera, normalSkew, drawMesh, texID);
+    Command& cmd = this->commands.back();
+    cmd.instanceVBO = instanceVBO;
+    cmd.firstInstance = firstInstance;
+    cmd.numInstances = numInstances;
+}
+
+void DrawList::draw(Pass pass, const MaterialShader* shader, const Float4x4& modelToCamera,
+                    const DrawMesh* drawMesh, const MaterialShader::Props* props) {
+    Command& cmd = addCommand(this, pass, Command::Material, shader, modelToCamera, drawMesh, 0);
+    if (props) {
+        cmd.hasProps = true;
+        cmd.matProps = *props;
+    }
+}
+
+void DrawList::draw(Pass pass, const TexturedMaterialShader* shader, const Float4x4& modelToCamera,
+                    const DrawMesh* drawMesh, GLuint texID, const MaterialShader::Props* props) {
+    Command& cmd =
+        addCommand(this, pass, Command::TexturedMaterial, shader, modelToCamera, drawMesh, texID);
+    if (props) {
+        cmd.hasProps = true;
+        cmd.matProps = *props;
+    }
+}
+
+static void beginShader(const DrawList::Command& cmd, const Float4x4& cameraToViewport) {
+    switch (cmd.type) {
+        case DrawList::Command::Uber:
+            ((const UberShader*) cmd.shader)->begin(cameraToViewport);
+            break;
+        case DrawList::Command::Pipe:
+            ((const PipeShader*) cmd.shader)->begin(cameraToViewport);
+            break;
+        case DrawList::Command::Material:
+            ((const MaterialShader*) cmd.shader)->begin(cameraToViewport);
+            break;
+        case DrawList::Command::TexturedMaterial:
+            ((const TexturedMaterialShader*) cmd.shader)->begin(cameraToViewport);
+            break;
+    }
+}
+
+static void bindMesh(const DrawList::Command& cmd) {
+    switch (cmd.type) {
+        case DrawList::Command::Uber:
+            ((const UberShader*) cmd.shader)->bindMesh(cmd.drawMesh);
+            break;
+        case DrawList::Command::Pipe:
+            ((const PipeShader*) cmd.shader)->bindMesh(cmd.drawMesh);
+            break;
+        case DrawList::Command::Material:
+            ((const MaterialShader*) cmd.shader)->bindMesh(cmd.drawMesh);
+            break;
+        case DrawList::Command::TexturedMaterial:
+            ((const TexturedMaterialShader*) cmd.shader)->bindMesh(cmd.drawMesh);
+            break;
+    }
+}
+
+static void drawBound(const DrawList::Command& cmd) {
+    switch (cmd.type) {
+        case DrawList::Command::Uber: {
+            const UberShader* uber = (const UberShader*) cmd.shader;
+            const UberShader::Props* props = cmd.hasProps ? &cmd.uberProps : nullptr;
+            if (cmd.numInstances > 0) {
+                uber->bindInstances(cmd.instanceVBO, cmd.firstInstance);
+                uber->drawBoundInstanced(cmd.modelToCamera, cmd.drawMesh, cmd.numInstances,
+                                         props);
+            } else {
+                uber->drawBound(cmd.modelToCamera, cmd.drawMesh, cmd.palette, props);
+            }
+            break;
+        }
+        case DrawList::Command::Pipe: {
+            const PipeShader* pipe = (const PipeShader*) cmd.shader;
+            if (cmd.numInstances > 0) {
+                pipe->bindInstances(cmd.instanceVBO, cmd.firstInstance);
+                pipe->drawBoundInstanced(cmd.modelToCamera, cmd.normalSkew, cmd.drawMesh,
+                                         cmd.numInstances);
+            } else {
+                pipe->drawBound(cmd.modelToCamera, cmd.normalSkew, cmd.drawMesh);
+            }
+            break;
+        }
+        case DrawList::Command::Material:
+            ((const MaterialShader*) cmd.shader)
+                ->drawBound(cmd.modelToCamera, cmd.drawMesh,
+                            cmd.hasProps ? &cmd.matProps : nullptr);
+            break;
+        case DrawList::Command::TexturedMaterial:
+            ((const TexturedMaterialShader*) cmd.shader)
+                ->drawBound(cmd.modelToCamera, cmd.drawMesh,
+                            cmd.hasProps ? &cmd.matProps : nullptr);
+            break;
+    }
+}
+
+static void endShader(const DrawList::Command& cmd) {
+    switch (cmd.type) {
+        case DrawList::Command::Uber:
+            ((const UberShader*) cmd.shader)->end();
+            break;
+        case DrawList::Command::Pipe:
+            ((const PipeShader*) cmd.shader)->end();
+            break;
+        case DrawList::Command::Material:
+            ((const MaterialShader*) cmd.shader)->end();
+            break;
+        case DrawList::Command::TexturedMaterial:
+            ((const TexturedMaterialShader*) cmd.shader)->end();
+            break;
+    }
+}
+
+// Counts the state changes that submit would make if it issued the commands in the order they
+// were recorded, for comparison with the sorted order.
+static void countUnsortedChanges(ArrayView<const DrawList::Command> commands, RenderStats* stats) {
+    const DrawList::Command* prevCmd = nullptr;
+    GLuint curTexID = 0;
+    for (const DrawList::Command& cmd : commands) {
+        bool shaderChanged = !prevCmd || cmd.shader != prevCmd->shader;
+        if (shaderChanged) {
+            stats->numUnsortedProgramChanges++;
+        }
+        if (cmd.texID != 0 && cmd.texID != curTexID) {
+            curTexID = cmd.texID;
+            stats->numUnsortedTextureChanges++;
+        }
+        if (shaderChanged || cmd.drawMesh != prevCmd->drawMesh) {
+            stats->numUnsortedMeshChanges++;
+        }
+        prevCmd = &cmd;
+    }
+}
+
+void DrawList::submit(RenderStats* stats) {
+    if (stats) {
+        countUnsortedChanges(this->commands.view(), stats);
+    }
+    sort(this->sortItems);
+
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    s32 curPass = -1;
+    const Command* prevCmd = nullptr;
+    GLuint curTexID = 0;
+    u32 numTexturedDraws = 0;
+    u32 numProgramChanges = 0;
+    u32 numTextureChanges = 0;
+    u32 numMeshChanges = 0;
+    for (const SortItem& item : this->sortItems) {
+        const Command& cmd = this->commands[item.index];
+
+        s32 pass = s32(item.key >> 60);
+        if (pass != curPass) {
+            if (pass == Stencil) {
+                GL_CHECK(Enable(GL_STENCIL_TEST));
+                GL_CHECK(StencilFunc(GL_ALWAYS, 1, 0xFF));
+                GL_CHECK(StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
+                GL_CHECK(StencilMask(0xFF));
+            } else if (curPass == Stencil) {
+                GL_CHECK(Disable(GL_STENCIL_TEST));
+            }
+            curPass = pass;
+        }
+
+        bool shaderChanged = !prevCmd || cmd.shader != prevCmd->shader;
+        if (shaderChanged) {
+            if (prevCmd) {
+                endShader(*prevCmd);
+            }
+            beginShader(cmd, this->cameraToViewport);
+            numProgramChanges++;
+        }
+        if (cmd.texID != 0) {
+            numTexturedDraws++;
+            if (cmd.texID != curTexID) {
+                GL_STATE(BindTexture(GL_TEXTURE_2D, cmd.texID));
+                curTexID = cmd.texID;
+                numTextureChanges++;
+            }
+        }
+        if (shaderChanged || cmd.drawMesh != prevCmd->drawMesh) {
+            bindMesh(cmd);
+            numMeshChanges++;
+        }
+        drawBound(cmd);
+        prevCmd = &cmd;
+    }
+    if (prevCmd) {
+        endShader(*prevCmd);
+    }
+    if (curPass == Stencil) {
+        GL_CHECK(Disable(GL_STENCIL_TEST));
+    }
+
+    if (stats) {
+        stats->numSortedDraws += this->commands.numItems();
+        stats->numTexturedDraws += numTexturedDraws;
+        stats->numProgramChanges += numProgramChanges;
+        stats->numTextureChanges += numTextureChanges;
+        stats->numMeshChanges += numMeshChanges;
+    }
+
+    this->commands.clear();
+    this->sortItems.clear();
+    this->shaderIDs.clear();
+    this->meshIDs.clear();
+}
+
+} // namespace flap
+
+#endif // !FLAPGAME_HEADLESS
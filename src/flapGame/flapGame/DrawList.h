@@ -0,0 +1,91 @@
+#pragma once
+#include <flapGame/Core.h>
+#include <flapGame/Shaders.h>
+
+namespace flap {
+
+struct RenderStats;
+
+// Records the opaque mesh draws of a game panel, then sorts them by pass, shader, texture, mesh and
+// depth before submitting them. Consecutive draws that share a shader, texture or mesh skip the
+// corresponding program, texture and vertex attribute setup.
+//
+// Only depth-tested, non-blended draws should be recorded, since their order doesn't affect the
+// image within a pass. Blended draws are still issued immediately, in painter order, after the
+// list is submitted.
+struct DrawList {
+    enum Pass : u8 {
+        Stencil, // Writes 1 to the stencil buffer; used for the bird
+        Opaque,
+    };
+
+    struct Command {
+        enum Type : u8 {
+            Uber,
+            Pipe,
+            Material,
+            TexturedMaterial,
+        };
+
+        Type type = Uber;
+        const void* shader = nullptr;
+        const DrawMesh* drawMesh = nullptr;
+        GLuint texID = 0;
+        Float4x4 modelToCamera = Float4x4::identity();
+        bool hasProps = false;
+        UberShader::Props uberProps;           // Type::Uber only
+        const SkinPalette* palette = nullptr;  // Skinned Type::Uber only
+        GLuint instanceVBO = 0;                // Instanced Type::Uber and Type::Pipe only
+        u32 firstInstance = 0;
+        u32 numInstances = 0;
+        MaterialShader::Props matProps;        // Type::Material and Type::TexturedMaterial only
+        Float2 normalSkew = {0, 0};            // Type::Pipe only
+    };
+
+    struct SortItem {
+        u64 key = 0;
+        u32 index = 0;
+
+        PLY_INLINE bool friend operator<(const SortItem& a, const SortItem& b) {
+            return (a.key != b.key) ? a.key < b.key : a.index < b.index;
+        }
+    };
+
+    Float4x4 cameraToViewport = Float4x4::identity();
+    Array<Command> commands;
+    Array<SortItem> sortItems;
+    // Small integers assigned to each shader and mesh as they're first recorded, used to build
+    // sort keys. Cleared by submit.
+    Array<const void*> shaderIDs;
+    Array<const DrawMesh*> meshIDs;
+    // Scratch space for gathering pipe transforms before they're uploaded as instance data. Kept
+    // here so its memory is reused from frame to frame.
+    Array<Float3x4> pipeToWorlds;
+    // The bird's skinning transforms, recomputed for each panel
+    SkinPalette birdPalette;
+
+    void draw(Pass pass, const UberShader* shader, const Float4x4& modelToCamera,
+              const DrawMesh* drawMesh, const SkinPalette* palette,
+              const UberShader::Props* props = nullptr);
+    // modelToCamera is a group-to-camera transform. See UberShader::Flags::Instanced.
+    void drawInstanced(Pass pass, const UberShader* shader, const Float4x4& groupToCamera,
+                       const DrawMesh* drawMesh, GLuint instanceVBO, u32 firstInstance,
+                       u32 numInstances, const UberShader::Props* props = nullptr);
+    void draw(Pass pass, const PipeShader* shader, const Float4x4& modelToCamera,
+              const Float2& normalSkew, const DrawMesh* drawMesh, GLuint texID);
+    // instanceVBO holds Float3x4 model-to-world transforms. See PipeShader::instanced.
+    void drawInstanced(Pass pass, const PipeShader* shader, const Float4x4& worldToCamera,
+                       const Float2& normalSkew, const DrawMesh* drawMesh, GLuint texID,
+                       GLuint instanceVBO, u32 firstInstance, u32 numInstances);
+    void draw(Pass pass, const MaterialShader* shader, const Float4x4& modelToCamera,
+              const DrawMesh* drawMesh, const MaterialShader::Props* props = nullptr);
+    void draw(Pass pass, const TexturedMaterialShader* shader, const Float4x4& modelToCamera,
+              const DrawMesh* drawMesh, GLuint texID,
+              const MaterialShader::Props* props = nullptr);
+
+    // Issues all recorded draws and clears the list. If stats is not null, the number of draws
+    // and state changes are added to it.
+    void submit(RenderStats* stats);
+};
+
+} // namespace flap
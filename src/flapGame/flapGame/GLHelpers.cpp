@@ -1,4 +1,5 @@
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/GLHelpers.h>
 
 namespace flap {
@@ -11,9 +12,113 @@ PLY_NO_INLINE GLBuffer GLBuffer::create(StringView data) {
     return result;
 }
 
+GLuint GLVertexArray::defaultID = 0;
+bool GLVertexArray::useMeshVAOs = true;
+
+PLY_NO_INLINE GLVertexArray GLVertexArray::create() {
+    GLVertexArray result;
+    GL_CHECK(GenVertexArrays(1, &result.id));
+    return result;
+}
+
+GLStateCache* GLStateCache::instance = nullptr;
+
+PLY_NO_INLINE void GLStateCache::invalidate() {
+    this->program = Unknown;
+    this->depthTest = Unknown;
+    this->blend = Unknown;
+    this->depthMask = Unknown;
+    for (GLuint& f : this->blendFunc) {
+        f = Unknown;
+    }
+    this->activeTexture = Unknown;
+    for (GLuint& t : this->textures) {
+        t = Unknown;
+    }
+}
+
+PLY_NO_INLINE void GLStateCache::BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha,
+                                                   GLenum dstAlpha) {
+    GLStateCache* cache = instance;
+    if (cache) {
+        GLuint* f = cache->blendFunc;
+        if (f[0] == srcRGB && f[1] == dstRGB && f[2] == srcAlpha && f[3] == dstAlpha) {
+            cache->numSkipped++;
+            return;
+        }
+        f[0] = srcRGB;
+        f[1] = dstRGB;
+        f[2] = srcAlpha;
+        f[3] = dstAlpha;
+        cache->numIssued++;
+    }
+    GL_CHECK(BlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha));
+}
+
+PLY_NO_INLINE void GLStateCache::BindTexture(GLenum target, GLuint id) {
+    GLuint* shadow = nullptr;
+    if (instance && target == GL_TEXTURE_2D) {
+        u32 unit = instance->activeTexture - GL_TEXTURE0;
+        if (unit < NumTextureUnits) {
+            shadow = &instance->textures[unit];
+        }
+    }
+    if (update(shadow, id)) {
+        GL_CHECK(BindTexture(target, id));
+    }
+}
+
+PLY_NO_INLINE void GLStateCache::forgetTexture(GLuint id) {
+    if (instance) {
+        for (GLuint& t : instance->textures) {
+            if (t == id) {
+                t = Unknown;
+            }
+        }
+    }
+}
+
+PLY_NO_INLINE void UniformBlock::setBinding(GLuint programID, const char* blockName,
+                                            GLuint bindingPoint) {
+    GLuint index = GL_NO_CHECK(GetUniformBlockIndex(programID, blockName));
+    PLY_ASSERT(index != GL_INVALID_INDEX);
+    GL_CHECK(UniformBlockBinding(programID, index, bindingPoint));
+}
+
+CameraUniforms* CameraUniforms::instance = nullptr;
+
+PLY_NO_INLINE void CameraUniforms::init() {
+    this->ubo = GLBuffer::create({(const char*) &this->cameraToViewport, sizeof(Float4x4)});
+    GL_CHECK(BindBufferBase(GL_UNIFORM_BUFFER, UniformBlock::Camera, this->ubo.id));
+}
+
+PLY_NO_INLINE void CameraUniforms::set(const Float4x4& cameraToViewport) {
+    if (this->isValid &&
+        memcmp(&cameraToViewport, &this->cameraToViewport, sizeof(Float4x4)) == 0)
+        return;
+    this->cameraToViewport = cameraToViewport;
+    this->isValid = true;
+    GL_CHECK(BindBuffer(GL_UNIFORM_BUFFER, this->ubo.id));
+    GL_CHECK(BufferData(GL_UNIFORM_BUFFER, sizeof(Float4x4), &cameraToViewport, GL_DYNAMIC_DRAW));
+}
+
 DynamicArrayBuffers* DynamicArrayBuffers::instance = nullptr;
 
-PLY_NO_INLINE GLuint DynamicArrayBuffers::upload(StringView data) {
+PLY_NO_INLINE DynamicArrayBuffers::Range DynamicArrayBuffers::upload(StringView data,
+                                                                      u32 alignment) {
+    this->numBytesUploaded += data.numBytes;
+    if (this->useRingBuffer) {
+        PLY_ASSERT(alignment > 0);
+        u32 offset = (this->ringUsed + alignment - 1) / alignment * alignment;
+        this->ringUsed = offset + data.numBytes;
+        if (this->ringUsed <= this->ringSize) {
+            GLuint id = this->ringBuffers[this->frameNumber & 1].id;
+            GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, id));
+            GL_CHECK(BufferSubData(GL_ARRAY_BUFFER, offset, data.numBytes, data.bytes));
+            return {id, offset};
+        }
+    }
+
     Array<Item>& curInUse = this->inUse[frameNumber & 1];
     Item* item = nullptr;
     for (u32 i = 0; i < this->available.numItems(); i++) {
@@ -22,6 +127,7 @@ PLY_NO_INLINE GLuint DynamicArrayBuffers::upload(StringView data) {
             item = &curInUse.append(this->available[i]);
             this->available.eraseQuick(i);
             item->lastFrameUsed = frameNumber;
+            break;
         }
     }
     if (!item) {
@@ -30,15 +136,40 @@ PLY_NO_INLINE GLuint DynamicArrayBuffers::upload(StringView data) {
         item->numBytes = data.numBytes;
         GL_CHECK(GenBuffers(1, &item->id));
         this->totalMem += data.numBytes;
+        this->numBuffersCreated++;
     }
     GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, item->id));
     GL_CHECK(BufferData(GL_ARRAY_BUFFER, data.numBytes, data.bytes, GL_DYNAMIC_DRAW));
     item->lastFrameUsed = frameNumber;
-    return item->id;
+    return {item->id, 0};
 }
 
 PLY_NO_INLINE void DynamicArrayBuffers::beginFrame() {
     frameNumber++;
+    this->numBytesUploaded = 0;
+    this->numBuffersCreated = 0;
+    if (this->uniformAlignment == 0) {
+        GLint alignment = 0;
+        GL_CHECK(GetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+        this->uniformAlignment = max<u32>(alignment, 16);
+    }
+    if (this->useRingBuffer) {
+        // Grow the ring if the last frame overflowed it, then orphan this frame's buffer so that
+        // writing to it never waits for the GPU
+        u32 newSize = max(this->ringSize, MinRingSize);
+        while (newSize < this->ringUsed) {
+            newSize *= 2;
+        }
+        this->ringSize = newSize;
+        this->ringUsed = 0;
+        GLBuffer& ring = this->ringBuffers[frameNumber & 1];
+        if (!ring.id) {
+            GL_CHECK(GenBuffers(1, &ring.id));
+            this->numBuffersCreated++;
+        }
+        GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ring.id));
+        GL_CHECK(BufferData(GL_ARRAY_BUFFER, this->ringSize, nullptr, GL_STREAM_DRAW));
+    }
     Array<Item>& curInUse = this->inUse[frameNumber & 1];
     this->available.extend(std::move(curInUse));
     curInUse.clear();
@@ -165,7 +296,7 @@ PLY_NO_INLINE void Texture::init(u32 width, u32 height, image::Format format, u3
     this->format = format;
     this->sRGB = params.sRGB;
     GL_CHECK(GenTextures(1, &this->id));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, this->id));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, this->id));
     GL_CHECK(TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
                            params.minFilter ? (mipLevels > 1 ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR)
                                             : GL_NEAREST));
@@ -206,7 +337,7 @@ PLY_NO_INLINE void Texture::init(u32 width, u32 height, image::Format format, u3
         width = max(1u, (width / 2));
         height = max(1u, (height / 2));
     }
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, 0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, 0));
 }
 
 PLY_NO_INLINE void Texture::upload(const image::Image& im) {
@@ -215,7 +346,7 @@ PLY_NO_INLINE void Texture::upload(const image::Image& im) {
     PLY_ASSERT(im.format == this->format);
     PLY_ASSERT(im.stride == im.width * im.bytespp);
     PLY_ASSERT(this->id);
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, this->id));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, this->id));
     struct Args {
         GLenum format = GL_RGBA;
         GLenum type = GL_UNSIGNED_BYTE;
@@ -243,7 +374,7 @@ PLY_NO_INLINE void Texture::upload(const image::Image& im) {
     if (this->mipLevels > 1) {
         GL_CHECK(GenerateMipmap(GL_TEXTURE_2D));
     }
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, 0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, 0));
 }
 
 PLY_NO_INLINE void RenderToTexture::destroy() {
@@ -284,3 +415,5 @@ PLY_NO_INLINE void RenderToTexture::init(const Texture& tex, bool withDepth) {
 }
 
 } // namespace flap
+
+#endif // !FLAPGAME_HEADLESS
@@ -18,6 +18,8 @@
         PLY_ASSERT(glGetError() == GL_NO_ERROR); \
     } while (0)
 #define GL_NO_CHECK(call) (gl##call)
+// Same as GL_CHECK, but goes through GLStateCache, which skips calls that wouldn't change anything
+#define GL_STATE(call) flap::GLStateCache::call
 
 namespace flap {
 
@@ -44,7 +46,161 @@ struct GLBuffer {
     static GLBuffer create(StringView data);
 };
 
+struct GLVertexArray {
+    GLuint id = 0;
+
+    PLY_INLINE GLVertexArray() = default;
+    PLY_INLINE GLVertexArray(GLVertexArray&& other) : id{other.id} {
+        other.id = 0;
+    }
+    PLY_INLINE void operator=(GLVertexArray&& other) {
+        if (this->id != 0) {
+            GL_CHECK(DeleteVertexArrays(1, &this->id));
+        }
+        this->id = other.id;
+        other.id = 0;
+    }
+    PLY_INLINE ~GLVertexArray() {
+        if (this->id != 0) {
+            GL_CHECK(DeleteVertexArrays(1, &this->id));
+        }
+    }
+
+    static GLVertexArray create();
+
+    // The VAO that's bound whenever a per-mesh VAO isn't. Core profiles have no default VAO, so
+    // the host app creates one; Assets::load queries it.
+    static GLuint defaultID;
+    // When false, DrawMesh::findVAO always returns 0, so every draw sets up its vertex attributes
+    // directly. Used to measure the difference.
+    static bool useMeshVAOs;
+};
+
+// Shadows the GL state that shaders set before every draw, so that GL_STATE can skip redundant
+// calls. Owned by GameFlow and installed as GLStateCache::instance during render; when no instance
+// is installed, GL_STATE calls go straight to GL. Only GL_DEPTH_TEST and GL_BLEND are tracked by
+// Enable and Disable, and only GL_TEXTURE_2D by BindTexture. Code that changes tracked state
+// without GL_STATE must call invalidate.
+struct GLStateCache {
+    static constexpr u32 NumTextureUnits = 4;
+    static constexpr GLuint Unknown = ~0u;
+
+    GLuint program = Unknown;
+    GLuint depthTest = Unknown;
+    GLuint blend = Unknown;
+    GLuint depthMask = Unknown;
+    GLuint blendFunc[4] = {Unknown, Unknown, Unknown, Unknown};
+    GLuint activeTexture = Unknown;
+    GLuint textures[NumTextureUnits] = {Unknown, Unknown, Unknown, Unknown};
+    // Since the last call to beginFrame
+    u32 numIssued = 0;
+    u32 numSkipped = 0;
+
+    static GLStateCache* instance;
+
+    void invalidate();
+    PLY_INLINE void beginFrame() {
+        this->invalidate();
+        this->numIssued = 0;
+        this->numSkipped = 0;
+    }
+
+    // Returns true if the call should be issued, and updates the shadow value.
+    static PLY_INLINE bool update(GLuint* shadow, GLuint value) {
+        GLStateCache* cache = instance;
+        if (!cache)
+            return true;
+        if (shadow && *shadow == value) {
+            cache->numSkipped++;
+            return false;
+        }
+        if (shadow) {
+            *shadow = value;
+        }
+        cache->numIssued++;
+        return true;
+    }
+    static PLY_INLINE GLuint* capShadow(GLenum cap) {
+        if (!instance)
+            return nullptr;
+        if (cap == GL_DEPTH_TEST)
+            return &instance->depthTest;
+        if (cap == GL_BLEND)
+            return &instance->blend;
+        return nullptr;
+    }
+
+    static PLY_INLINE void UseProgram(GLuint id) {
+        if (update(instance ? &instance->program : nullptr, id)) {
+            GL_CHECK(UseProgram(id));
+        }
+    }
+    static PLY_INLINE void Enable(GLenum cap) {
+        if (update(capShadow(cap), 1)) {
+            GL_CHECK(Enable(cap));
+        }
+    }
+    static PLY_INLINE void Disable(GLenum cap) {
+        if (update(capShadow(cap), 0)) {
+            GL_CHECK(Disable(cap));
+        }
+    }
+    static PLY_INLINE void DepthMask(GLboolean flag) {
+        if (update(instance ? &instance->depthMask : nullptr, flag)) {
+            GL_CHECK(DepthMask(flag));
+        }
+    }
+    static void BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+    static PLY_INLINE void BlendFunc(GLenum src, GLenum dst) {
+        BlendFuncSeparate(src, dst, src, dst);
+    }
+    static PLY_INLINE void ActiveTexture(GLenum unit) {
+        if (update(instance ? &instance->activeTexture : nullptr, unit)) {
+            GL_CHECK(ActiveTexture(unit));
+        }
+    }
+    static void BindTexture(GLenum target, GLuint id);
+    // Called when a texture is deleted, since GL unbinds it and its ID may be reused
+    static void forgetTexture(GLuint id);
+};
+
+// Binding points of the uniform blocks shared between shaders
+struct UniformBlock {
+    static constexpr GLuint Camera = 0; // CameraBlock { mat4 cameraToViewport; }
+    static constexpr GLuint Props = 1;  // PropsBlock; layout depends on the shader
+    static constexpr GLuint Bones = 2;  // BonesBlock { mat4 boneXforms[]; }; see SkinPalette
+
+    static void setBinding(GLuint programID, const char* blockName, GLuint bindingPoint);
+};
+
+// The buffer bound to UniformBlock::Camera. set only uploads the matrix when it changes, which
+// normally happens a few times per frame.
+struct CameraUniforms {
+    GLBuffer ubo;
+    Float4x4 cameraToViewport = Float4x4::identity();
+    bool isValid = false;
+
+    void init();
+    void set(const Float4x4& cameraToViewport);
+
+    static CameraUniforms* instance;
+};
+
+// Holds data uploaded for the current frame. By default, uploads are sub-allocated from a ring of
+// two large buffers, one per frame in flight, each orphaned at the start of the frame that uses it.
+// When useRingBuffer is false, each upload gets a whole buffer, reused across frames when the size
+// matches exactly.
 struct DynamicArrayBuffers {
+    // Where an upload was placed. Attribute pointers and index offsets must add the offset.
+    struct Range {
+        GLuint id = 0;
+        u32 offset = 0;
+
+        PLY_INLINE GLvoid* ptr(uptr relOffset = 0) const {
+            return (GLvoid*) (uptr(this->offset) + relOffset);
+        }
+    };
+
     struct Item {
         u32 numBytes = 0;
         GLuint id = 0;
@@ -60,10 +216,26 @@ struct DynamicArrayBuffers {
     u32 frameNumber = 0;
     u32 totalMem = 0;
 
+    bool useRingBuffer = true;
+    GLBuffer ringBuffers[2];
+    u32 ringSize = 0;
+    u32 ringUsed = 0; // Includes uploads that didn't fit, so that the next frame can grow the ring
+    u32 uniformAlignment = 0;
+
+    // Since the last call to beginFrame
+    u32 numBytesUploaded = 0;
+    u32 numBuffersCreated = 0;
+
     static const s32 KeepAliveFrames = 10;
     static const s32 KeepAliveSize = 5000000;
+    static const u32 MinRingSize = 256 * 1024;
 
-    GLuint upload(StringView data);
+    // Uploads that don't fit in the ring use a whole buffer, as if useRingBuffer was false.
+    Range upload(StringView data, u32 alignment = 16);
+    // Aligned for use with BindBufferRange(GL_UNIFORM_BUFFER, ...)
+    PLY_INLINE Range uploadUniforms(StringView data) {
+        return this->upload(data, this->uniformAlignment);
+    }
     void beginFrame();
 
     static DynamicArrayBuffers* instance;
@@ -141,6 +313,7 @@ struct Texture {
 
     PLY_INLINE void destroy() {
         if (this->id != 0) {
+            GLStateCache::forgetTexture(this->id);
             GL_CHECK(DeleteTextures(1, &this->id));
             this->id = 0;
         }
@@ -1,4 +1,5 @@
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/GameFlow.h>
 #include <flapGame/Assets.h>
 #include <flapGame/DrawContext.h>
@@ -44,14 +45,18 @@ void GameFlow::resetGame(bool isPlaying) {
     if (isPlaying) {
         this->gameState->startPlaying();
     } else {
-        this->gameState->mode.title().switchTo();
-        this->gameState->titleScreen = new TitleScreen;
-        this->gameState->camera.orbit().switchTo();
-        this->gameState->updateCamera(true);
-        this->gameState->sweat.time = 2;
+        this->gameState->startTitle();
     }
 }
 
+void GameFlow::restartWithSeed(u64 seed) {
+    this->gameSeeds = Random{seed};
+    this->stepIndex = 0;
+    this->fracTime = 0;
+    this->trans.off().switchTo();
+    this->resetGame(false);
+}
+
 void GameFlow::backToTitle() {
     Assets* a = Assets::instance;
     auto transOn = this->trans.on();
@@ -64,6 +69,43 @@ void GameFlow::backToTitle() {
     }
 }
 
+void DynamicResolution::update(float frameTime) {
+    if (this->frameBudget <= 0) {
+        this->step = 0;
+        return;
+    }
+    frameTime = min(frameTime, MaxFrameTime);
+    if (this->avgFrameTime <= 0) {
+        this->avgFrameTime = frameTime;
+    } else {
+        float f = min(frameTime / AveragingTime, 1.f);
+        this->avgFrameTime = mix(this->avgFrameTime, frameTime, f);
+    }
+
+    // Thresholds are a little apart so that jitter near the budget doesn't count either way
+    if (this->avgFrameTime > this->frameBudget * 1.2f) {
+        this->timeWithinBudget = 0;
+        this->timeOverBudget += frameTime;
+        if (this->timeOverBudget >= DropDelay && this->step + 1 < NumSteps) {
+            this->step++;
+            this->numChanges++;
+            this->timeOverBudget = 0;
+            this->raiseDelay = min(this->raiseDelay * 2.f, MaxRaiseDelay);
+        }
+    } else if (this->avgFrameTime <= this->frameBudget * 1.05f) {
+        this->timeOverBudget = 0;
+        this->timeWithinBudget += frameTime;
+        if (this->timeWithinBudget >= this->raiseDelay && this->step > 0) {
+            this->step--;
+            this->numChanges++;
+            this->timeWithinBudget = 0;
+        }
+    } else {
+        this->timeOverBudget = 0;
+        this->timeWithinBudget = 0;
+    }
+}
+
 GameFlow::GameFlow() {
     this->resetGame(false);
     this->titleMusicVoice = gSoLoud.play(Assets::instance->titleMusic);
@@ -73,14 +115,130 @@ GameFlow::GameFlow() {
 }
 
 void doInput(GameFlow* gf, const Float2& fbSize, const Float2& pos, bool down, float swipeMargin) {
+    if (gf->replay)
+        return; // Ignore live input during replay
+
     ViewportFrustum vf = getViewportFrustum(fbSize);
-    UpdateContext uc;
-    uc.gs = gf->gameState;
-    uc.bounds2D = vf.bounds2D;
-    uc.possibleSwipeFromEdge = (pos.y < swipeMargin || pos.y > fbSize.y - swipeMargin);
-    PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
-    Float2 pos2D = vf.bounds2D.mix(vf.viewport.unmix(pos));
-    doInput(gf->gameState, pos2D, down);
+    Recording::Event event;
+    event.step = gf->stepIndex;
+    event.down = down;
+    event.possibleSwipeFromEdge = (pos.y < swipeMargin || pos.y > fbSize.y - swipeMargin);
+    event.pos = vf.bounds2D.mix(vf.viewport.unmix(pos));
+    event.bounds2D = vf.bounds2D;
+    if (gf->recording) {
+        gf->recording->events.append(event);
+    }
+    applyInput(gf->gameState, event);
+}
+
+void setSimulationRate(GameFlow* gf, float stepsPerSecond, bool sweptCollision) {
+    gf->simulationTimeStep = 1.f / stepsPerSecond;
+    gf->sweptCollision = sweptCollision;
+}
+
+void setUseMeshVAOs(bool enabled) {
+    GLVertexArray::useMeshVAOs = enabled;
+}
+
+void setUseRingBuffer(GameFlow* gf, bool enabled) {
+    gf->dynBuffers.useRingBuffer = enabled;
+}
+
+void setUseTextLayoutCache(GameFlow* gf, bool enabled) {
+    gf->textCache.useCache = enabled;
+}
+
+void setUseTextBatching(GameFlow* gf, bool enabled) {
+    gf->textBatch.useBatching = enabled;
+}
+
+void setUseBirdPoseCache(bool enabled) {
+    BirdAnimData::usePoseCache = enabled;
+}
+
+void setUseTitleLayerCache(GameFlow* gf, bool enabled) {
+    gf->useTitleLayerCache = enabled;
+}
+
+void setDynamicResolution(GameFlow* gf, float frameBudget) {
+    gf->dynRes = {};
+    gf->dynRes.frameBudget = frameBudget;
+}
+
+const RenderStats& getRenderStats(GameFlow* gf) {
+    return gf->renderStats;
+}
+
+LoadStats getLoadStats() {
+    const Assets* a = Assets::instance;
+    LoadStats stats;
+    stats.fontSeconds = a->fontLoadSeconds;
+    stats.fontBakeSeconds = a->fontLoadInfo.bakeSeconds;
+    stats.fontFromCache = a->fontLoadInfo.fromCache;
+    return stats;
+}
+
+void benchmarkSDFFontBake(StringView ttfBuffer, ArrayView<const float> pixelHeights,
+                          u32 numThreads) {
+    Array<SDFFontDesc> descs;
+    for (float pixelHeight : pixelHeights) {
+        SDFFontDesc& desc = descs.append();
+        desc.pixelHeight = pixelHeight;
+        // The default atlas fits the game's 48px font
+        desc.atlasSize = (pixelHeight > 48.f ? 1024 : 512);
+    }
+    bakeSDFFonts(ttfBuffer, descs.view(), numThreads);
+}
+
+void startRecording(GameFlow* gf) {
+    u64 seed = Random{}.next64();
+    gf->replay.clear();
+    gf->recording = new Recording;
+    gf->recording->seed = seed;
+    gf->recording->simulationTimeStep = gf->simulationTimeStep;
+    gf->recording->sweptCollision = gf->sweptCollision;
+    gf->restartWithSeed(seed);
+}
+
+bool saveRecording(GameFlow* gf, StringView path) {
+    if (!gf->recording)
+        return false;
+    gf->recording->numSteps = gf->stepIndex;
+    FSResult result =
+        FileSystem::native()->makeDirsAndSaveBinaryIfDifferent(path, gf->recording->save());
+    return result == FSResult::OK || result == FSResult::Unchanged;
+}
+
+bool startReplay(GameFlow* gf, StringView recordingPath, u32 hashInterval,
+                 StringView hashesPath) {
+    String data = FileSystem::native()->loadBinary(recordingPath);
+    if (FileSystem::native()->lastResult() != FSResult::OK)
+        return false;
+    Owned<Recording> recording = Recording::load(data);
+    if (!recording)
+        return false;
+
+    gf->recording.clear();
+    gf->replay = new Replay;
+    gf->replay->recording = std::move(recording);
+    gf->replay->hashInterval = hashInterval;
+    gf->replayHashesPath = hashesPath;
+    gf->simulationTimeStep = gf->replay->recording->simulationTimeStep;
+    gf->sweptCollision = gf->replay->recording->sweptCollision;
+    gf->restartWithSeed(gf->replay->recording->seed);
+    return true;
+}
+
+bool isReplaying(GameFlow* gf) {
+    return (bool) gf->replay;
+}
+
+void finishReplay(GameFlow* gf) {
+    if (gf->replayHashesPath) {
+        FileSystem::native()->makeDirsAndSaveTextIfDifferent(
+            gf->replayHashesPath, gf->replay->hashesToText(), TextFormat::platformPreference());
+    }
+    gf->replay.clear();
 }
 
 void togglePause(GameFlow* gf) {
@@ -92,8 +250,14 @@ void onBackPressed(GameFlow* gf) {
 #if PLY_TARGET_ANDROID
         exitAppFromBackButton();
 #endif
-    } else {
-        gf->backToTitle();
+    } else if (!gf->replay) {
+        Recording::Event event;
+        event.step = gf->stepIndex;
+        event.type = Recording::Event::Back;
+        if (gf->recording) {
+            gf->recording->events.append(event);
+        }
+        applyInput(gf->gameState, event);
     }
 }
 
@@ -109,6 +273,12 @@ void update(GameFlow* gf, float dt) {
     while (gf->fracTime >= gf->simulationTimeStep) {
         gf->fracTime -= gf->simulationTimeStep;
 
+        if (gf->replay) {
+            while (const Recording::Event* event = gf->replay->popEvent(gf->stepIndex)) {
+                applyInput(gf->gameState, *event);
+            }
+        }
+
         if (gf->musicCountdown > 0) {
             gf->musicCountdown -= gf->simulationTimeStep;
             if (gf->musicCountdown <= 0) {
@@ -132,6 +302,14 @@ void update(GameFlow* gf, float dt) {
             }
         }
 
+        gf->stepIndex++;
+        if (gf->replay) {
+            gf->replay->onStepComplete(gf->gameState, gf->stepIndex);
+            if (gf->replay->isFinished(gf->stepIndex)) {
+                finishReplay(gf);
+            }
+        }
+
         if (auto trans = gf->trans.on()) {
             trans->frac[0] = trans->frac[1];
             trans->frac[1] += gf->simulationTimeStep * 2.f;
@@ -147,18 +325,21 @@ void update(GameFlow* gf, float dt) {
     }
 }
 
-void init(StringView assetsPath) {
+void init(StringView assetsPath, StringView cachePath) {
     gSoLoud.init();
-    Assets::load(assetsPath);
+    Assets::load(assetsPath, cachePath);
 }
 
 void reloadAssets() {
     String rootPath = Assets::instance->rootPath;
-    Assets::load(rootPath);
+    String cachePath = Assets::instance->cachePath;
+    Assets::load(rootPath, cachePath);
 }
 
 void shutdown() {
     Assets::instance.clear();
+    SimAssets::instance = nullptr;
+    CameraUniforms::instance = nullptr;
     gSoLoud.deinit();
 }
 
@@ -188,3 +369,5 @@ void stopMusic(GameFlow* gf) {
 } // namespace flap
 
 #include "codegen/GameFlow.inl"
+
+#endif // !FLAPGAME_HEADLESS
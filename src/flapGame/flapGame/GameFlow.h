@@ -1,13 +1,50 @@
 #pragma once
 #include <flapGame/Core.h>
 #include <flapGame/GLHelpers.h>
+#include <flapGame/DrawList.h>
+#include <flapGame/Text.h>
 #include <flapGame/GameState.h>
+#include <flapGame/Replay.h>
 #include <flapGame/Public.h>
 
 namespace flap {
 
+// Chooses the scale at which render() draws the game from a rolling average of the frame time.
+// The scale drops one step soon after the average goes over budget, but only rises again after it
+// has stayed within budget for raiseDelay seconds. raiseDelay doubles after every drop, so the
+// scale settles instead of oscillating around the budget.
+struct DynamicResolution {
+    static constexpr u32 NumSteps = 6; // 1.0, 0.9, ..., 0.5
+    static constexpr float ScaleStep = 0.1f;
+    static constexpr float AveragingTime = 0.25f; // Time constant of the rolling average
+    static constexpr float MaxFrameTime = 0.1f;   // Longer frames are clamped, such as hitches
+    static constexpr float DropDelay = 0.25f;
+    static constexpr float MinRaiseDelay = 2.f;
+    static constexpr float MaxRaiseDelay = 32.f;
+
+    float frameBudget = 0; // Zero when disabled
+    u32 step = 0;
+    float avgFrameTime = 0;
+    float timeOverBudget = 0;
+    float timeWithinBudget = 0;
+    float raiseDelay = MinRaiseDelay;
+    u32 numChanges = 0;
+
+    PLY_INLINE float scale() const {
+        return 1.f - this->step * ScaleStep;
+    }
+    void update(float frameTime);
+};
+
 struct GameFlow final : GameState::OuterContext {
     DynamicArrayBuffers dynBuffers;
+    GLStateCache glState;
+    TextLayoutCache textCache;
+    TextBatch textBatch;
+    DrawList drawList;
+    RenderStats renderStats;
+    bool useTitleLayerCache = true;
+    DynamicResolution dynRes;
 
     struct Transition {
         // ply make switch
@@ -27,9 +64,18 @@ struct GameFlow final : GameState::OuterContext {
     float musicCountdown = 0.f;
     SoLoud::handle titleMusicVoice = 0;
 
+    // Recording & replay
+    u32 stepIndex = 0; // Number of simulation steps since recording or replay started
+    Owned<Recording> recording;
+    Owned<Replay> replay;
+    String replayHashesPath;
+
     // Temporary buffers used for manual color correction (Android)
     Texture fullScreenTex;
     RenderToTexture fullScreenRTT;
+    // Offscreen target used when dynRes scales the game down
+    Texture scaledTex;
+    RenderToTexture scaledRTT;
 
     GameFlow();
 
@@ -37,6 +83,7 @@ struct GameFlow final : GameState::OuterContext {
     virtual void onRestart() override;
     virtual void backToTitle() override;
     void resetGame(bool isPlaying);
+    void restartWithSeed(u64 seed);
 };
 
 } // namespace flap
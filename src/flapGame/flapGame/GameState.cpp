@@ -1,45 +1,83 @@
 #include <flapGame/Core.h>
 #include <flapGame/GameState.h>
-#include <flapGame/Assets.h>
+#include <flapGame/SimAssets.h>
+#include <flapGame/Audio.h>
 #include <flapGame/Collision.h>
-#include <ply-runtime/algorithm/Find.h>
+#include <flapGame/Hash.h>
+#include <flapGame/BirdBatch.h>
 
 namespace flap {
 
 constexpr bool GODMODE = false;
-extern SoLoud::Soloud gSoLoud; // SoLoud engine
 
-UpdateContext* UpdateContext::instance_ = nullptr;
+thread_local UpdateContext* UpdateContext::instance_ = nullptr;
 constexpr float GameState::DefaultAngle;
 constexpr float GameState::SlowMotionFactor;
 
-bool Pipe::collisionCheck(GameState* gs, const LambdaView<bool(const Hit&)>& cb) {
+Obstacle::Hit makePipeHit(const ObstacleRecord* rec, const SphCylCollResult& result) {
+    PLY_ASSERT(result.penetrationDepth >= -1e-6f);
+    Obstacle::Hit hit;
+    hit.pos = result.pos;
+    hit.norm = result.norm;
+    hit.obst = rec;
+    hit.penetrationDepth = result.penetrationDepth;
+    if (result.norm.z > 0.1f) {
+        // hit top
+        hit.recoverClockwise = true;
+    } else if (result.norm.z < -0.1f) {
+        // hit bottom
+        hit.recoverClockwise = false;
+    } else {
+        // hit side; recover clockwise if pipe is rightside-up
+        hit.recoverClockwise = (rec->pipeToWorld.asFloat3x3() * Float3{0, 0, 1}).z > 0;
+    }
+    return hit;
+}
+
+bool ObstacleRecord::collisionCheck(GameState* gs,
+                                    const LambdaView<bool(const Obstacle::Hit&)>& cb) const {
+    if (this->type == Custom) {
+        return this->custom->collisionCheck(gs, [&](const Obstacle::Hit& customHit) {
+            Obstacle::Hit hit = customHit;
+            hit.obst = this;
+            return cb(hit);
+        });
+    }
+
     SphCylCollResult result;
     SphCylCollResult::Type ct = sphereCylinderCollisionTest(
         gs->bird.pos[0], GameState::BirdRadius, this->pipeToWorld, GameState::PipeRadius, &result);
     if (ct != SphCylCollResult::None) {
-        PLY_ASSERT(result.penetrationDepth >= -1e-6f);
-        Hit hit;
-        hit.pos = result.pos;
-        hit.norm = result.norm;
-        hit.obst = this;
-        hit.penetrationDepth = result.penetrationDepth;
-        if (result.norm.z > 0.1f) {
-            // hit top
-            hit.recoverClockwise = true;
-        } else if (result.norm.z < -0.1f) {
-            // hit bottom
-            hit.recoverClockwise = false;
-        } else {
-            // hit side; recover clockwise if pipe is rightside-up
-            hit.recoverClockwise = (this->pipeToWorld.asFloat3x3() * Float3{0, 0, 1}).z > 0;
-        }
-        return cb(hit);
+        return cb(makePipeHit(this, result));
     }
     return false;
 }
 
-Obstacle::TeleportResult Pipe::teleportCheck(GameState* gs) {
+bool ObstacleRecord::sweptCollisionCheck(GameState* gs, const Float3& from, const Float3& to,
+                                         float* outTime, Obstacle::Hit* outHit) const {
+    if (this->type == Custom) {
+        *outTime = 0;
+        return this->collisionCheck(gs, [&](const Obstacle::Hit& hit) {
+            *outHit = hit;
+            return true;
+        });
+    }
+
+    SphCylCollResult result;
+    SphCylCollResult::Type ct =
+        sweptSphereCylinderCollisionTest(from, to, GameState::BirdRadius, this->pipeToWorld,
+                                         GameState::PipeRadius, outTime, &result);
+    if (ct != SphCylCollResult::None) {
+        *outHit = makePipeHit(this, result);
+        return true;
+    }
+    return false;
+}
+
+Obstacle::TeleportResult ObstacleRecord::teleportCheck(GameState* gs) const {
+    if (this->type == Custom)
+        return this->custom->teleportCheck(gs);
+
     // Only works on upright pipes
     if (this->pipeToWorld[2].z >= 0.8f) {
         Float3 posRelPipe = this->pipeToWorld.invertedOrtho() * gs->bird.pos[0];
@@ -51,7 +89,10 @@ Obstacle::TeleportResult Pipe::teleportCheck(GameState* gs) {
     return {};
 }
 
-bool Pipe::canEjectFrom(Float3* outPos) {
+bool ObstacleRecord::canEjectFrom(Float3* outPos) const {
+    if (this->type == Custom)
+        return this->custom->canEjectFrom(outPos);
+
     // Only works on upright pipes
     if (this->pipeToWorld[2].z >= 0.8f) {
         *outPos = this->pipeToWorld[3];
@@ -60,20 +101,97 @@ bool Pipe::canEjectFrom(Float3* outPos) {
     return false;
 }
 
-void Pipe::adjustX(float amount) {
-    this->pipeToWorld[3].x += amount;
+void ObstacleRecord::adjustX(float amount) {
+    if (this->type == Custom) {
+        this->custom->adjustX(amount);
+    } else {
+        this->pipeToWorld[3].x += amount;
+    }
 }
 
-bool Pipe::canRemove(float leftEdge) {
+bool ObstacleRecord::canRemove(float leftEdge) const {
+    if (this->type == Custom)
+        return this->custom->canRemove(leftEdge);
+
     return this->pipeToWorld[3].x < leftEdge - 20;
 }
 
+void ObstacleRecord::getXExtent(float* outMinX, float* outMaxX) const {
+    if (this->type == Custom) {
+        this->custom->getXExtent(outMinX, outMaxX);
+        return;
+    }
+
+    // The pipe is an infinite cylinder extending down its -Z axis. Clip the axis to the range of
+    // heights covered by the index.
+    Float3 cap = this->pipeToWorld[3];
+    Float3 axis = this->pipeToWorld[2] * -1.f;
+    float minX = cap.x;
+    float maxX = cap.x;
+    if (fabsf(axis.z) < 0.001f) {
+        // Horizontal pipe
+        if (cap.z >= GameState::IndexMinZ && cap.z <= GameState::IndexMaxZ) {
+            minX = (axis.x < 0 ? -1e30f : cap.x);
+            maxX = (axis.x > 0 ? 1e30f : cap.x);
+        }
+    } else {
+        float t0 = (GameState::IndexMinZ - cap.z) / axis.z;
+        float t1 = (GameState::IndexMaxZ - cap.z) / axis.z;
+        float tLo = max(0.f, min(t0, t1));
+        float tHi = max(tLo, max(t0, t1));
+        float x0 = cap.x + axis.x * tLo;
+        float x1 = cap.x + axis.x * tHi;
+        minX = min(minX, min(x0, x1));
+        maxX = max(maxX, max(x0, x1));
+    }
+    *outMinX = minX - GameState::PipeRadius;
+    *outMaxX = maxX + GameState::PipeRadius;
+}
+
+void ObstacleRecord::hashState(StateHasher* hasher) const {
+    if (this->type == Custom) {
+        this->custom->hashState(hasher);
+    } else {
+        hasher->append(this->pipeToWorld);
+    }
+}
+
+ObstacleRecord* ObstaclePool::append(ObstacleRecord::Type type) {
+    u32 j = this->head + this->count;
+    if (j / ChunkSize >= this->chunks.numItems()) {
+        if (this->freeChunks.isEmpty()) {
+            this->chunks.append(new Chunk);
+            this->numChunkAllocations++;
+        } else {
+            this->chunks.append(std::move(this->freeChunks.back()));
+            this->freeChunks.pop();
+        }
+    }
+    ObstacleRecord* rec = &this->chunks[j / ChunkSize]->records[j % ChunkSize];
+    rec->type = type;
+    rec->serial = this->nextSerial++;
+    this->count++;
+    return rec;
+}
+
+void ObstaclePool::popFront() {
+    PLY_ASSERT(this->count > 0);
+    ObstacleRecord& rec = (*this)[0];
+    rec.custom.clear();
+    this->head++;
+    this->count--;
+    if (this->head >= ChunkSize) {
+        // Recycle the first chunk
+        this->freeChunks.append(std::move(this->chunks[0]));
+        this->chunks.erase(0);
+        this->head = 0;
+    }
+}
+
 void onEndSequence(GameState* gs, float xEndSeqRelWorld, bool wasSlanted);
 
 struct PipeSequence : ObstacleSequence {
-    u32 pipeIndex = 0;
-
-    PipeSequence(float xSeqRelWorld) : ObstacleSequence{xSeqRelWorld} {
+    PipeSequence(float xSeqRelWorld) : ObstacleSequence{Pipe, xSeqRelWorld} {
     }
 
     virtual bool advanceTo(GameState* gs, float xVisRelWorld) override {
@@ -84,12 +202,10 @@ struct PipeSequence : ObstacleSequence {
 
             // Add new obstacles
             float gapHeight = mix(-5.f, 5.5f, gs->random.nextFloat());
-            gs->playfield.obstacles.append(
-                new Pipe{Float3x4::makeTranslation({pipeX, 0, gapHeight - 4.f})});
-            gs->playfield.obstacles.append(
-                new Pipe{Float3x4::makeTranslation({pipeX, 0, gapHeight + 4.f}) *
-                         Float3x4::makeRotation({1, 0, 0}, Pi)});
-            gs->playfield.sortedCheckpoints.append(pipeX);
+            gs->playfield.addPipe(Float3x4::makeTranslation({pipeX, 0, gapHeight - 4.f}));
+            gs->playfield.addPipe(Float3x4::makeTranslation({pipeX, 0, gapHeight + 4.f}) *
+                                  Float3x4::makeRotation({1, 0, 0}, Pi));
+            gs->playfield.checkpoints.push(pipeX);
             this->pipeIndex++;
 
             if (this->pipeIndex >= 10) {
@@ -102,9 +218,7 @@ struct PipeSequence : ObstacleSequence {
 };
 
 struct SlantedPipeSequence : ObstacleSequence {
-    u32 pipeIndex = 0;
-
-    SlantedPipeSequence(float xSeqRelWorld) : ObstacleSequence{xSeqRelWorld} {
+    SlantedPipeSequence(float xSeqRelWorld) : ObstacleSequence{SlantedPipe, xSeqRelWorld} {
     }
 
     virtual bool advanceTo(GameState* gs, float xVisRelWorld) override {
@@ -120,16 +234,22 @@ struct SlantedPipeSequence : ObstacleSequence {
 
             // Add new pipes
             float gapHeight = mix(-4.f, 4.f, gs->random.nextFloat());
-            gs->playfield.obstacles.append(
-                new Pipe{Float3x4::makeTranslation({pipeX, 0, gapHeight + 4.f}) *
-                         Float3x4::makeRotation({0, 1, 0}, -Pi / 4)});
-            gs->playfield.sortedCheckpoints.append(pipeX);
+            gs->playfield.addPipe(Float3x4::makeTranslation({pipeX, 0, gapHeight + 4.f}) *
+                                  Float3x4::makeRotation({0, 1, 0}, -Pi / 4));
+            gs->playfield.checkpoints.push(pipeX);
             this->pipeIndex++;
         }
         return true;
     }
 };
 
+Owned<ObstacleSequence> ObstacleSequence::create(Type type, float xSeqRelWorld) {
+    if (type == SlantedPipe) {
+        return new SlantedPipeSequence{xSeqRelWorld};
+    }
+    return new PipeSequence{xSeqRelWorld};
+}
+
 FallAnimFrame sample(ArrayView<const FallAnimFrame> frames, float t) {
     PLY_ASSERT(frames.numItems > 0);
     if (t < 0) {
@@ -161,7 +281,6 @@ Float3 toAxisAngle(const Quaternion& quat) {
 }
 
 void applyBounce(const Obstacle::Hit& hit, Float3 prevVel) {
-    Assets* a = Assets::instance;
     UpdateContext* uc = UpdateContext::instance();
     GameState* gs = uc->gs;
     auto falling = gs->mode.falling();
@@ -173,8 +292,8 @@ void applyBounce(const Obstacle::Hit& hit, Float3 prevVel) {
         // Bouncing
         if (falling->bounceCount > 0) {
             float rate = mix(0.94f, 1.07f, gs->random.nextFloat()) * 0.9f;
-            SoLoud::handle h = gSoLoud.play(a->bounceSound, mix(0.8f, 0.01f, powf(1.05f, d + 5.f)));
-            gSoLoud.setRelativePlaySpeed(h, rate);
+            Voice h = playSound(Sound::Bounce, mix(0.8f, 0.01f, powf(1.05f, d + 5.f)));
+            setVoiceSpeed(h, rate);
         }
         bounceVel = prevVel - hit.norm * min(0.f, 1.6f * d + 1.0f);
         bounceVel.x = clamp(bounceVel.x, -15.f, 15.f);
@@ -236,27 +355,20 @@ void applyBounce(const Obstacle::Hit& hit, Float3 prevVel) {
     falling->prevBouncePos = gs->bird.pos[0];
 }
 
-Float3 advanceToEjectPos(const Obstacle* startObst) {
+Float3 advanceToEjectPos(const ObstacleRecord* startObst) {
     UpdateContext* uc = UpdateContext::instance();
     GameState* gs = uc->gs;
 
-    s32 obstIndex = find(gs->playfield.obstacles, startObst);
-    PLY_ASSERT(obstIndex >= 0);
+    u32 obstIndex = gs->playfield.obstacles.indexOf(startObst);
     obstIndex++;
     u32 candidateCount = 0;
     for (;;) {
-        while ((u32) obstIndex >= gs->playfield.obstacles.numItems()) {
+        while (obstIndex >= gs->playfield.obstacles.numItems()) {
             gs->playfield.spawnedToX += 2.f;
-            for (u32 i = 0; i < gs->playfield.sequences.numItems();) {
-                if (gs->playfield.sequences[i]->advanceTo(gs, gs->playfield.spawnedToX)) {
-                    i++;
-                } else {
-                    gs->playfield.sequences.eraseQuick(i);
-                }
-            }
+            gs->playfield.advanceSequences(gs);
         }
         Float3 ejectPos = {0, 0, 0};
-        if (gs->playfield.obstacles[obstIndex]->canEjectFrom(&ejectPos)) {
+        if (gs->playfield.obstacles[obstIndex].canEjectFrom(&ejectPos)) {
             if (candidateCount >= 3) {
                 return ejectPos;
             }
@@ -266,18 +378,38 @@ Float3 advanceToEjectPos(const Obstacle* startObst) {
     }
 }
 
-float getTargetAngle(float zVel) {
-    float targetAngle = -0.1 * Pi;
-    targetAngle += -clamp(zVel, -15.f, 15.f) * 0.01f;
-    float excess = max(0.f, -15.f - zVel);
-    if (excess > 0) {
-        targetAngle += min(excess * 0.04f, 0.55f * Pi);
+// Finds the earliest obstacle hit along the bird's path from one position to another, ignoring
+// surfaces that the bird is moving away from. outTime is the fraction of the path at contact.
+static bool findFirstSweptHit(GameState* gs, const Float3& from, const Float3& to,
+                              const Float3& vel, float* outTime, Obstacle::Hit* outHit) {
+    bool found = false;
+    for (const ObstacleIndex::Entry& entry : gs->playfield.getObstaclesAlong(from, to)) {
+        float time = 0;
+        Obstacle::Hit hit;
+        if (entry.obst->sweptCollisionCheck(gs, from, to, &time, &hit) &&
+            dot(vel, hit.norm) < 0 && (!found || time < *outTime)) {
+            found = true;
+            *outTime = time;
+            *outHit = hit;
+        }
     }
-    return targetAngle;
+    return found;
+}
+
+static Float3 stepFallVel(const Float3& vel0, const Float3& vel1, float dt) {
+    Float3 result = vel1 * 0.99f;
+    result.z = max(vel0.z - GameState::NormalGravity * dt, GameState::TerminalVelocity);
+    return result;
+}
+
+static Float3 stepFallPos(const Float3& pos0, const Float3& vel0, const Float3& vel1, float dt) {
+    Float3 result = pos0 + (vel0 + vel1) * 0.5f * dt;
+    result.y = clamp(result.y, -4.f, 4.f);
+    return result;
 }
 
 void updateMovement(UpdateContext* uc) {
-    Assets* a = Assets::instance;
+    const SimAssets* a = SimAssets::instance;
     GameState* gs = uc->gs;
     float dt = gs->outerCtx->simulationTimeStep;
 
@@ -295,13 +427,13 @@ void updateMovement(UpdateContext* uc) {
             gs->puffs.append(new Puffs{gs->bird.pos[0], gs->random.next32()});
             if (gs->flapVoice != -1) {
                 // Stop previous flap sound
-                gSoLoud.fadeVolume(gs->flapVoice, 0.f, 0.15f);
+                fadeVoice(gs->flapVoice, 0.f, 0.15f);
             }
             // Play new flap sound
-            u32 flapNum = gs->random.next32() % a->flapSounds.numItems();
+            u32 flapNum = gs->random.next32() % NumFlapSounds;
             float rate = powf(2.f, mix(-0.08f, 0.08f, gs->random.nextFloat()) + flapNum * 0.02f);
-            gs->flapVoice = gSoLoud.play(a->flapSounds[flapNum], 2.f);
-            gSoLoud.setRelativePlaySpeed(gs->flapVoice, rate);
+            gs->flapVoice = playSound(Sound::Flap, 2.f, flapNum);
+            setVoiceSpeed(gs->flapVoice, rate);
         }
 
         // Get time dilation
@@ -324,10 +456,9 @@ void updateMovement(UpdateContext* uc) {
             applyGravity = trans->param > 0.5f || playing->curGravity == GameState::NormalGravity;
         }
         if (applyGravity) {
-            playing->curGravity = approach(playing->curGravity, GameState::NormalGravity,
-                                           dtScaled * playing->gravApproach);
-            playing->zVel[1] =
-                max(playing->zVel[0] - playing->curGravity * dtScaled, GameState::TerminalVelocity);
+            playing->curGravity =
+                stepGravity(playing->curGravity, playing->gravApproach, dtScaled);
+            playing->zVel[1] = stepZVel(playing->zVel[0], playing->curGravity, dtScaled);
         }
 
         // Check for impacts
@@ -341,7 +472,7 @@ void updateMovement(UpdateContext* uc) {
             if (hit.obst) {
                 Obstacle::TeleportResult tr = hit.obst->teleportCheck(gs);
                 if (tr.entered) {
-                    gSoLoud.play(a->enterPipeSound, 0.7f);
+                    playSound(Sound::EnterPipe, 0.7f);
                     auto teleport = gs->mode.teleport().switchTo();
                     teleport->startPos = gs->bird.pos[0];
                     teleport->startPipeCenter = tr.entrance.pos;
@@ -356,9 +487,9 @@ void updateMovement(UpdateContext* uc) {
             impact->prevVel = prevVel;
             impact->hit = hit;
             impact->time = 0;
-            gSoLoud.play(a->playerHitSound, 0.7f);
+            playSound(Sound::PlayerHit, 0.7f);
             if (gs->wobbleVoice != -1) {
-                gSoLoud.fadeVolume(gs->wobbleVoice, 0.f, 0.15f);
+                fadeVoice(gs->wobbleVoice, 0.f, 0.15f);
             }
             return true;
         };
@@ -369,29 +500,38 @@ void updateMovement(UpdateContext* uc) {
             hit.pos = {gs->bird.pos[0].x, gs->bird.pos[0].y, GameState::LowestHeight - 1.f};
             hit.norm = {0, 0, 1};
             doImpact(hit);
+        } else if (gs->outerCtx->sweptCollision) {
+            // Check for obstacle collisions along the bird's path during this step
+            Float3 from = gs->bird.pos[0];
+            Float3 to = stepBirdPos(from, playing->zVel[0], playing->zVel[1], dtScaled);
+            float time = 0;
+            Obstacle::Hit hit;
+            if (findFirstSweptHit(gs, from, to, birdVel0, &time, &hit)) {
+                // Move the bird to the point of contact
+                gs->bird.pos[0] = mix(from, to, time);
+                doImpact(hit);
+            }
         } else {
             // Check for obstacle collisions
-            u32 checkLimit = gs->playfield.obstacles.numItems();
-            for (u32 i = 0; i < checkLimit; i++) {
-                if (gs->playfield.obstacles[i]->collisionCheck(gs, doImpact))
+            for (const ObstacleIndex::Entry& entry :
+                 gs->playfield.getNearbyObstacles(gs->bird.pos[0])) {
+                if (entry.obst->collisionCheck(gs, doImpact))
                     break;
             }
         }
 
-        // Advance bird
-        if (playing) {
-            Float3 midVel = {GameState::ScrollRate, 0,
-                             (playing->zVel[0] + playing->zVel[1]) * 0.5f};
-            gs->bird.pos[1] = gs->bird.pos[0] + midVel * dtScaled;
-            gs->bird.pos[1].z = min(gs->bird.pos[1].z, 22.f);
+        // Advance bird, unless an impact or teleport changed the mode
+        if (gs->mode.playing()) {
+            gs->bird.pos[1] =
+                stepBirdPos(gs->bird.pos[0], playing->zVel[0], playing->zVel[1], dtScaled);
 
             // Rotation
-            float useZ = playing->zVel[1];
-            useZ *= 1.f + (GameState::NormalGravity - playing->curGravity) * 0.012f;
             auto angle = gs->rotator.angle();
-            float delta = getTargetAngle(useZ) - angle->angle;
-            float sgn = delta > 0 ? 1.f : -1.f;
-            angle->angle += sgn * min(dt * 12.f, delta * sgn * 0.15f);
+            angle->angle =
+                stepBirdAngle(angle->angle, playing->zVel[1], playing->curGravity, dt);
+        } else {
+            // Stay at the point of contact
+            gs->bird.pos[1] = gs->bird.pos[0];
         }
     } else if (auto teleport = gs->mode.teleport()) {
         float cameraDelay = 0.1f;
@@ -437,7 +577,7 @@ void updateMovement(UpdateContext* uc) {
             angle->angle = getTargetAngle(exitZVel) + (duration - teleport->time) * 2.5f;
         }
         if (teleport->time >= duration - 0.2f && !teleport->didPlayPop) {
-            gSoLoud.play(a->exitPipeSound);
+            playSound(Sound::ExitPipe);
             teleport->didPlayPop = true;
         }
         if (teleport->time >= duration - 0.1f && !teleport->didPuff) {
@@ -490,7 +630,7 @@ void updateMovement(UpdateContext* uc) {
                 gs->rotator.fromMode().switchTo();
                 applyBounce(hit, prevVel);
                 if (gs->bird.pos[0].z > -8.f) {
-                    gSoLoud.play(a->fallSound);
+                    playSound(Sound::Fall);
                 }
             }
         }
@@ -500,7 +640,7 @@ void updateMovement(UpdateContext* uc) {
         float ooDur = 1.f / dur;
         if (!recovering->playedSound && recovering->time >= 0.1f) {
             recovering->playedSound = true;
-            gs->wobbleVoice = gSoLoud.play(a->wobbleSound, 0.35f);
+            gs->wobbleVoice = playSound(Sound::Wobble, 0.35f);
         }
         if (recovering->time < recovering->totalTime) {
             // sample the curve
@@ -569,22 +709,37 @@ void updateMovement(UpdateContext* uc) {
             applyBounce(hit, free->vel[0]);
         }
 
-        if (free) {
-            for (Obstacle* obst : gs->playfield.obstacles) {
-                if (obst->collisionCheck(gs, bounce))
-                    break;
+        if (falling->mode.free()) {
+            if (gs->outerCtx->sweptCollision) {
+                // Check for obstacle collisions along the bird's path during this step
+                Float3 from = gs->bird.pos[0];
+                Float3 vel1 = stepFallVel(free->vel[0], free->vel[1], dt);
+                Float3 to = stepFallPos(from, free->vel[0], vel1, dt);
+                float time = 0;
+                Obstacle::Hit hit;
+                if (findFirstSweptHit(gs, from, to, free->vel[0], &time, &hit)) {
+                    // Move the bird to the point of contact
+                    gs->bird.pos[0] = mix(from, to, time);
+                    bounce(hit);
+                    if (!falling->mode.free()) {
+                        // The bounce animation starts from the point of contact
+                        gs->bird.pos[1] = gs->bird.pos[0];
+                    }
+                }
+            } else {
+                for (const ObstacleIndex::Entry& entry :
+                     gs->playfield.getNearbyObstacles(gs->bird.pos[0])) {
+                    if (entry.obst->collisionCheck(gs, bounce))
+                        break;
+                }
             }
         }
 
-        if (free) {
-            free->vel[1] *= 0.99f;
-            free->vel[1].z =
-                max(free->vel[0].z - GameState::NormalGravity * dt, GameState::TerminalVelocity);
+        if (falling->mode.free()) {
+            free->vel[1] = stepFallVel(free->vel[0], free->vel[1], dt);
 
             // Advance bird
-            Float3 midVel = (free->vel[0] + free->vel[1]) * 0.5f;
-            gs->bird.pos[1] = gs->bird.pos[0] + midVel * dt;
-            gs->bird.pos[1].y = clamp(gs->bird.pos[1].y, -4.f, 4.f);
+            gs->bird.pos[1] = stepFallPos(gs->bird.pos[0], free->vel[0], free->vel[1], dt);
         }
     }
 }
@@ -601,12 +756,11 @@ void adjustX(GameState* gs, float amount) {
     for (ObstacleSequence* seq : gs->playfield.sequences) {
         seq->xSeqRelWorld += amount;
     }
-    for (Obstacle* obst : gs->playfield.obstacles) {
-        obst->adjustX(amount);
-    }
-    for (float& sc : gs->playfield.sortedCheckpoints) {
-        sc += amount;
+    for (u32 i = 0; i < gs->playfield.obstacles.numItems(); i++) {
+        gs->playfield.obstacles[i].adjustX(amount);
     }
+    gs->playfield.index.adjustX(amount);
+    gs->playfield.checkpoints.adjustX(amount);
     if (auto teleport = gs->mode.teleport()) {
         teleport->startPos.x += amount;
         teleport->startPipeCenter.x += amount;
@@ -718,7 +872,6 @@ void doInput(GameState* gs, const Float2& pos, bool down) {
 }
 
 void timeStep(UpdateContext* uc) {
-    Assets* a = Assets::instance;
     GameState* gs = uc->gs;
     float dt = gs->outerCtx->simulationTimeStep;
 
@@ -762,14 +915,13 @@ void timeStep(UpdateContext* uc) {
             if (gs->mode.teleport()) {
                 checkX = gs->bird.aimTarget[0].x;
             }
-            while (!gs->playfield.sortedCheckpoints.isEmpty() &&
-                   checkX >= gs->playfield.sortedCheckpoints[0]) {
-                gs->playfield.sortedCheckpoints.erase(0);
+            u32 numPassed = gs->playfield.checkpoints.passUpTo(checkX);
+            for (u32 i = 0; i < numPassed; i++) {
                 gs->score++;
 
                 const auto& toneParams = NoteMap[gs->note];
-                int handle = gSoLoud.play(a->passNotes[toneParams.first], 1.f);
-                gSoLoud.setRelativePlaySpeed(handle, powf(2.f, toneParams.second / 12.f));
+                Voice handle = playSound(Sound::PassNote, 1.f, toneParams.first);
+                setVoiceSpeed(handle, powf(2.f, toneParams.second / 12.f));
                 gs->note = (gs->note + 1) % NoteMap.numItems();
                 gs->scoreTime[0] = 1.f;
                 gs->scoreTime[1] = 1.f;
@@ -929,19 +1081,13 @@ void timeStep(UpdateContext* uc) {
 
         // Add new obstacles
         gs->playfield.spawnedToX = max(gs->playfield.spawnedToX, visibleEdge);
-        for (u32 i = 0; i < gs->playfield.sequences.numItems();) {
-            if (gs->playfield.sequences[i]->advanceTo(gs, gs->playfield.spawnedToX)) {
-                i++;
-            } else {
-                gs->playfield.sequences.eraseQuick(i);
-            }
-        }
+        gs->playfield.advanceSequences(gs);
 
         // Remove old obstacles
         while (gs->playfield.obstacles.numItems() > 1) {
-            if (!gs->playfield.obstacles[0]->canRemove(invisibleEdge))
+            if (!gs->playfield.obstacles[0].canRemove(invisibleEdge))
                 break;
-            gs->playfield.obstacles.erase(0);
+            gs->playfield.removeOldestObstacle();
         }
     }
 
@@ -958,14 +1104,14 @@ void timeStep(UpdateContext* uc) {
         if (dead->delay > 0) {
             dead->delay -= dt;
             if (dead->delay <= 0) {
-                gSoLoud.play(a->finalScoreSound);
+                playSound(Sound::FinalScore);
             }
         } else {
             // Animate high score signs
             dead->animateSignTime = min(dead->animateSignTime + dt, 5.f);
             if (!dead->playedSound && dead->animateSignTime > 0.25f) {
-                SoLoud::handle h = gSoLoud.play(a->finalScoreSound, 0.6f);
-                gSoLoud.setRelativePlaySpeed(h, 0.9f);
+                Voice h = playSound(Sound::FinalScore, 0.6f);
+                setVoiceSpeed(h, 0.9f);
                 dead->playedSound = true;
             }
 
@@ -1000,7 +1146,7 @@ struct MixCameraParams {
 };
 
 void GameState::updateCamera(bool cut) {
-    const Assets* a = Assets::instance;
+    const SimAssets* a = SimAssets::instance;
     GameState* gs = UpdateContext::instance()->gs;
     float dt = gs->outerCtx->simulationTimeStep;
     MixCameraParams params;
@@ -1040,17 +1186,82 @@ void GameState::updateCamera(bool cut) {
         truck = GameState::ScrollRate * dt;
     }
     if (truck != 0) {
-        shrubX[1] = shrubX[0] + truck * (1.f - a->shrubGroup.groupScale);
-        wrapPair(shrubX[0], shrubX[1], GameState::ShrubRepeat * a->shrubGroup.groupScale);
-        buildingX[1] = buildingX[0] + truck * (1.f - a->cityGroup.groupScale);
-        wrapPair(buildingX[0], buildingX[1], GameState::BuildingRepeat * a->cityGroup.groupScale);
+        shrubX[1] = shrubX[0] + truck * (1.f - a->shrubGroupScale);
+        wrapPair(shrubX[0], shrubX[1], GameState::ShrubRepeat * a->shrubGroupScale);
+        buildingX[1] = buildingX[0] + truck * (1.f - a->cityGroupScale);
+        wrapPair(buildingX[0], buildingX[1], GameState::BuildingRepeat * a->cityGroupScale);
         frontCloudX[1] = frontCloudX[0] + truck * 0.85f;
         wrapPair(frontCloudX[0], frontCloudX[1], 28.f);
     }
 }
 
+void GameState::Playfield::addPipe(const Float3x4& pipeToWorld) {
+    ObstacleRecord* rec = this->obstacles.append(ObstacleRecord::Pipe);
+    rec->pipeToWorld = pipeToWorld;
+    float minX = 0;
+    float maxX = 0;
+    rec->getXExtent(&minX, &maxX);
+    this->index.add(rec, minX, maxX);
+}
+
+void GameState::Playfield::addCustomObstacle(Obstacle* obst) {
+    ObstacleRecord* rec = this->obstacles.append(ObstacleRecord::Custom);
+    rec->custom = obst;
+    float minX = 0;
+    float maxX = 0;
+    rec->getXExtent(&minX, &maxX);
+    this->index.add(rec, minX, maxX);
+}
+
+void GameState::Playfield::removeOldestObstacle() {
+    ObstacleRecord* rec = &this->obstacles[0];
+    float minX = 0;
+    float maxX = 0;
+    rec->getXExtent(&minX, &maxX);
+    this->index.removeOldest(rec, minX, maxX);
+    this->obstacles.popFront();
+}
+
+void GameState::Playfield::advanceSequences(GameState* gs) {
+    for (u32 i = 0; i < this->sequences.numItems();) {
+        if (this->sequences[i]->advanceTo(gs, this->spawnedToX)) {
+            i++;
+        } else {
+            this->sequences.eraseQuick(i);
+        }
+    }
+}
+
+ArrayView<const ObstacleIndex::Entry>
+GameState::Playfield::getNearbyObstacles(const Float3& birdPos) {
+    if (birdPos.z < GameState::IndexMinZ || birdPos.z > GameState::IndexMaxZ) {
+        // Outside the range covered by the index
+        return this->index.query(-1e30f, 1e30f);
+    }
+    return this->index.query(birdPos.x - GameState::BirdRadius,
+                             birdPos.x + GameState::BirdRadius);
+}
+
+ArrayView<const ObstacleIndex::Entry> GameState::Playfield::getObstaclesAlong(const Float3& from,
+                                                                           const Float3& to) {
+    if (min(from.z, to.z) < GameState::IndexMinZ || max(from.z, to.z) > GameState::IndexMaxZ) {
+        // Outside the range covered by the index
+        return this->index.query(-1e30f, 1e30f);
+    }
+    return this->index.query(min(from.x, to.x) - GameState::BirdRadius,
+                             max(from.x, to.x) + GameState::BirdRadius);
+}
+
+void GameState::startTitle() {
+    this->mode.title().switchTo();
+    this->titleScreen = new TitleScreen;
+    this->camera.orbit().switchTo();
+    this->updateCamera(true);
+    this->sweat.time = 2;
+}
+
 void GameState::startPlaying() {
-    this->random = Random{};
+    this->random = Random{this->outerCtx->gameSeeds.next64()};
     auto playing = this->mode.playing().switchTo();
     playing->curGravity = 0.f;
     playing->gravApproach = 20.f;
@@ -1060,7 +1271,7 @@ void GameState::startPlaying() {
         auto trans = this->camera.transition().switchTo();
         trans->startAngle = wrap(startAngle + 3 * Pi / 2, 2 * Pi) - Pi;
         trans->startYRise = startYRise;
-        gSoLoud.play(Assets::instance->transitionSound, 1.f);
+        playSound(Sound::Transition, 1.f);
     } else {
         this->camera.follow().switchTo();
         this->birdAnim.eyePos[0] = 3;
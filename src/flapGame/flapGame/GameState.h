@@ -1,9 +1,12 @@
 #pragma once
 #include <flapGame/Core.h>
+#include <flapGame/Audio.h>
 #include <flapGame/TitleScreen.h>
 #include <flapGame/Puffs.h>
 #include <flapGame/Tongue.h>
 #include <flapGame/Sweat.h>
+#include <flapGame/ObstacleIndex.h>
+#include <flapGame/CheckpointQueue.h>
 
 namespace flap {
 
@@ -17,17 +20,33 @@ enum class AnimState {
 };
 
 struct GameState;
+struct StateHasher;
+struct ObstacleRecord;
+struct GameStateSnapshot;
+struct DrawList;
 
 struct ObstacleSequence {
+    enum Type : u8 {
+        Pipe,
+        SlantedPipe,
+    };
+
+    Type type = Pipe;
     float xSeqRelWorld = 0;
+    u32 pipeIndex = 0;
 
-    PLY_INLINE ObstacleSequence(float xSeqRelWorld) : xSeqRelWorld{xSeqRelWorld} {
+    PLY_INLINE ObstacleSequence(Type type, float xSeqRelWorld)
+        : type{type}, xSeqRelWorld{xSeqRelWorld} {
     }
     virtual ~ObstacleSequence() {
     }
     virtual bool advanceTo(GameState* gs, float xVisRelWorld) = 0;
+
+    static Owned<ObstacleSequence> create(Type type, float xSeqRelWorld);
 };
 
+// Interface for custom obstacle types. Pipes, which make up almost every obstacle, don't use it;
+// they're stored by value in ObstacleRecord instead.
 struct Obstacle : RefCounted<Obstacle> {
     PLY_INLINE void onRefCountZero() {
         delete this;
@@ -36,7 +55,7 @@ struct Obstacle : RefCounted<Obstacle> {
     struct Hit {
         Float3 pos = {0, 0, 0};
         Float3 norm = {0, 0, 0};
-        Reference<Obstacle> obst;
+        const ObstacleRecord* obst = nullptr; // Only valid during the collision callback
         float penetrationDepth = 0;
         bool recoverClockwise = true;
     };
@@ -49,6 +68,7 @@ struct Obstacle : RefCounted<Obstacle> {
     struct DrawParams {
         Float4x4 cameraToViewport = Float4x4::identity();
         Float4x4 worldToCamera = Float4x4::identity();
+        DrawList* drawList = nullptr; // Opaque draws can be recorded here instead of issued directly
     };
 
     virtual ~Obstacle() {
@@ -62,21 +82,78 @@ struct Obstacle : RefCounted<Obstacle> {
     }
     virtual void adjustX(float amount) = 0;
     virtual bool canRemove(float leftEdge) = 0;
+    // Range of x-coordinates that the obstacle covers between GameState::IndexMinZ and IndexMaxZ
+    virtual void getXExtent(float* outMinX, float* outMaxX) const = 0;
+    virtual void hashState(StateHasher* hasher) const = 0;
+#if !FLAPGAME_HEADLESS
     virtual void draw(const DrawParams& params) const = 0;
+#endif
 };
 
-struct Pipe : Obstacle {
-    Float3x4 pipeToWorld = Float3x4::identity();
+// An obstacle in the playfield. Dispatches on type instead of using virtual functions.
+struct ObstacleRecord {
+    enum Type : u8 {
+        Pipe,
+        Custom,
+    };
 
-    PLY_INLINE Pipe(const Float3x4& pipeToWorld) : pipeToWorld{pipeToWorld} {
-    }
+    Type type = Pipe;
+    u32 serial = 0; // Order in which the obstacle was added to the playfield
+    Float3x4 pipeToWorld = Float3x4::identity(); // Type::Pipe only
+    Reference<Obstacle> custom;                  // Type::Custom only
+
+    bool collisionCheck(GameState* gs, const LambdaView<bool(const Obstacle::Hit&)>& cb) const;
+    // Finds the first contact as the bird moves from `from` to `to`. Custom obstacles only support
+    // discrete collision checks, so their contacts are always reported at time 0.
+    bool sweptCollisionCheck(GameState* gs, const Float3& from, const Float3& to, float* outTime,
+                             Obstacle::Hit* outHit) const;
+    Obstacle::TeleportResult teleportCheck(GameState* gs) const;
+    bool canEjectFrom(Float3* outPos) const;
+    void adjustX(float amount);
+    bool canRemove(float leftEdge) const;
+    void getXExtent(float* outMinX, float* outMaxX) const;
+    void hashState(StateHasher* hasher) const;
+#if !FLAPGAME_HEADLESS
+    void draw(const Obstacle::DrawParams& params) const;
+#endif
+};
+
+// FIFO queue of ObstacleRecords stored in fixed-size chunks. Records never move once added, so
+// ObstacleIndex can point to them. Chunks are recycled instead of freed, so spawning obstacles
+// doesn't allocate memory once the pool has warmed up.
+struct ObstaclePool {
+    static constexpr u32 ChunkSize = 32;
+    struct Chunk {
+        ObstacleRecord records[ChunkSize];
+    };
+
+    Array<Owned<Chunk>> chunks;
+    Array<Owned<Chunk>> freeChunks;
+    u32 head = 0; // Index of the first record in chunks[0]
+    u32 count = 0;
+    u32 nextSerial = 0;
+    u32 numChunkAllocations = 0;
 
-    virtual bool collisionCheck(GameState* gs, const LambdaView<bool(const Hit&)>& cb) override;
-    virtual TeleportResult teleportCheck(GameState* gs) override;
-    virtual bool canEjectFrom(Float3* outPos) override;
-    virtual void adjustX(float amount) override;
-    virtual bool canRemove(float leftEdge) override;
-    virtual void draw(const DrawParams& params) const override;
+    PLY_INLINE u32 numItems() const {
+        return this->count;
+    }
+    PLY_INLINE ObstacleRecord& operator[](u32 i) {
+        PLY_ASSERT(i < this->count);
+        u32 j = this->head + i;
+        return this->chunks[j / ChunkSize]->records[j % ChunkSize];
+    }
+    PLY_INLINE const ObstacleRecord& operator[](u32 i) const {
+        return const_cast<ObstaclePool*>(this)->operator[](i);
+    }
+    ObstacleRecord* append(ObstacleRecord::Type type);
+    void popFront();
+    // Returns the current index of a record in the pool
+    PLY_INLINE u32 indexOf(const ObstacleRecord* rec) const {
+        PLY_ASSERT(this->count > 0);
+        u32 index = rec->serial - (*this)[0].serial;
+        PLY_ASSERT(index < this->count && &(*this)[index] == rec);
+        return index;
+    }
 };
 
 struct GameState {
@@ -89,8 +166,15 @@ struct GameState {
         }
 
         float simulationTimeStep = 0.005f;
+        // Test for collisions along the bird's whole path during each step, instead of only at
+        // its start. Allows larger simulation steps, such as 1/60 s, without missing or
+        // overshooting contacts.
+        bool sweptCollision = false;
         float fracTime = 0.f;
         u32 bestScore = 0;
+        // Seeds the random number generator of each new game. Replays initialize it from the
+        // recording.
+        Random gameSeeds;
     };
 
     struct CurveSegment {
@@ -202,6 +286,9 @@ struct GameState {
     static constexpr float BuildingRepeat = 44.f;
     static constexpr float CloudRadiansPerCameraX = 0.002f;
     static constexpr float SlowMotionFactor = 0.15f;
+    // Heights covered by the obstacle index. Outside this range, every obstacle is tested.
+    static constexpr float IndexMinZ = -30.f;
+    static constexpr float IndexMaxZ = 40.f;
 
     OuterContext* outerCtx = nullptr;
     Random random{2};
@@ -215,8 +302,8 @@ struct GameState {
     float scoreTime[2] = {0, 0};
     u32 damage = 0;
     u32 note = 0;
-    SoLoud::handle flapVoice = -1;
-    SoLoud::handle wobbleVoice = -1;
+    Voice flapVoice = -1;
+    Voice wobbleVoice = -1;
     PLY_INLINE bool isWeak() const {
         return this->damage > 0;
     }
@@ -290,9 +377,20 @@ struct GameState {
     // Playfield
     struct Playfield {
         Array<Owned<ObstacleSequence>> sequences;
-        Array<Reference<Obstacle>> obstacles;
-        Array<float> sortedCheckpoints;
+        ObstaclePool obstacles;
+        CheckpointQueue checkpoints;
         float spawnedToX = 0;
+        ObstacleIndex index;
+
+        void addPipe(const Float3x4& pipeToWorld);
+        void addCustomObstacle(Obstacle* obst);
+        void removeOldestObstacle();
+        // Spawns obstacles from each sequence up to spawnedToX
+        void advanceSequences(GameState* gs);
+        // Returns the obstacles that the bird might touch, in the same order as obstacles
+        ArrayView<const ObstacleIndex::Entry> getNearbyObstacles(const Float3& birdPos);
+        ArrayView<const ObstacleIndex::Entry> getObstaclesAlong(const Float3& from,
+                                                                const Float3& to);
     };
     Playfield playfield;
     float shrubX[2] = {-ShrubRepeat, -ShrubRepeat};
@@ -306,7 +404,12 @@ struct GameState {
     float sweatDelay = 3.f;
 
     void updateCamera(bool cut = false);
+    void startTitle();
     void startPlaying();
+
+    // Copies the simulation state to/from a GameStateSnapshot. See Snapshot.h.
+    bool snapshot(GameStateSnapshot* snap) const;
+    void restore(const GameStateSnapshot& snap);
 };
 
 struct UpdateContext {
@@ -316,7 +419,8 @@ struct UpdateContext {
     Rect bounds2D = {{0, 0}, {0, 0}};
     bool possibleSwipeFromEdge = false;
 
-    static UpdateContext* instance_;
+    // Thread-local so that independent GameStates can be stepped on different threads
+    static thread_local UpdateContext* instance_;
     static PLY_INLINE UpdateContext* instance() {
         PLY_ASSERT(instance_);
         return instance_;
@@ -0,0 +1,22 @@
+#pragma once
+#include <flapGame/Core.h>
+
+namespace flap {
+
+// 64-bit FNV-1a hash. Used to detect when two runs of the simulation diverge, and to key data
+// cached on disk.
+struct StateHasher {
+    u64 value = 14695981039346656037ull;
+
+    PLY_INLINE void append(const void* data, u32 numBytes) {
+        for (u32 i = 0; i < numBytes; i++) {
+            this->value = (this->value ^ ((const u8*) data)[i]) * 1099511628211ull;
+        }
+    }
+    template <typename T>
+    PLY_INLINE void append(const T& value) {
+        this->append(&value, sizeof(T));
+    }
+};
+
+} // namespace flap
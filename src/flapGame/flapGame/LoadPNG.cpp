@@ -1,4 +1,5 @@
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/GLHelpers.h>
 
 // clang-format off
@@ -63,3 +64,5 @@ image::OwnImage loadPNG(StringView src, bool premultiply) {
 }
 
 } // namespace ply
+
+#endif // !FLAPGAME_HEADLESS
@@ -0,0 +1,126 @@
+#include <flapGame/Core.h>
+#include <flapGame/ObstacleIndex.h>
+#include <flapGame/GameState.h>
+
+namespace flap {
+
+constexpr float ObstacleIndex::BucketWidth;
+
+void ObstacleIndex::add(ObstacleRecord* obst, float minX, float maxX) {
+    PLY_ASSERT(minX <= maxX);
+    Entry entry{obst->serial, obst};
+
+    if (this->numBuckets == 0) {
+        this->originX = floorf(minX / BucketWidth) * BucketWidth;
+    }
+    // The first bucket extends to -infinity, since buckets on the left are only dropped once there
+    // are no obstacles left in them.
+    float lo = max(0.f, floorf((minX - this->originX) / BucketWidth));
+    float hi = max(0.f, floorf((maxX - this->originX) / BucketWidth));
+    if (hi - lo >= MaxBucketsPerObstacle) {
+        this->wide.append(entry);
+        return;
+    }
+
+    // Add buckets on the right
+    u32 hiBucket = (u32) hi;
+    if (hiBucket >= this->numBuckets) {
+        u32 requiredBuckets = hiBucket + 1;
+        if (requiredBuckets > this->ring.numItems()) {
+            // Grow the ring buffer, preserving the order of existing buckets
+            u32 newCapacity = max(this->ring.numItems(), 8u);
+            while (newCapacity < requiredBuckets) {
+                newCapacity *= 2;
+            }
+            Array<Bucket> newRing;
+            newRing.resize(newCapacity);
+            for (u32 i = 0; i < this->numBuckets; i++) {
+                newRing[i] = std::move(this->bucket(i));
+            }
+            this->ring = std::move(newRing);
+            this->head = 0;
+        }
+        this->numBuckets = requiredBuckets;
+    }
+
+    for (u32 i = (u32) lo; i <= hiBucket; i++) {
+        this->bucket(i).append(entry);
+    }
+}
+
+void ObstacleIndex::removeOldest(ObstacleRecord* obst, float minX, float maxX) {
+    if (!this->wide.isEmpty() && this->wide[0].obst == obst) {
+        this->wide.erase(0);
+    } else if (this->numBuckets > 0) {
+        // Only visit the buckets covered by the obstacle's x-extent. adjustX moves originX and the
+        // obstacles separately, so rounding can shift the extent by a bucket; check one more on
+        // each side.
+        float lo = max(0.f, floorf((minX - this->originX) / BucketWidth) - 1.f);
+        float hi = clamp(floorf((maxX - this->originX) / BucketWidth) + 1.f, 0.f,
+                         float(this->numBuckets - 1));
+        for (u32 i = (u32) lo; (float) i <= hi; i++) {
+            Bucket& bucket = this->bucket(i);
+            if (!bucket.isEmpty() && bucket[0].obst == obst) {
+                bucket.erase(0);
+            }
+        }
+    }
+
+    // Drop empty buckets on the left
+    while (this->numBuckets > 0 && this->bucket(0).isEmpty()) {
+        this->head = (this->head + 1) & (this->ring.numItems() - 1);
+        this->numBuckets--;
+        this->originX += BucketWidth;
+    }
+}
+
+void ObstacleIndex::adjustX(float amount) {
+    this->originX += amount;
+}
+
+void ObstacleIndex::clear() {
+    for (u32 i = 0; i < this->numBuckets; i++) {
+        this->bucket(i).clear();
+    }
+    this->head = 0;
+    this->numBuckets = 0;
+    this->wide.clear();
+}
+
+ArrayView<const ObstacleIndex::Entry> ObstacleIndex::query(float minX, float maxX) {
+    this->results.clear();
+    this->results.extend(this->wide.view());
+    if (this->numBuckets > 0) {
+        float lo = max(0.f, floorf((minX - this->originX) / BucketWidth));
+        float hi = clamp(floorf((maxX - this->originX) / BucketWidth), 0.f,
+                         float(this->numBuckets - 1));
+        for (u32 i = (u32) lo; (float) i <= hi; i++) {
+            this->results.extend(this->bucket(i).view());
+        }
+    }
+
+    // Restore the original order and remove duplicates. There are only a few results, and each
+    // bucket is already sorted, so insertion sort is fine.
+    u32 numResults = 0;
+    for (u32 i = 0; i < this->results.numItems(); i++) {
+        Entry entry = this->results[i];
+        u32 j = numResults;
+        while (j > 0 && this->results[j - 1].serial > entry.serial) {
+            j--;
+        }
+        if (j > 0 && this->results[j - 1].serial == entry.serial)
+            continue; // Duplicate
+        for (u32 k = numResults; k > j; k--) {
+            this->results[k] = this->results[k - 1];
+        }
+        this->results[j] = entry;
+        numResults++;
+    }
+    this->results.resize(numResults);
+
+    this->numQueries++;
+    this->numResults += numResults;
+    return this->results.view();
+}
+
+} // namespace flap
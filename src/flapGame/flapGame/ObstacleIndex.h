@@ -0,0 +1,52 @@
+#pragma once
+#include <flapGame/Core.h>
+
+namespace flap {
+
+struct ObstacleRecord;
+
+// Buckets the obstacles in the playfield by x-coordinate, so that collision checks only visit
+// obstacles near the bird instead of the whole list.
+//
+// Each bucket covers BucketWidth units along the x-axis and lists every obstacle whose x-extent
+// overlaps it. Buckets are kept in a ring buffer: new buckets are added on the right as obstacles
+// spawn, and empty buckets are dropped on the left as obstacles are removed. Obstacles are always
+// added and removed in the same order as Playfield::obstacles, and query() returns them in that
+// order too, so that collision checks visit them in the same order as a linear scan would.
+struct ObstacleIndex {
+    static constexpr float BucketWidth = 13.f; // Same as GameState::PipeSpacing
+    // Obstacles spanning more buckets than this are kept in a separate list that is always tested
+    static constexpr u32 MaxBucketsPerObstacle = 16;
+
+    struct Entry {
+        u32 serial = 0; // Same as ObstacleRecord::serial
+        ObstacleRecord* obst = nullptr;
+    };
+    using Bucket = Array<Entry>;
+
+    float originX = 0;    // Left edge of the first bucket
+    Array<Bucket> ring;   // Capacity is a power of two
+    u32 head = 0;         // Index of the first bucket in ring
+    u32 numBuckets = 0;   // Number of buckets in use
+    Array<Entry> wide;    // Obstacles spanning more than MaxBucketsPerObstacle buckets
+    Array<Entry> results; // Scratch space for query()
+
+    // Statistics
+    u64 numQueries = 0;
+    u64 numResults = 0; // Collision tests performed, unless a hit ends the scan early
+
+    PLY_INLINE Bucket& bucket(u32 i) {
+        PLY_ASSERT(i < this->numBuckets);
+        return this->ring[(this->head + i) & (this->ring.numItems() - 1)];
+    }
+    void add(ObstacleRecord* obst, float minX, float maxX);
+    // obst must be the oldest obstacle in the index. minX and maxX are its current x-extent.
+    void removeOldest(ObstacleRecord* obst, float minX, float maxX);
+    void adjustX(float amount);
+    // Removes all obstacles, but keeps the statistics
+    void clear();
+    // Returns the obstacles whose x-extent may overlap [minX, maxX]
+    ArrayView<const Entry> query(float minX, float maxX);
+};
+
+} // namespace flap
@@ -11,7 +11,9 @@ using namespace ply;
 
 struct GameFlow;
 
-void init(StringView assetsPath);
+// If cachePath is not empty, data that's slow to generate, such as the SDF font atlas, is saved
+// there and reused by later runs.
+void init(StringView assetsPath, StringView cachePath = {});
 void reloadAssets();
 void shutdown();
 GameFlow* createGameFlow();
@@ -27,4 +29,106 @@ void render(GameFlow* gf, const Float2& fbSize, float renderDT,
 void onAppDeactivate(GameFlow* gf);
 void onAppActivate(GameFlow* gf);
 
+// Sets the number of simulation steps per second. Rates below 200 should be used with swept
+// collision, which tests for collisions along the bird's whole path during each step, both while
+// flying and while falling freely after death. The bounce animations and recovery paths don't test
+// for collisions at any rate.
+void setSimulationRate(GameFlow* gf, float stepsPerSecond, bool sweptCollision);
+
+// Meshes drawn by the game panel use VAOs built at load time. Disabling them makes each draw set up
+// its vertex attributes directly, for comparing the CPU cost of both.
+void setUseMeshVAOs(bool enabled);
+
+// Dynamic vertex, instance and uniform data is sub-allocated from a pair of per-frame ring
+// buffers by default. When disabled, each upload gets its own pooled buffer, as before.
+void setUseRingBuffer(GameFlow* gf, bool enabled);
+
+// Strings drawn by render are laid out once and kept in GPU memory while they're still being
+// drawn. When disabled, they're laid out and uploaded every frame.
+void setUseTextLayoutCache(GameFlow* gf, bool enabled);
+
+// Consecutive strings drawn with the same SDF program, including their drop shadows, are drawn
+// with one instanced call. When disabled, each string is drawn separately.
+void setUseTextBatching(GameFlow* gf, bool enabled);
+
+// The bird's skeleton is blended from poses baked at load time for a range of wing positions, and
+// only the bones that follow the eyes are composed each frame. When disabled, the whole skeleton is
+// composed every frame. Applies to every GameFlow.
+void setUseBirdPoseCache(bool enabled);
+
+// The title screen's title meshes are drawn to a separate layer that's reused while the title isn't
+// tilting. When disabled, they're drawn every frame.
+void setUseTitleLayerCache(GameFlow* gf, bool enabled);
+
+// When frameBudget is greater than zero, render draws the game at a lower resolution while the
+// average time between frames exceeds it, and upscales the result to the framebuffer. The scale
+// goes from 1 down to 0.5 in steps of 0.1. Disabled by default.
+void setDynamicResolution(GameFlow* gf, float frameBudget);
+
+// Totals accumulated by render() since the GameFlow was created. Divide by numFrames for
+// per-frame averages.
+struct RenderStats {
+    u64 numFrames = 0;
+    // Opaque draws sorted and submitted by DrawList. Issued one at a time, each of these draws
+    // would set the program and vertex attributes, and each textured draw would bind its texture.
+    u64 numSortedDraws = 0;
+    u64 numTexturedDraws = 0;
+    u64 numProgramChanges = 0;
+    u64 numTextureChanges = 0;
+    u64 numMeshChanges = 0;
+    // State changes the same draws would have caused in the order they were recorded, with
+    // redundant changes skipped the same way
+    u64 numUnsortedProgramChanges = 0;
+    u64 numUnsortedTextureChanges = 0;
+    u64 numUnsortedMeshChanges = 0;
+    // Calls that go through GLStateCache, and how many of them were skipped because they wouldn't
+    // have changed the state
+    u64 numStateCallsIssued = 0;
+    u64 numStateCallsSkipped = 0;
+    // Dynamic data uploaded through DynamicArrayBuffers, and the number of GL buffers it had to
+    // create to hold it
+    u64 numBytesUploaded = 0;
+    u64 numBuffersCreated = 0;
+    // Strings laid out by generateTextBuffers. Strings found in the text layout cache don't count.
+    u64 numTextLayouts = 0;
+    // Draw calls issued by drawText and drawOutlinedText, or by TextBatch on their behalf
+    u64 numTextDrawCalls = 0;
+    // Times the title screen's title meshes were drawn
+    u64 numTitleRedraws = 0;
+    // Resolution scale chosen by setDynamicResolution's controller, summed over frames, and the
+    // number of times it changed
+    double sumRenderScale = 0;
+    float minRenderScale = 1.f;
+    u64 numRenderScaleChanges = 0;
+    // Time spent in render() on the CPU. Most of it is spent issuing GL calls, since the GPU works
+    // asynchronously.
+    double cpuSeconds = 0;
+};
+const RenderStats& getRenderStats(GameFlow* gf);
+
+// Measured by the last call to init or reloadAssets.
+struct LoadStats {
+    double fontSeconds = 0;     // Time spent loading or baking the SDF font
+    double fontBakeSeconds = 0; // Time the bake took, even if the font was loaded from the cache
+    bool fontFromCache = false;
+};
+LoadStats getLoadStats();
+
+// Used by glfwFlap's --bench-font option. Bakes the SDF font in ttfBuffer at each of the given
+// pixel heights in one job, using numThreads threads, and discards the result. Heights above 48px
+// get a 1024px atlas instead of the default 512px. Doesn't need init or a GL context.
+void benchmarkSDFFontBake(StringView ttfBuffer, ArrayView<const float> pixelHeights,
+                          u32 numThreads);
+
+// Recording & replay. startRecording and startReplay both restart the game from the title screen.
+// During replay, live input is ignored, and if hashInterval > 0, a hash of the GameState is
+// written to hashesPath every hashInterval simulation steps once the replay completes. Recordings
+// store the simulation rate and collision mode set by setSimulationRate, and startReplay switches
+// to them.
+void startRecording(GameFlow* gf);
+bool saveRecording(GameFlow* gf, StringView path);
+bool startReplay(GameFlow* gf, StringView recordingPath, u32 hashInterval = 0,
+                 StringView hashesPath = {});
+bool isReplaying(GameFlow* gf);
+
 } // namespace flap
@@ -10,6 +10,7 @@ bool Puffs::update(float dt) {
     return this->time < 1.f;
 };
 
+#if !FLAPGAME_HEADLESS
 void Puffs::addInstances(Array<PuffShader::InstanceData>& instances) const {
     Random r{this->seed};
     Float3 axis = [&] {
@@ -58,5 +59,6 @@ void Puffs::addInstances(Array<PuffShader::InstanceData>& instances) const {
         side *= -1.f;
     }
 }
+#endif // !FLAPGAME_HEADLESS
 
 } // namespace flap
@@ -1,6 +1,8 @@
 #pragma once
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/Shaders.h>
+#endif
 
 namespace flap {
 
@@ -16,7 +18,9 @@ struct Puffs {
         : pos{pos}, dir{dir}, seed{seed}, big{big} {
     }
     bool update(float dt);
+#if !FLAPGAME_HEADLESS
     void addInstances(Array<PuffShader::InstanceData>& instances) const;
+#endif
 
     PLY_INLINE float getRate() const {
         return this->big ? 0.7f : 1.3f;
@@ -1,8 +1,11 @@
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/GameFlow.h>
 #include <flapGame/GameState.h>
 #include <flapGame/Assets.h>
 #include <flapGame/DrawContext.h>
+#include <flapGame/DrawList.h>
+#include <chrono>
 
 namespace flap {
 
@@ -57,6 +60,7 @@ void drawScoreSign(const Float4x4& cameraToViewport, const Float2& pos, float sc
                      Float4x4::makeScale(scale * 2.7f) *
                      Float4x4::makeTranslation({-scoreTB.xMid(), 0, 0}),
                  {0.75f, 64.f * scale}, {0.f, 0.f, 0.f, 0.98f}, true);
+        TextBatch::flushInstance();
     }
     {
         float rectHWid = max(85.f, (scoreTB.width() + 8) * 1.35f);
@@ -92,7 +96,8 @@ Array<QuatPos> tonguePtsToXforms(ArrayView<const Float3> pts) {
     return result;
 }
 
-Array<Float4x4> composeBirdBones(const GameState* gs, float intervalFrac) {
+// Writes the bird's current pose to boneToModel, which must have one item per skeleton bone.
+void composeBirdBones(ArrayView<Float4x4> boneToModel, const GameState* gs, float intervalFrac) {
     const Assets* a = Assets::instance;
 
     float wingMix;
@@ -104,47 +109,15 @@ Array<Float4x4> composeBirdBones(const GameState* gs, float intervalFrac) {
     }
     wingMix = clamp(wingMix, 0.f, 1.f);
 
-    Array<Float4x4> deltas;
-    deltas.resize(a->bad.birdSkel.numItems());
-    for (Float4x4& delta : deltas) {
-        delta = Float4x4::identity();
-    }
-
-    // Apply wing pose
-    for (u32 i = 0; i < a->bad.loWingPose.numItems(); i++) {
-        PLY_ASSERT(a->bad.loWingPose[i].boneIndex == a->bad.hiWingPose[i].boneIndex);
-        float zAngle = mix(a->bad.loWingPose[i].zAngle, a->bad.hiWingPose[i].zAngle, wingMix);
-        deltas[a->bad.loWingPose[i].boneIndex] = Float4x4::makeRotation({0, 0, 1}, zAngle);
-    }
-
-    // Apply eye pose
-    {
-        ArrayView<const PoseBone> from = a->bad.eyePoses[gs->birdAnim.eyePos[0]];
-        ArrayView<const PoseBone> to = a->bad.eyePoses[gs->birdAnim.eyePos[1]];
-        float f = 1;
-        if (gs->birdAnim.eyeMoving) {
-            float eyeTime = mix(gs->birdAnim.eyeTime[0], gs->birdAnim.eyeTime[1], intervalFrac);
-            f = applySimpleCubic(eyeTime);
-        }
-        for (u32 i = 0; i < from.numItems; i++) {
-            PLY_ASSERT(from[i].boneIndex == to[i].boneIndex);
-            float zAngle = mix(from[i].zAngle, to[i].zAngle, f);
-            deltas[from[i].boneIndex] = Float4x4::makeRotation({0, 0, 1}, zAngle);
-        }
-    }
-
-    // Compute boneToModel xforms
-    Array<Float4x4> curBoneToModel;
-    curBoneToModel.resize(a->bad.birdSkel.numItems());
-    for (u32 i = 0; i < a->bad.birdSkel.numItems(); i++) {
-        const Bone& bone = a->bad.birdSkel[i];
-        if (bone.parentIdx >= 0) {
-            Float4x4 curBoneToParent = bone.boneToParent * deltas[i];
-            curBoneToModel[i] = curBoneToModel[bone.parentIdx] * curBoneToParent;
-        } else {
-            curBoneToModel[i] = bone.boneToParent * deltas[i];
-        }
+    // Apply wing and eye pose
+    u32 eyeFrom = gs->birdAnim.eyePos[0];
+    u32 eyeTo = gs->birdAnim.eyePos[1];
+    float eyeMix = 1;
+    if (gs->birdAnim.eyeMoving) {
+        float eyeTime = mix(gs->birdAnim.eyeTime[0], gs->birdAnim.eyeTime[1], intervalFrac);
+        eyeMix = applySimpleCubic(eyeTime);
     }
+    a->bad.composePose(boneToModel, wingMix, eyeFrom, eyeTo, eyeMix, BirdAnimData::usePoseCache);
 
     // Apply tongue
     {
@@ -161,25 +134,32 @@ Array<Float4x4> composeBirdBones(const GameState* gs, float intervalFrac) {
         Array<QuatPos> tongueXforms = tonguePtsToXforms(tonguePts);
         for (u32 i = 0; i < tonguePts.numItems(); i++) {
             u32 bi = a->bad.tongueBones[i].boneIndex;
-            curBoneToModel[bi] =
+            boneToModel[bi] =
                 Float4x4::fromQuatPos(tongueXforms[i]) * Float4x4::makeScale({1.f, 0.5f, 1.f});
         }
     }
-
-    return curBoneToModel;
 }
 
-void Pipe::draw(const Obstacle::DrawParams& params) const {
+void ObstacleRecord::draw(const Obstacle::DrawParams& params) const {
     const Assets* a = Assets::instance;
+    if (this->type == Custom) {
+        this->custom->draw(params);
+        return;
+    }
 
     for (const DrawMesh* dm : a->pipe) {
-        a->pipeShader->draw(params.cameraToViewport, params.worldToCamera * this->pipeToWorld,
-                            Float2{0.035f, 0.025f}, dm, a->pipeEnvTexture.id);
+        if (params.drawList) {
+            params.drawList->draw(DrawList::Opaque, a->pipeShader,
+                                  params.worldToCamera * this->pipeToWorld, Float2{0.035f, 0.025f},
+                                  dm, a->pipeEnvTexture.id);
+        } else {
+            a->pipeShader->draw(params.cameraToViewport, params.worldToCamera * this->pipeToWorld,
+                                Float2{0.035f, 0.025f}, dm, a->pipeEnvTexture.id);
+        }
     }
 }
 
-void drawTitle(const TitleScreen* titleScreen, const Float4x4& extraZoom) {
-    const Assets* a = Assets::instance;
+Float4x4 getTitleToViewport(const TitleScreen* titleScreen, const Float4x4& extraZoom) {
     const DrawContext* dc = DrawContext::instance();
 
     Float4x4 w2c = {{1, 0, 0, 0}, {0, 0, -1, 0}, {0, 1, 0, 0}, {0, 0, 0, 1}};
@@ -193,9 +173,13 @@ void drawTitle(const TitleScreen* titleScreen, const Float4x4& extraZoom) {
     Float3 skewNorm = getNorm(&titleScreen->titleRot, dc->fracTime);
     Float4x4 skewRot =
         Float4x4::fromQuaternion(Quaternion::fromUnitVectors(Float3{0, 0, 1}, skewNorm));
-    Float4x4 mat = cameraToViewport * w2c * Float4x4::makeTranslation({0, worldDistance, 4.f}) *
-                   Float4x4::makeRotation({1, 0, 0}, Pi / 2.f) * skewRot *
-                   Float4x4::makeTranslation({0, 0, 3.2f}) * Float4x4::makeScale(7.f);
+    return cameraToViewport * w2c * Float4x4::makeTranslation({0, worldDistance, 4.f}) *
+           Float4x4::makeRotation({1, 0, 0}, Pi / 2.f) * skewRot *
+           Float4x4::makeTranslation({0, 0, 3.2f}) * Float4x4::makeScale(7.f);
+}
+
+void drawTitle(const Float4x4& mat) {
+    const Assets* a = Assets::instance;
     GL_CHECK(DepthRange(0.0, 0.5));
     for (const DrawMesh* dm : a->title) {
         a->flatShader->draw(mat, dm, true);
@@ -288,6 +272,7 @@ void renderGamePanel(const DrawContext* dc) {
     const ViewportFrustum& vf = dc->vf;
     const Assets* a = Assets::instance;
     const GameState* gs = dc->gs;
+    DrawList* dl = dc->drawList;
 
     Float3 skyColor = fromSRGB(Float3{80 / 255.f, 203 / 255.f, 1});
     float frustumScale = 1.f;
@@ -302,111 +287,109 @@ void renderGamePanel(const DrawContext* dc) {
     GL_CHECK(Viewport((GLint) vf.viewport.mins.x, (GLint) vf.viewport.mins.y,
                       (GLsizei) vf.viewport.width(), (GLsizei) vf.viewport.height()));
 
+    // Opaque meshes are recorded to the DrawList, then sorted and submitted before the sky and
+    // blended draws.
+    dl->cameraToViewport = cameraToViewport;
+
     // Draw bird
     Float3 birdRelWorld = mix(gs->bird.pos[0], gs->bird.pos[1], dc->intervalFrac);
     QuatPos camToWorld = {mix(gs->camToWorld[0].quat, gs->camToWorld[1].quat, dc->intervalFrac),
                           mix(gs->camToWorld[0].pos, gs->camToWorld[1].pos, dc->intervalFrac)};
     Float4x4 worldToCamera = Float4x4::fromQuatPos(camToWorld.inverted());
     {
+        // The palette is computed once here and shared by every bird mesh
+        SkinPalette* palette = &dl->birdPalette;
+        palette->begin(&a->birdSkinLayout);
+        composeBirdBones(palette->boneToModel, gs, dc->intervalFrac);
+        palette->update();
+
         Quaternion birdRot = mix(gs->bird.finalRot[0], gs->bird.finalRot[1], dc->intervalFrac);
-        Array<Float4x4> boneToModel = composeBirdBones(gs, dc->intervalFrac);
-        GL_CHECK(Enable(GL_STENCIL_TEST));
-        GL_CHECK(StencilFunc(GL_ALWAYS, 1, 0xFF));
-        GL_CHECK(StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
-        GL_CHECK(StencilMask(0xFF));
         Float4x4 modelToCamera = worldToCamera * Float4x4::makeTranslation(birdRelWorld) *
                                  Float4x4::fromQuaternion(birdRot) *
                                  Float4x4::makeRotation({0, 0, 1}, Pi / 2.f) *
                                  Float4x4::makeScale(1.0833f);
         if (gs->isWeak()) {
-            auto desaturate = [](const Float3 color, float amt) -> Float3 {
-                Float3 gray = Float3{dot(color, Float3{0.333f})};
-                return mix(color, gray, amt);
-            };
-            a->sickBirdMeshes[2]->matProps.diffuse =
-                desaturate({0.18f, 0.14f, 0.105f}, -0.9f) * 1.5f;
-
             for (const Assets::MeshWithMaterial* mm : a->sickBirdMeshes) {
-                a->skinnedShader->draw(cameraToViewport, modelToCamera, &mm->mesh,
-                                       boneToModel, &mm->matProps);
+                dl->draw(DrawList::Stencil, a->skinnedShader, modelToCamera, &mm->mesh, palette,
+                         &mm->matProps);
             }
         } else {
             for (const Assets::MeshWithMaterial* mm : a->birdMeshes) {
-                a->skinnedShader->draw(cameraToViewport, modelToCamera, &mm->mesh,
-                                       boneToModel, &mm->matProps);
+                dl->draw(DrawList::Stencil, a->skinnedShader, modelToCamera, &mm->mesh, palette,
+                         &mm->matProps);
             }
             for (const DrawMesh* dm : a->eyeWhite) {
-                a->pipeShader->draw(cameraToViewport, modelToCamera, {0, 0}, dm,
-                                    a->eyeWhiteTexture.id);
+                dl->draw(DrawList::Stencil, a->pipeShader, modelToCamera, {0, 0}, dm,
+                         a->eyeWhiteTexture.id);
             }
         }
-        GL_CHECK(Disable(GL_STENCIL_TEST));
     }
 
     if (!gs->mode.title()) {
         // Draw floor
         for (const DrawMesh* dm : a->floorStripe) {
-            a->texMatShader->draw(
-                cameraToViewport,
-                worldToCamera *
-                    Float4x4::makeTranslation({0.f, 0.f, dc->visibleExtents.mins.y + 4.f}) *
-                    Float4x4::makeRotation({0, 0, 1}, Pi / 2.f),
-                dm, a->stripeTexture.id);
+            dl->draw(DrawList::Opaque, a->texMatShader,
+                     worldToCamera *
+                         Float4x4::makeTranslation({0.f, 0.f, dc->visibleExtents.mins.y + 4.f}) *
+                         Float4x4::makeRotation({0, 0, 1}, Pi / 2.f),
+                     dm, a->stripeTexture.id);
         }
         for (const DrawMesh* dm : a->floor) {
-            a->matShader->draw(
-                cameraToViewport,
-                worldToCamera *
-                    Float4x4::makeTranslation({0.f, 0.f, dc->visibleExtents.mins.y + 4.f}) *
-                    Float4x4::makeRotation({0, 0, 1}, Pi / 2.f),
-                dm);
+            dl->draw(DrawList::Opaque, a->matShader,
+                     worldToCamera *
+                         Float4x4::makeTranslation({0.f, 0.f, dc->visibleExtents.mins.y + 4.f}) *
+                         Float4x4::makeRotation({0, 0, 1}, Pi / 2.f),
+                     dm);
         }
         for (const DrawMesh* dm : a->dirt) {
-            UberShader::Props props;
-            props.diffuse = {1.1f, 0.9f, 0.2f};
-            props.diffuse2 = {0.08f, 0.02f, 0};
-            props.texID = a->gradientTexture.id;
-            a->duotoneShader->draw(
-                cameraToViewport,
-                worldToCamera *
-                    Float4x4::makeTranslation({0.f, 0.f, dc->visibleExtents.mins.y + 4.f}) *
-                    Float4x4::makeRotation({0, 0, 1}, Pi / 2.f),
-                dm, {}, &props);
+            dl->draw(DrawList::Opaque, a->duotoneShader,
+                     worldToCamera *
+                         Float4x4::makeTranslation({0.f, 0.f, dc->visibleExtents.mins.y + 4.f}) *
+                         Float4x4::makeRotation({0, 0, 1}, Pi / 2.f),
+                     dm, {}, &a->dirtProps);
         }
 
         // Draw obstacles
         Obstacle::DrawParams odp;
         odp.cameraToViewport = cameraToViewport;
         odp.worldToCamera = worldToCamera;
-        for (const Obstacle* obst : gs->playfield.obstacles) {
-            obst->draw(odp);
+        odp.drawList = dl;
+        {
+            // Pipes are gathered into a single instance buffer and drawn with one call per pipe
+            // mesh. Only custom obstacles are drawn individually.
+            Array<Float3x4>& pipeToWorlds = dl->pipeToWorlds;
+            pipeToWorlds.clear();
+            for (u32 i = 0; i < gs->playfield.obstacles.numItems(); i++) {
+                const ObstacleRecord& obst = gs->playfield.obstacles[i];
+                if (obst.type == ObstacleRecord::Pipe) {
+                    pipeToWorlds.append(obst.pipeToWorld);
+                } else {
+                    obst.draw(odp);
+                }
+            }
+            if (pipeToWorlds.numItems() > 0) {
+                // Align to the element size so the range can be addressed by firstInstance
+                DynamicArrayBuffers::Range ibo = DynamicArrayBuffers::instance->upload(
+                    pipeToWorlds.stringView(), sizeof(Float3x4));
+                for (const DrawMesh* dm : a->pipe) {
+                    dl->drawInstanced(DrawList::Opaque, a->pipeInstancedShader, worldToCamera,
+                                      Float2{0.035f, 0.025f}, dm, a->pipeEnvTexture.id, ibo.id,
+                                      ibo.offset / sizeof(Float3x4), pipeToWorlds.numItems());
+                }
+            }
         }
 
         // Draw shrubs
         {
-            UberShader::Props props;
-            props.lightDir = Float3{1, -1, 0}.normalized();
-            props.diffuse = mix(Float3{0.065f, 0.99f, 0.1f} * 1.f, skyColor, 0.04f);
-            props.diffuse2 = mix(Float3{0.065f, 0.99f, 0.1f} * 0.5f, skyColor, 0.05f);
-            props.diffuseClamp = {0.28f, 1.1f, 0.28f};
-            props.specLightDir = Float3{1, -1, 0.2f}.normalized();
-            props.specular = Float3{0.7f, 1, 0} * 0.07f;
-            props.specPower = 4.f;
-            props.rim = {mix(Float3{1, 1, 1}, skyColor, 0.3f) * 0.1f, 1.f};
-            props.rimFactor = {1.6f, 4.5f};
+            UberShader::Props props = a->shrubProps;
             float shrubX = mix(gs->shrubX[0], gs->shrubX[1], dc->intervalFrac);
-            for (s32 i = -1; i <= 1; i++) {
-                Float3 groupPos = a->shrubGroup.groupRelWorld;
-                groupPos.x += shrubX + (GameState::ShrubRepeat * i) * a->shrubGroup.groupScale;
-                for (const DrawGroup::Instance& inst : a->shrubGroup.instances) {
-                    props.texID =
-                        (inst.drawMesh == a->shrub[0]) ? a->shrubTexture.id : a->shrub2Texture.id;
-                    a->duotoneShader->draw(cameraToViewport,
-                                           worldToCamera * Float4x4::makeTranslation(groupPos) *
-                                               Float4x4::makeScale(a->shrubGroup.groupScale) *
-                                               inst.itemToGroup,
-                                           inst.drawMesh, {}, &props);
-                }
+            Float4x4 groupToCamera = worldToCamera * Float4x4::makeTranslation({shrubX, 0, 0});
+            for (const InstancedDrawGroup::Batch& batch : a->shrubInstances.batches) {
+                props.texID =
+                    (batch.drawMesh == a->shrub[0]) ? a->shrubTexture.id : a->shrub2Texture.id;
+                dl->drawInstanced(DrawList::Opaque, a->duotoneInstancedShader, groupToCamera,
+                                  batch.drawMesh, a->shrubInstances.instanceXforms.id,
+                                  batch.firstInstance, batch.numInstances, &props);
             }
         }
 
@@ -415,27 +398,15 @@ void renderGamePanel(const DrawContext* dc) {
         skyBoxW2C[3].x = 0;
         skyBoxW2C[3].y = 0;
         {
-            UberShader::Props props;
-            props.diffuse = Float3{0.95f, 1.15f, 0.35f} * 2.2f;
-            props.diffuse2 = Float3{0.2f, 1.f, 1.f} * 2.f;
-            props.diffuseClamp = {-1.f, 1.f, 0.4f};
-            props.rim = {Float3{0.f, 1.f, 1.f} * 0.7f, 0.3f};
-            props.rimFactor = {2.f, 2.f};
-            props.specular = {0, 0, 0};
-            props.texID = a->windowTexture.id;
             float buildingX = mix(gs->buildingX[0], gs->buildingX[1], dc->intervalFrac);
-            for (float r = -3; r <= 3; r++) {
-                Float3 groupPos = a->cityGroup.groupRelWorld;
-                groupPos.x += buildingX + (GameState::BuildingRepeat * r) * a->cityGroup.groupScale;
-                for (const DrawGroup::Instance& inst : a->cityGroup.instances) {
-                    a->duotoneShader->draw(cameraToViewport,
-                                           worldToCamera * Float4x4::makeTranslation(groupPos) *
-                                               Float4x4::makeScale(a->cityGroup.groupScale) *
-                                               inst.itemToGroup,
-                                           inst.drawMesh, {}, &props);
-                }
+            Float4x4 groupToCamera = worldToCamera * Float4x4::makeTranslation({buildingX, 0, 0});
+            for (const InstancedDrawGroup::Batch& batch : a->cityInstances.batches) {
+                dl->drawInstanced(DrawList::Opaque, a->duotoneInstancedShader, groupToCamera,
+                                  batch.drawMesh, a->cityInstances.instanceXforms.id,
+                                  batch.firstInstance, batch.numInstances, &a->cityProps);
             }
         }
+        dl->submit(dc->stats);
 
         // Draw sky
         a->flatShader->drawQuad(Float4x4::makeTranslation({0, 0, 0.999f}), {skyColor, 1.f});
@@ -515,6 +486,7 @@ void renderGamePanel(const DrawContext* dc) {
                          Float4x4::makeTranslation({240, 496, 0}) * Float4x4::makeScale(1.8f) *
                          Float4x4::makeTranslation({-gameOver.xMid(), 0, 0}),
                      {0.75f, 32.f}, {1.f, 0.85f, 0.0f, 1.f});
+            TextBatch::flushInstance();
 
             Tuple<float, float> sp = getSignParams(dead->animateSignTime + dc->fracTime);
             Tuple<float, float> sp2 =
@@ -541,6 +513,7 @@ void renderGamePanel(const DrawContext* dc) {
                              Float4x4::makeScale(0.9f) *
                              Float4x4::makeTranslation({-playAgain.xMid(), 0, 0}),
                          {0.75f, 16.f}, {1.f, 1.f, 1.f, 1.f});
+                TextBatch::flushInstance();
             }
 
             {
@@ -576,6 +549,7 @@ void renderGamePanel(const DrawContext* dc) {
                          Float4x4::makeTranslation({240, 574, 0}) * Float4x4::makeScale(1.5f) *
                          zoomMat * Float4x4::makeTranslation({-tb.xMid(), 0, 0}),
                      {0.75f, 32.f}, {1.f, 1.f, 1.f, 1.f});
+            TextBatch::flushInstance();
         }
 
         if (auto trans = gs->camera.transition()) {
@@ -584,28 +558,38 @@ void renderGamePanel(const DrawContext* dc) {
             applyTitleScreen(dc, opacity, premul);
         }
     } else {
+        dl->submit(dc->stats);
         applyTitleScreen(dc, 1.f, 0.f);
     }
 }
 
-void ensureRenderTargetSize(Texture* tex, RenderToTexture* rtt, const Float2& dims) {
+// Returns true if the render target was (re)created, leaving its contents undefined. Targets that
+// are upscaled to the framebuffer are filtered, and stored as sRGB so that dark gradients don't
+// band.
+bool ensureRenderTargetSize(Texture* tex, RenderToTexture* rtt, const Float2& dims,
+                            bool forUpscale = false) {
     if (!tex->id || tex->dims() != dims) {
         // Create temporary buffer
         rtt->destroy();
         tex->destroy();
         SamplerParams params;
-        params.minFilter = false;
-        params.magFilter = false;
+        params.minFilter = forUpscale;
+        params.magFilter = forUpscale;
         params.repeatX = false;
         params.repeatY = false;
-        params.sRGB = false;
+        params.sRGB = forUpscale;
         PLY_ASSERT(isRounded(dims));
         tex->init((u32) dims.x, (u32) dims.y, image::Format::RGBA, 1, params);
         rtt->init(*tex, true);
+        return true;
     }
+    return false;
 }
 
-void drawTitleScreenToTemp(TitleScreen* ts) {
+// The title meshes are always in front of the background, rays and stars, so they can be drawn to
+// a separate layer and composited over them. When useTitleLayer is true, the layer is reused for as
+// long as the title doesn't move, which is most of the time.
+void drawTitleScreenToTemp(TitleScreen* ts, bool useTitleLayer) {
     const Assets* a = Assets::instance;
     const DrawContext* dc = DrawContext::instance();
     float aspect = dc->fullVF.bounds2D.height() / dc->fullVF.bounds2D.width();
@@ -626,19 +610,47 @@ void drawTitleScreenToTemp(TitleScreen* ts) {
         enablePrompt = false;
     }
 
-    // Render to it
     GLint prevFBO;
     GL_CHECK(GetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO));
+    Float4x4 titleToViewport = getTitleToViewport(ts, extraZoom);
+    // The title zooms during the transition to the game, so the layer wouldn't be reused
+    useTitleLayer = useTitleLayer && enablePrompt;
+    if (useTitleLayer) {
+        bool created = ensureRenderTargetSize(&ts->titleLayerTex, &ts->titleLayerRTT, vpSize);
+        if (created || !ts->titleLayerValid ||
+            memcmp(&titleToViewport, &ts->titleLayerToViewport, sizeof(Float4x4)) != 0) {
+            GL_CHECK(BindFramebuffer(GL_FRAMEBUFFER, ts->titleLayerRTT.fboID));
+            GL_CHECK(Viewport(0, 0, (u32) vpSize.x, (u32) vpSize.y));
+            GL_STATE(DepthMask(GL_TRUE));
+            GL_CHECK(ClearColor(0, 0, 0, 0));
+            GL_CHECK(ClearDepth(1.0));
+            GL_CHECK(Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+            drawTitle(titleToViewport);
+            ts->titleLayerToViewport = titleToViewport;
+            ts->titleLayerValid = true;
+            if (dc->stats) {
+                dc->stats->numTitleRedraws++;
+            }
+        }
+    }
+
+    // Render to it
     GL_CHECK(BindFramebuffer(GL_FRAMEBUFFER, ts->tempRTT.fboID));
     GL_CHECK(Viewport(0, 0, (u32) vpSize.x, (u32) vpSize.y));
-    GL_CHECK(DepthMask(GL_TRUE));
+    GL_STATE(DepthMask(GL_TRUE));
     GL_CHECK(ClearColor(0.75f, 0.75f, 0.75f, 1.f));
     GL_CHECK(ClearDepth(1.0));
     GL_CHECK(ClearStencil(0));
     GL_CHECK(Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
-    drawTitle(ts, extraZoom);
+    if (!useTitleLayer) {
+        drawTitle(titleToViewport);
+        if (dc->stats) {
+            dc->stats->numTitleRedraws++;
+        }
+    }
     {
         // Draw background
+        GL_CHECK(DepthRange(0.5, 0.5));
         float hypnoAngle = mix(ts->hypnoAngle[0], ts->hypnoAngle[1], dc->intervalFrac);
         float hypnoScale = powf(1.3f, mix(ts->hypnoZoom[0], ts->hypnoZoom[1], dc->intervalFrac));
         a->hypnoShader->draw(
@@ -658,6 +670,9 @@ void drawTitleScreenToTemp(TitleScreen* ts) {
                            dm);
     }
     drawStars(ts, extraZoom);
+    if (useTitleLayer) {
+        a->layerShader->drawQuad(Float4x4::identity(), ts->titleLayerTex.id);
+    }
     // Draw prompt
     float footerY = dc->fullVF.bounds2D.mins.y;
     float promptY =
@@ -675,6 +690,7 @@ void drawTitleScreenToTemp(TitleScreen* ts) {
                              Float4x4::makeScale(1.1f) *
                              Float4x4::makeTranslation({-tapToPlay.xMid(), 0, 0}),
                          {1, 1, 1, 0}, {0, 0, 0, 0}, {{0.6f, 16.f}, {0.75f, 12.f}});
+        TextBatch::flushInstance();
     }
 
     // Draw open source button
@@ -731,13 +747,14 @@ void drawTitleScreenToTemp(TitleScreen* ts) {
     }
 
     {
-        // Draw copyright
+        // Draw copyright. It's batched with the open source button's text.
         TextBuffers copyright = generateTextBuffers(a->sdfFont, "@ 2020 Arc80 Software Inc.");
         drawText(a->sdfCommon, a->sdfFont, copyright,
                  extraZoom * Float4x4::makeOrtho(dc->fullVF.bounds2D, -1.f, 1.f) *
                      Float4x4::makeTranslation({306, 4 + promptY, 0}) * Float4x4::makeScale(0.36f) *
                      Float4x4::makeTranslation({-copyright.xMid(), 0, 0}),
                  {0.75f, 10.f}, {0.05f, 0.05f, 0.05f, 1});
+        TextBatch::flushInstance();
     }
 
     GL_CHECK(BindFramebuffer(GL_FRAMEBUFFER, prevFBO));
@@ -753,9 +770,17 @@ ViewportFrustum getViewportFrustum(const Float2& fbSize) {
 
 void render(GameFlow* gf, const Float2& fbSize, float renderDT, bool useManualColorCorrection) {
     PLY_ASSERT(fbSize.x > 0 && fbSize.y > 0);
+    auto startTime = std::chrono::steady_clock::now();
     const Assets* a = Assets::instance;
     PLY_SET_IN_SCOPE(DynamicArrayBuffers::instance, &gf->dynBuffers);
+    PLY_SET_IN_SCOPE(GLStateCache::instance, &gf->glState);
+    PLY_SET_IN_SCOPE(TextLayoutCache::instance, &gf->textCache);
+    PLY_SET_IN_SCOPE(TextBatch::instance, &gf->textBatch);
     gf->dynBuffers.beginFrame();
+    gf->glState.beginFrame();
+    gf->textCache.beginFrame();
+    gf->textBatch.beginFrame();
+    gf->renderStats.numFrames++;
     float intervalFrac = gf->fracTime / gf->simulationTimeStep;
 
 #if !PLY_TARGET_IOS && !PLY_TARGET_ANDROID // doesn't exist in OpenGLES 3
@@ -767,9 +792,25 @@ void render(GameFlow* gf, const Float2& fbSize, float renderDT, bool useManualCo
     GL_CHECK(CullFace(GL_BACK));
     GL_CHECK(FrontFace(GL_CCW));
 
+    // Choose the resolution to draw at. When it's lower than the framebuffer's, everything is drawn
+    // to scaledTex, then upscaled.
+    gf->dynRes.update(renderDT);
+    float renderScale = gf->dynRes.scale();
+    Float2 renderSize = fbSize;
+    if (renderScale < 1.f) {
+        renderSize = {max(1.f, roundNearest(fbSize.x * renderScale)),
+                      max(1.f, roundNearest(fbSize.y * renderScale))};
+    }
+    bool useScaledTarget = (renderSize != fbSize);
+    gf->renderStats.sumRenderScale += renderScale;
+    gf->renderStats.minRenderScale = min(gf->renderStats.minRenderScale, renderScale);
+    gf->renderStats.numRenderScaleChanges = gf->dynRes.numChanges;
+    GLint defaultFBO;
+    GL_CHECK(GetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFBO));
+
     // Fit frustum in viewport
     Rect visibleExtents = expand(Rect{{0, 0}}, Float2{23.775f, 31.7f} * 0.5f);
-    ViewportFrustum fullVF = getViewportFrustum(fbSize);
+    ViewportFrustum fullVF = getViewportFrustum(renderSize);
 
     // Before drawing the panels, draw the title screen (if any) to a temporary buffer
     if (gf->gameState->titleScreen) {
@@ -781,18 +822,22 @@ void render(GameFlow* gf, const Float2& fbSize, float renderDT, bool useManualCo
         dc.fracTime = gf->fracTime;
         dc.intervalFrac = intervalFrac;
         dc.visibleExtents = visibleExtents;
-        drawTitleScreenToTemp(gf->gameState->titleScreen);
+        dc.stats = &gf->renderStats;
+        drawTitleScreenToTemp(gf->gameState->titleScreen, gf->useTitleLayerCache);
     }
 
-    if (useManualColorCorrection) {
+    if (useScaledTarget) {
+        ensureRenderTargetSize(&gf->scaledTex, &gf->scaledRTT, renderSize, true);
+        GL_CHECK(BindFramebuffer(GL_FRAMEBUFFER, gf->scaledRTT.fboID));
+    } else if (useManualColorCorrection) {
         ensureRenderTargetSize(&gf->fullScreenTex, &gf->fullScreenRTT, fbSize);
         GL_CHECK(BindFramebuffer(GL_FRAMEBUFFER, gf->fullScreenRTT.fboID));
     }
 
     // Clear viewport
-    GL_CHECK(Viewport(0, 0, (GLsizei) fbSize.x, (GLsizei) fbSize.y));
+    GL_CHECK(Viewport(0, 0, (GLsizei) renderSize.x, (GLsizei) renderSize.y));
     GL_CHECK(DepthRange(0.0, 1.0));
-    GL_CHECK(DepthMask(GL_TRUE));
+    GL_STATE(DepthMask(GL_TRUE));
     GL_CHECK(ClearColor(0, 0, 0, 1));
     GL_CHECK(ClearDepth(1.0));
     GL_CHECK(Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
@@ -808,6 +853,8 @@ void render(GameFlow* gf, const Float2& fbSize, float renderDT, bool useManualCo
         dc.fracTime = gf->fracTime;
         dc.intervalFrac = intervalFrac;
         dc.visibleExtents = visibleExtents;
+        dc.drawList = &gf->drawList;
+        dc.stats = &gf->renderStats;
         renderGamePanel(&dc);
     };
 
@@ -861,17 +908,34 @@ void render(GameFlow* gf, const Float2& fbSize, float renderDT, bool useManualCo
         renderPanel(gf->gameState, fullVF);
     }
 
-    if (useManualColorCorrection) {
-        // Copy to default framebuffer with color correction
-        GL_CHECK(BindFramebuffer(GL_FRAMEBUFFER, 0));
+    if (useScaledTarget || useManualColorCorrection) {
+        // Copy to default framebuffer, upscaling and/or applying color correction. When both are
+        // needed, the color correction pass does the upscale, so fullScreenTex isn't used.
+        GL_CHECK(BindFramebuffer(GL_FRAMEBUFFER, defaultFBO));
         GL_CHECK(Viewport(0, 0, (GLsizei) fbSize.x, (GLsizei) fbSize.y));
         GL_CHECK(DepthRange(0.0, 1.0));
-        GL_CHECK(DepthMask(GL_TRUE));
+        GL_STATE(DepthMask(GL_TRUE));
         GL_CHECK(ClearColor(0, 0, 0, 1));
         GL_CHECK(ClearDepth(1.0));
         GL_CHECK(Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
-        a->colorCorrectShader->draw(a->quad, gf->fullScreenTex.id);
+        GLuint srcTexID = useScaledTarget ? gf->scaledTex.id : gf->fullScreenTex.id;
+        if (useManualColorCorrection) {
+            a->colorCorrectShader->draw(a->quad, srcTexID);
+        } else {
+            a->copyShader->drawQuad(Float4x4::identity(), srcTexID, 1.f, 0.f);
+        }
     }
+
+    gf->renderStats.numStateCallsIssued += gf->glState.numIssued;
+    gf->renderStats.numStateCallsSkipped += gf->glState.numSkipped;
+    gf->renderStats.numBytesUploaded += gf->dynBuffers.numBytesUploaded;
+    gf->renderStats.numBuffersCreated += gf->dynBuffers.numBuffersCreated;
+    gf->renderStats.numTextLayouts += gf->textCache.numLayouts;
+    gf->renderStats.numTextDrawCalls += gf->textBatch.numDrawCalls;
+    gf->renderStats.cpuSeconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
 }
 
 } // namespace flap
+
+#endif // !FLAPGAME_HEADLESS
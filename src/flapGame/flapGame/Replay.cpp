@@ -0,0 +1,134 @@
+#include <flapGame/Core.h>
+#include <flapGame/Replay.h>
+#include <flapGame/GameState.h>
+
+namespace flap {
+
+struct RecordingHeader {
+    char magic[4] = {'F', 'L', 'R', 'C'};
+    u32 version = 2;
+    u64 seed = 0;
+    u32 numSteps = 0;
+    u32 numEvents = 0;
+    // Added in version 2. Version 1 recordings end here and use the default time step.
+    float simulationTimeStep = 0.005f;
+    u8 sweptCollision = 0;
+    u8 reserved[3] = {0, 0, 0};
+};
+static constexpr u32 HeaderSizeV1 = 24;
+
+String Recording::save() const {
+    RecordingHeader header;
+    header.seed = this->seed;
+    header.numSteps = this->numSteps;
+    header.numEvents = this->events.numItems();
+    header.simulationTimeStep = this->simulationTimeStep;
+    header.sweptCollision = this->sweptCollision ? 1 : 0;
+    return StringView{(const char*) &header, sizeof(header)} + this->events.stringView();
+}
+
+Owned<Recording> Recording::load(StringView data) {
+    RecordingHeader header;
+    if (data.numBytes < HeaderSizeV1)
+        return nullptr;
+    memcpy(&header, data.bytes, HeaderSizeV1);
+    if (memcmp(header.magic, RecordingHeader{}.magic, 4) != 0)
+        return nullptr;
+    u32 headerSize = sizeof(header);
+    if (header.version == 1) {
+        headerSize = HeaderSizeV1;
+    } else if (header.version != RecordingHeader{}.version || data.numBytes < sizeof(header)) {
+        return nullptr;
+    }
+    memcpy(&header, data.bytes, headerSize);
+    if (data.numBytes != headerSize + header.numEvents * sizeof(Event))
+        return nullptr;
+    if (!(header.simulationTimeStep > 0))
+        return nullptr;
+
+    Owned<Recording> recording = new Recording;
+    recording->seed = header.seed;
+    recording->numSteps = header.numSteps;
+    recording->simulationTimeStep = header.simulationTimeStep;
+    recording->sweptCollision = (header.sweptCollision != 0);
+    recording->events.resize(header.numEvents);
+    memcpy(recording->events.get(), data.bytes + headerSize, header.numEvents * sizeof(Event));
+    return recording;
+}
+
+const Recording::Event* Replay::popEvent(u32 step) {
+    if (this->nextEvent >= this->recording->events.numItems())
+        return nullptr;
+    const Recording::Event* event = &this->recording->events[this->nextEvent];
+    PLY_ASSERT(event->step >= step);
+    if (event->step != step)
+        return nullptr;
+    this->nextEvent++;
+    return event;
+}
+
+void Replay::onStepComplete(const GameState* gs, u32 step) {
+    if (this->hashInterval > 0 && (step % this->hashInterval) == 0) {
+        this->hashes.append({step, hashGameState(gs)});
+    }
+}
+
+String Replay::hashesToText() const {
+    static const char* digits = "0123456789abcdef";
+    String result;
+    for (const StepHash& sh : this->hashes) {
+        char hex[16];
+        for (u32 i = 0; i < 16; i++) {
+            hex[i] = digits[(sh.hash >> ((15 - i) * 4)) & 0xf];
+        }
+        result += String::format("{} {}\n", sh.step, StringView{hex, 16});
+    }
+    return result;
+}
+
+void applyInput(GameState* gs, const Recording::Event& event) {
+    if (event.type == Recording::Event::Back) {
+        if (!gs->mode.title()) {
+            gs->outerCtx->backToTitle();
+        }
+        return;
+    }
+
+    UpdateContext uc;
+    uc.gs = gs;
+    uc.bounds2D = event.bounds2D;
+    uc.possibleSwipeFromEdge = event.possibleSwipeFromEdge != 0;
+    PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+    doInput(gs, event.pos, event.down != 0);
+}
+
+u64 hashGameState(const GameState* gs) {
+    StateHasher hasher;
+    hasher.append(gs->random);
+    hasher.append(gs->mode.id);
+    if (auto playing = gs->mode.playing()) {
+        hasher.append(playing->curGravity);
+        hasher.append(playing->zVel[0]);
+        hasher.append(playing->zVel[1]);
+    }
+    hasher.append(gs->lifeState.id);
+    hasher.append(gs->doJump);
+    hasher.append(gs->score);
+    hasher.append(gs->damage);
+    hasher.append(gs->bird.pos);
+    hasher.append(gs->bird.aimTarget);
+    hasher.append(gs->bird.rot);
+    if (auto angle = gs->rotator.angle()) {
+        hasher.append(angle->angle);
+    }
+    for (u32 i = 0; i < gs->playfield.obstacles.numItems(); i++) {
+        gs->playfield.obstacles[i].hashState(&hasher);
+    }
+    for (u32 i = 0; i < gs->playfield.checkpoints.numItems(); i++) {
+        hasher.append(gs->playfield.checkpoints[i]);
+    }
+    hasher.append(gs->playfield.spawnedToX);
+    return hasher.value;
+}
+
+} // namespace flap
@@ -0,0 +1,72 @@
+#pragma once
+#include <flapGame/Core.h>
+#include <flapGame/Hash.h>
+
+namespace flap {
+
+struct GameState;
+
+// A recorded session. Each input event is tagged with the index of the simulation step that it
+// precedes. Since timeStep always advances by OuterContext::simulationTimeStep, feeding the same
+// events at the same step indices reproduces the session exactly, regardless of frame rate.
+struct Recording {
+    struct Event {
+        enum Type : u8 {
+            Input = 0,
+            Back,
+        };
+
+        u32 step = 0;
+        Type type = Input;
+        u8 down = 0;
+        u8 possibleSwipeFromEdge = 0;
+        u8 reserved = 0;
+        Float2 pos = {0, 0}; // In 2D logical coordinates
+        Rect bounds2D = {{0, 0}, {0, 0}};
+    };
+
+    u64 seed = 0; // Initial state of OuterContext::gameSeeds
+    u32 numSteps = 0;
+    // OuterContext settings that the session was recorded with. Replays must apply them, since
+    // the simulation takes a different path at other rates.
+    float simulationTimeStep = 0.005f;
+    bool sweptCollision = false;
+    Array<Event> events;
+
+    String save() const;
+    static Owned<Recording> load(StringView data);
+};
+
+// State of a recording being played back
+struct Replay {
+    Owned<Recording> recording;
+    u32 nextEvent = 0;
+    u32 hashInterval = 0; // 0 means don't compute hashes
+
+    struct StepHash {
+        u32 step = 0;
+        u64 hash = 0;
+    };
+    Array<StepHash> hashes;
+
+    // Returns the next event that precedes the given step, or nullptr if there are none.
+    const Recording::Event* popEvent(u32 step);
+    // Hashes the GameState every hashInterval steps.
+    void onStepComplete(const GameState* gs, u32 step);
+    // One line per hash: step index followed by the hash in hexadecimal
+    String hashesToText() const;
+    PLY_INLINE bool isFinished(u32 step) const {
+        return this->nextEvent >= this->recording->events.numItems() &&
+               step >= this->recording->numSteps;
+    }
+};
+
+// Passes an input event to doInput, or a back event to OuterContext::backToTitle. Used for both live
+// and replayed input, so that both follow the same code path.
+void applyInput(GameState* gs, const Recording::Event& event);
+
+// Hashes the simulation state that affects future steps: bird, mode, score, playfield and random
+// number generator. Presentation-only state (title screen, puffs, camera) is not included.
+u64 hashGameState(const GameState* gs);
+
+} // namespace flap
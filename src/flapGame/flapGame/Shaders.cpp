@@ -1,4 +1,5 @@
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/Shaders.h>
 
 namespace flap {
@@ -13,7 +14,9 @@ PLY_NO_INLINE Owned<MaterialShader> MaterialShader::create() {
             "in vec3 vertPosition;\n"
             "in vec3 vertNormal;\n"
             "uniform mat4 modelToCamera;\n"
-            "uniform mat4 cameraToViewport;\n"
+            "layout(std140) uniform CameraBlock {\n"
+            "    mat4 cameraToViewport;\n"
+            "};\n"
             "out vec3 fragNormal;\n"
             "\n"
             "void main() {\n"
@@ -23,10 +26,12 @@ PLY_NO_INLINE Owned<MaterialShader> MaterialShader::create() {
 
         Shader fragmentShader = Shader::compile(
             GL_FRAGMENT_SHADER, "in vec3 fragNormal;\n"
-                                "uniform vec3 color;\n"
-                                "uniform vec3 specular;\n"
-                                "uniform float specPower;\n"
-                                "uniform vec4 fog;\n"
+                                "layout(std140) uniform PropsBlock {\n"
+                                "    vec3 color;\n"
+                                "    vec3 specular;\n"
+                                "    float specPower;\n"
+                                "    vec4 fog;\n"
+                                "};\n"
                                 "vec3 lightDir = normalize(vec3(1.0, -1.0, -0.5));\n"
                                 "out vec4 fragColor;\n"
                                 "\n"
@@ -55,47 +60,66 @@ PLY_NO_INLINE Owned<MaterialShader> MaterialShader::create() {
     matShader->modelToCameraUniform =
         GL_NO_CHECK(GetUniformLocation(matShader->shader.id, "modelToCamera"));
     PLY_ASSERT(matShader->modelToCameraUniform >= 0);
-    matShader->cameraToViewportUniform =
-        GL_NO_CHECK(GetUniformLocation(matShader->shader.id, "cameraToViewport"));
-    PLY_ASSERT(matShader->cameraToViewportUniform >= 0);
-    matShader->colorUniform = GL_NO_CHECK(GetUniformLocation(matShader->shader.id, "color"));
-    PLY_ASSERT(matShader->colorUniform >= 0);
-    matShader->specularUniform = GL_NO_CHECK(GetUniformLocation(matShader->shader.id, "specular"));
-    PLY_ASSERT(matShader->specularUniform >= 0);
-    matShader->specPowerUniform =
-        GL_NO_CHECK(GetUniformLocation(matShader->shader.id, "specPower"));
-    PLY_ASSERT(matShader->specPowerUniform >= 0);
-    matShader->fogUniform = GL_NO_CHECK(GetUniformLocation(matShader->shader.id, "fog"));
-    PLY_ASSERT(matShader->fogUniform >= 0);
+    UniformBlock::setBinding(matShader->shader.id, "CameraBlock", UniformBlock::Camera);
+    UniformBlock::setBinding(matShader->shader.id, "PropsBlock", UniformBlock::Props);
 
     return matShader;
 }
 
 MaterialShader::Props MaterialShader::defaultProps;
 
-PLY_NO_INLINE void MaterialShader::draw(const Float4x4& cameraToViewport,
-                                        const Float4x4& modelToCamera, const DrawMesh* drawMesh,
-                                        const Props* props) {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_TRUE));
-    GL_CHECK(Disable(GL_BLEND));
-
-    GL_CHECK(
-        UniformMatrix4fv(this->cameraToViewportUniform, 1, GL_FALSE, (GLfloat*) &cameraToViewport));
-    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
+// std140 layout of the PropsBlock uniform block declared by MaterialShader and
+// TexturedMaterialShader
+struct MaterialPropsBlock {
+    Float4 color = {0, 0, 0, 0};
+    Float3 specular = {0, 0, 0};
+    float specPower = 0;
+    Float4 fog = {0, 0, 0, 0};
+};
+
+static MaterialPropsBlock packMaterialProps(const MaterialShader::Props* props,
+                                            const Float3& diffuse) {
+    MaterialPropsBlock block;
+    block.color = {diffuse, 0};
+    block.specular = props->specular;
+    block.specPower = props->specPower;
+    block.fog = props->fog;
+    return block;
+}
 
-    // Set remaining uniforms and vertex attributes
-    if (props) {
-        GL_CHECK(Uniform3fv(this->colorUniform, 1, (const GLfloat*) &props->diffuse));
+// Binds the props' own uniform buffer if it has one. Otherwise, uploads them to a per-frame buffer.
+static void bindMaterialProps(const MaterialShader::Props* props, const Float3& diffuse) {
+    if (props->ubo) {
+        GL_CHECK(BindBufferBase(GL_UNIFORM_BUFFER, UniformBlock::Props, props->ubo));
     } else {
-        GL_CHECK(Uniform3fv(this->colorUniform, 1, (const GLfloat*) &drawMesh->diffuse));
-        props = &defaultProps;
+        MaterialPropsBlock block = packMaterialProps(props, diffuse);
+        DynamicArrayBuffers::Range range =
+            DynamicArrayBuffers::instance->uploadUniforms({(const char*) &block, sizeof(block)});
+        GL_CHECK(BindBufferRange(GL_UNIFORM_BUFFER, UniformBlock::Props, range.id, range.offset,
+                                 sizeof(block)));
     }
-    GL_CHECK(Uniform3fv(this->specularUniform, 1, (const GLfloat*) &props->specular));
-    GL_CHECK(Uniform1f(this->specPowerUniform, props->specPower));
-    GL_CHECK(Uniform4fv(this->fogUniform, 1, (const GLfloat*) &props->fog));
+}
+
+PLY_NO_INLINE GLBuffer MaterialShader::createPropsUBO(Props* props) {
+    MaterialPropsBlock block = packMaterialProps(props, props->diffuse);
+    GLBuffer ubo = GLBuffer::create({(const char*) &block, sizeof(block)});
+    props->ubo = ubo.id;
+    return ubo;
+}
+
+PLY_NO_INLINE void MaterialShader::begin(const Float4x4& cameraToViewport) const {
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_TRUE));
+    GL_STATE(Disable(GL_BLEND));
+    CameraUniforms::instance->set(cameraToViewport);
+}
 
+PLY_NO_INLINE void MaterialShader::bindMesh(const DrawMesh* drawMesh) const {
+    if (GLuint vao = drawMesh->findVAO(this)) {
+        GL_CHECK(BindVertexArray(vao));
+        return;
+    }
     GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, drawMesh->vbo.id));
     PLY_ASSERT(drawMesh->vertexType == DrawMesh::VertexType::NotSkinned);
     GL_CHECK(EnableVertexAttribArray(this->vertPositionAttrib));
@@ -104,13 +128,36 @@ PLY_NO_INLINE void MaterialShader::draw(const Float4x4& cameraToViewport,
     GL_CHECK(EnableVertexAttribArray(this->vertNormalAttrib));
     GL_CHECK(VertexAttribPointer(this->vertNormalAttrib, 3, GL_FLOAT, GL_FALSE,
                                  (GLsizei) sizeof(VertexPN), (GLvoid*) offsetof(VertexPN, normal)));
-
-    // Draw this VBO
     GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawMesh->indexBuffer.id));
+}
+
+PLY_NO_INLINE void MaterialShader::drawBound(const Float4x4& modelToCamera,
+                                             const DrawMesh* drawMesh, const Props* props) const {
+    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
+    if (props) {
+        bindMaterialProps(props, props->diffuse);
+    } else {
+        bindMaterialProps(&defaultProps, drawMesh->diffuse);
+    }
     GL_CHECK(
         DrawElements(GL_TRIANGLES, (GLsizei) drawMesh->numIndices, GL_UNSIGNED_SHORT, (void*) 0));
 }
 
+PLY_NO_INLINE void MaterialShader::end() const {
+    GL_CHECK(BindVertexArray(GLVertexArray::defaultID));
+    GL_CHECK(DisableVertexAttribArray(this->vertPositionAttrib));
+    GL_CHECK(DisableVertexAttribArray(this->vertNormalAttrib));
+}
+
+PLY_NO_INLINE void MaterialShader::draw(const Float4x4& cameraToViewport,
+                                        const Float4x4& modelToCamera, const DrawMesh* drawMesh,
+                                        const Props* props) const {
+    this->begin(cameraToViewport);
+    this->bindMesh(drawMesh);
+    this->drawBound(modelToCamera, drawMesh, props);
+    this->end();
+}
+
 //---------------------------------------------------------
 
 PLY_NO_INLINE Owned<TexturedMaterialShader> TexturedMaterialShader::create() {
@@ -122,7 +169,9 @@ PLY_NO_INLINE Owned<TexturedMaterialShader> TexturedMaterialShader::create() {
             "in vec3 vertNormal;\n"
             "in vec2 vertTexCoord;\n"
             "uniform mat4 modelToCamera;\n"
-            "uniform mat4 cameraToViewport;\n"
+            "layout(std140) uniform CameraBlock {\n"
+            "    mat4 cameraToViewport;\n"
+            "};\n"
             "out vec3 fragNormal;\n"
             "out vec2 fragTexCoord;\n"
             "\n"
@@ -136,9 +185,12 @@ PLY_NO_INLINE Owned<TexturedMaterialShader> TexturedMaterialShader::create() {
             GL_FRAGMENT_SHADER, "in vec3 fragNormal;\n"
                                 "in vec2 fragTexCoord;\n"
                                 "uniform sampler2D texImage;\n"
-                                "uniform vec3 specular;\n"
-                                "uniform float specPower;\n"
-                                "uniform vec4 fog;\n"
+                                "layout(std140) uniform PropsBlock {\n"
+                                "    vec3 color;\n"
+                                "    vec3 specular;\n"
+                                "    float specPower;\n"
+                                "    vec4 fog;\n"
+                                "};\n"
                                 "vec3 lightDir = normalize(vec3(1.0, -1.0, -0.5));\n"
                                 "out vec4 fragColor;\n"
                                 "\n"
@@ -171,48 +223,29 @@ PLY_NO_INLINE Owned<TexturedMaterialShader> TexturedMaterialShader::create() {
     texMatShader->modelToCameraUniform =
         GL_NO_CHECK(GetUniformLocation(texMatShader->shader.id, "modelToCamera"));
     PLY_ASSERT(texMatShader->modelToCameraUniform >= 0);
-    texMatShader->cameraToViewportUniform =
-        GL_NO_CHECK(GetUniformLocation(texMatShader->shader.id, "cameraToViewport"));
-    PLY_ASSERT(texMatShader->cameraToViewportUniform >= 0);
     texMatShader->textureUniform =
         GL_NO_CHECK(GetUniformLocation(texMatShader->shader.id, "texImage"));
     PLY_ASSERT(texMatShader->textureUniform >= 0);
-    texMatShader->specularUniform =
-        GL_NO_CHECK(GetUniformLocation(texMatShader->shader.id, "specular"));
-    PLY_ASSERT(texMatShader->specularUniform >= 0);
-    texMatShader->specPowerUniform =
-        GL_NO_CHECK(GetUniformLocation(texMatShader->shader.id, "specPower"));
-    PLY_ASSERT(texMatShader->specPowerUniform >= 0);
-    texMatShader->fogUniform = GL_NO_CHECK(GetUniformLocation(texMatShader->shader.id, "fog"));
-    PLY_ASSERT(texMatShader->fogUniform >= 0);
+    UniformBlock::setBinding(texMatShader->shader.id, "CameraBlock", UniformBlock::Camera);
+    UniformBlock::setBinding(texMatShader->shader.id, "PropsBlock", UniformBlock::Props);
 
     return texMatShader;
 }
 
-PLY_NO_INLINE void TexturedMaterialShader::draw(const Float4x4& cameraToViewport,
-                                                const Float4x4& modelToCamera,
-                                                const DrawMesh* drawMesh, GLuint texID,
-                                                const MaterialShader::Props* props) {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_TRUE));
-    GL_CHECK(Disable(GL_BLEND));
-
-    GL_CHECK(
-        UniformMatrix4fv(this->cameraToViewportUniform, 1, GL_FALSE, (GLfloat*) &cameraToViewport));
-    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
-
-    // Set remaining uniforms and vertex attributes
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, texID));
+PLY_NO_INLINE void TexturedMaterialShader::begin(const Float4x4& cameraToViewport) const {
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_TRUE));
+    GL_STATE(Disable(GL_BLEND));
+    CameraUniforms::instance->set(cameraToViewport);
     GL_CHECK(Uniform1i(this->textureUniform, 0));
-    if (!props) {
-        props = &MaterialShader::defaultProps;
-    }
-    GL_CHECK(Uniform3fv(this->specularUniform, 1, (const GLfloat*) &props->specular));
-    GL_CHECK(Uniform1f(this->specPowerUniform, props->specPower));
-    GL_CHECK(Uniform4fv(this->fogUniform, 1, (const GLfloat*) &props->fog));
+}
 
+PLY_NO_INLINE void TexturedMaterialShader::bindMesh(const DrawMesh* drawMesh) const {
+    if (GLuint vao = drawMesh->findVAO(this)) {
+        GL_CHECK(BindVertexArray(vao));
+        return;
+    }
     GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, drawMesh->vbo.id));
     PLY_ASSERT(drawMesh->vertexType == DrawMesh::VertexType::TexturedNormal);
     GL_CHECK(EnableVertexAttribArray(this->vertPositionAttrib));
@@ -225,37 +258,74 @@ PLY_NO_INLINE void TexturedMaterialShader::draw(const Float4x4& cameraToViewport
     GL_CHECK(EnableVertexAttribArray(this->vertTexCoordAttrib));
     GL_CHECK(VertexAttribPointer(this->vertTexCoordAttrib, 2, GL_FLOAT, GL_FALSE,
                                  (GLsizei) sizeof(VertexPNT), (GLvoid*) offsetof(VertexPNT, uv)));
-
-    // Draw this VBO
     GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawMesh->indexBuffer.id));
+}
+
+PLY_NO_INLINE void TexturedMaterialShader::drawBound(const Float4x4& modelToCamera,
+                                                     const DrawMesh* drawMesh,
+                                                     const MaterialShader::Props* props) const {
+    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
+    if (!props) {
+        props = &MaterialShader::defaultProps;
+    }
+    bindMaterialProps(props, props->diffuse);
     GL_CHECK(
         DrawElements(GL_TRIANGLES, (GLsizei) drawMesh->numIndices, GL_UNSIGNED_SHORT, (void*) 0));
+}
 
+PLY_NO_INLINE void TexturedMaterialShader::end() const {
+    GL_CHECK(BindVertexArray(GLVertexArray::defaultID));
     GL_CHECK(DisableVertexAttribArray(this->vertPositionAttrib));
     GL_CHECK(DisableVertexAttribArray(this->vertNormalAttrib));
     GL_CHECK(DisableVertexAttribArray(this->vertTexCoordAttrib));
 }
 
+PLY_NO_INLINE void TexturedMaterialShader::draw(const Float4x4& cameraToViewport,
+                                                const Float4x4& modelToCamera,
+                                                const DrawMesh* drawMesh, GLuint texID,
+                                                const MaterialShader::Props* props) const {
+    this->begin(cameraToViewport);
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, texID));
+    this->bindMesh(drawMesh);
+    this->drawBound(modelToCamera, drawMesh, props);
+    this->end();
+}
+
 //---------------------------------------------------------
 
-PLY_NO_INLINE Owned<PipeShader> PipeShader::create() {
+PLY_NO_INLINE Owned<PipeShader> PipeShader::create(bool instanced) {
     Owned<PipeShader> pipeShader = new PipeShader;
+    pipeShader->instanced = instanced;
     {
-        Shader vertexShader = Shader::compile(
-            GL_VERTEX_SHADER,
-            "in vec3 vertPosition;\n"
-            "in vec3 vertNormal;\n"
-            "uniform mat4 modelToCamera;\n"
-            "uniform mat4 cameraToViewport;\n"
-            "uniform vec2 normalSkew;\n"
-            "out vec3 fragSkewedNorm;\n"
-            "\n"
-            "void main() {\n"
-            "    vec4 posRelCam = modelToCamera * vec4(vertPosition, 1.0);\n"
-            "    vec3 normRelCam = vec3(modelToCamera * vec4(vertNormal, 0.0));\n"
-            "    fragSkewedNorm = normRelCam + vec3(posRelCam.xy * normalSkew, 0.0);\n"
-            "    gl_Position = cameraToViewport * posRelCam;\n"
-            "}\n");
+        StringView defines = instanced ? "#define INSTANCED 1\n" : "";
+        Shader vertexShader = Shader::compile(GL_VERTEX_SHADER, defines + R"(
+in vec3 vertPosition;
+in vec3 vertNormal;
+#ifdef INSTANCED
+in mat4x3 instModelToWorld;
+#endif
+uniform mat4 modelToCamera;
+layout(std140) uniform CameraBlock {
+    mat4 cameraToViewport;
+};
+uniform vec2 normalSkew;
+out vec3 fragSkewedNorm;
+
+void main() {
+#ifdef INSTANCED
+    vec4 pos = vec4(instModelToWorld * vec4(vertPosition, 1.0), 1.0);
+    vec4 norm = vec4(instModelToWorld * vec4(vertNormal, 0.0), 0.0);
+#else
+    vec4 pos = vec4(vertPosition, 1.0);
+    vec4 norm = vec4(vertNormal, 0.0);
+#endif
+    vec4 posRelCam = modelToCamera * pos;
+    vec3 normRelCam = vec3(modelToCamera * norm);
+    fragSkewedNorm = normRelCam + vec3(posRelCam.xy * normalSkew, 0.0);
+    gl_Position = cameraToViewport * posRelCam;
+}
+)");
 
         Shader fragmentShader =
             Shader::compile(GL_FRAGMENT_SHADER, "in vec3 fragSkewedNorm;\n"
@@ -280,39 +350,36 @@ PLY_NO_INLINE Owned<PipeShader> PipeShader::create() {
     pipeShader->vertNormalAttrib =
         GL_NO_CHECK(GetAttribLocation(pipeShader->shader.id, "vertNormal"));
     PLY_ASSERT(pipeShader->vertNormalAttrib >= 0);
+    pipeShader->instModelToWorldAttrib =
+        GL_NO_CHECK(GetAttribLocation(pipeShader->shader.id, "instModelToWorld"));
+    PLY_ASSERT(instanced == (pipeShader->instModelToWorldAttrib >= 0));
     pipeShader->modelToCameraUniform =
         GL_NO_CHECK(GetUniformLocation(pipeShader->shader.id, "modelToCamera"));
     PLY_ASSERT(pipeShader->modelToCameraUniform >= 0);
-    pipeShader->cameraToViewportUniform =
-        GL_NO_CHECK(GetUniformLocation(pipeShader->shader.id, "cameraToViewport"));
-    PLY_ASSERT(pipeShader->cameraToViewportUniform >= 0);
     pipeShader->normalSkewUniform =
         GL_NO_CHECK(GetUniformLocation(pipeShader->shader.id, "normalSkew"));
     PLY_ASSERT(pipeShader->normalSkewUniform >= 0);
     pipeShader->textureUniform = GL_NO_CHECK(GetUniformLocation(pipeShader->shader.id, "texImage"));
     PLY_ASSERT(pipeShader->textureUniform >= 0);
+    UniformBlock::setBinding(pipeShader->shader.id, "CameraBlock", UniformBlock::Camera);
 
     return pipeShader;
 }
 
-PLY_NO_INLINE void PipeShader::draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
-                                    const Float2& normalSkew, const DrawMesh* drawMesh,
-                                    GLuint texID) {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_TRUE));
-    GL_CHECK(Disable(GL_BLEND));
-
-    GL_CHECK(
-        UniformMatrix4fv(this->cameraToViewportUniform, 1, GL_FALSE, (GLfloat*) &cameraToViewport));
-    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
-    GL_CHECK(Uniform2fv(this->normalSkewUniform, 1, (GLfloat*) &normalSkew));
-
-    // Set remaining uniforms and vertex attributes
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, texID));
+PLY_NO_INLINE void PipeShader::begin(const Float4x4& cameraToViewport) const {
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_TRUE));
+    GL_STATE(Disable(GL_BLEND));
+    CameraUniforms::instance->set(cameraToViewport);
     GL_CHECK(Uniform1i(this->textureUniform, 0));
+}
 
+PLY_NO_INLINE void PipeShader::bindMesh(const DrawMesh* drawMesh) const {
+    if (GLuint vao = drawMesh->findVAO(this)) {
+        GL_CHECK(BindVertexArray(vao));
+        return;
+    }
     GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, drawMesh->vbo.id));
     PLY_ASSERT(drawMesh->vertexType == DrawMesh::VertexType::NotSkinned);
     GL_CHECK(EnableVertexAttribArray(this->vertPositionAttrib));
@@ -321,15 +388,102 @@ PLY_NO_INLINE void PipeShader::draw(const Float4x4& cameraToViewport, const Floa
     GL_CHECK(EnableVertexAttribArray(this->vertNormalAttrib));
     GL_CHECK(VertexAttribPointer(this->vertNormalAttrib, 3, GL_FLOAT, GL_FALSE,
                                  (GLsizei) sizeof(VertexPN), (GLvoid*) offsetof(VertexPN, normal)));
-
-    // Draw this VBO
     GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawMesh->indexBuffer.id));
+}
+
+PLY_NO_INLINE void PipeShader::drawBound(const Float4x4& modelToCamera, const Float2& normalSkew,
+                                         const DrawMesh* drawMesh) const {
+    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
+    GL_CHECK(Uniform2fv(this->normalSkewUniform, 1, (GLfloat*) &normalSkew));
     GL_CHECK(
         DrawElements(GL_TRIANGLES, (GLsizei) drawMesh->numIndices, GL_UNSIGNED_SHORT, (void*) 0));
 }
 
+PLY_NO_INLINE void PipeShader::bindInstances(GLuint instanceVBO, u32 firstInstance) const {
+    PLY_ASSERT(this->instanced);
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, instanceVBO));
+    for (u32 c = 0; c < 4; c++) {
+        GL_CHECK(EnableVertexAttribArray(this->instModelToWorldAttrib + c));
+        GL_CHECK(VertexAttribPointer(
+            this->instModelToWorldAttrib + c, 3, GL_FLOAT, GL_FALSE, (GLsizei) sizeof(Float3x4),
+            (GLvoid*) (sizeof(Float3x4) * firstInstance + sizeof(Float3) * c)));
+        GL_CHECK(VertexAttribDivisor(this->instModelToWorldAttrib + c, 1));
+    }
+}
+
+PLY_NO_INLINE void PipeShader::drawBoundInstanced(const Float4x4& worldToCamera,
+                                                  const Float2& normalSkew,
+                                                  const DrawMesh* drawMesh,
+                                                  u32 numInstances) const {
+    PLY_ASSERT(this->instanced);
+    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &worldToCamera));
+    GL_CHECK(Uniform2fv(this->normalSkewUniform, 1, (GLfloat*) &normalSkew));
+    GL_CHECK(DrawElementsInstanced(GL_TRIANGLES, (GLsizei) drawMesh->numIndices, GL_UNSIGNED_SHORT,
+                                   (void*) 0, (GLsizei) numInstances));
+}
+
+PLY_NO_INLINE void PipeShader::end() const {
+    GL_CHECK(BindVertexArray(GLVertexArray::defaultID));
+    GL_CHECK(DisableVertexAttribArray(this->vertPositionAttrib));
+    GL_CHECK(DisableVertexAttribArray(this->vertNormalAttrib));
+    if (this->instanced) {
+        for (u32 c = 0; c < 4; c++) {
+            GL_CHECK(VertexAttribDivisor(this->instModelToWorldAttrib + c, 0));
+            GL_CHECK(DisableVertexAttribArray(this->instModelToWorldAttrib + c));
+        }
+    }
+}
+
+PLY_NO_INLINE void PipeShader::draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
+                                    const Float2& normalSkew, const DrawMesh* drawMesh,
+                                    GLuint texID) const {
+    this->begin(cameraToViewport);
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, texID));
+    this->bindMesh(drawMesh);
+    this->drawBound(modelToCamera, normalSkew, drawMesh);
+    this->end();
+}
+
 //---------------------------------------------------------
 
+PLY_NO_INLINE u32 SkinPaletteLayout::addSlot(u32 indexInSkel, const Float4x4& baseModelToBone) {
+    for (u32 i = 0; i < this->slots.numItems(); i++) {
+        const Slot& slot = this->slots[i];
+        if (slot.indexInSkel == indexInSkel &&
+            memcmp(&slot.baseModelToBone, &baseModelToBone, sizeof(Float4x4)) == 0)
+            return i;
+    }
+    PLY_ASSERT(this->slots.numItems() < MaxSlots);
+    this->slots.append({indexInSkel, baseModelToBone});
+    return this->slots.numItems() - 1;
+}
+
+PLY_NO_INLINE void SkinPalette::begin(const SkinPaletteLayout* layout) {
+    // The layout can change when assets are reloaded
+    this->layout = layout;
+    this->boneToModel.resize(layout->numSkelBones);
+    this->xforms.resize(layout->slots.numItems());
+    if (!this->ubo.id) {
+        // The buffer must cover the whole uniform block, even if fewer slots are used
+        this->ubo = GLBuffer::create(
+            {(const char*) nullptr, sizeof(Float4x4) * SkinPaletteLayout::MaxSlots});
+    }
+}
+
+PLY_NO_INLINE void SkinPalette::update() {
+    for (u32 i = 0; i < this->layout->slots.numItems(); i++) {
+        const SkinPaletteLayout::Slot& slot = this->layout->slots[i];
+        this->xforms[i] = this->boneToModel[slot.indexInSkel] * slot.baseModelToBone;
+    }
+    // Orphan the previous contents so that draws still using them don't stall the upload
+    GL_CHECK(BindBuffer(GL_UNIFORM_BUFFER, this->ubo.id));
+    GL_CHECK(BufferData(GL_UNIFORM_BUFFER, sizeof(Float4x4) * SkinPaletteLayout::MaxSlots,
+                        nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(BufferSubData(GL_UNIFORM_BUFFER, 0, this->xforms.stringView().numBytes,
+                           this->xforms.get()));
+}
+
 PLY_NO_INLINE Owned<UberShader> UberShader::create(u32 flags) {
     using F = UberShader::Flags;
     const bool skinned = (flags & F::Skinned) != 0;
@@ -341,6 +495,8 @@ PLY_NO_INLINE Owned<UberShader> UberShader::create(u32 flags) {
     const bool skinnedCompat = false;
 #endif
     const bool duotone = (flags & F::Duotone) != 0;
+    const bool instanced = (flags & F::Instanced) != 0;
+    PLY_ASSERT(!(skinned && instanced));
 
     Owned<UberShader> uberShader = new UberShader;
     uberShader->flags = flags;
@@ -352,10 +508,14 @@ PLY_NO_INLINE Owned<UberShader> UberShader::create(u32 flags) {
                 if (skinnedCompat) {
                     mout << "#define SKINNED_COMPAT 1\n";
                 }
+                mout << "#define MAX_PALETTE_SLOTS " << SkinPaletteLayout::MaxSlots << "\n";
             }
             if (duotone) {
                 mout << "#define DUOTONE 1\n";
             }
+            if (instanced) {
+                mout << "#define INSTANCED 1\n";
+            }
             return mout.moveToString();
         }();
 
@@ -367,15 +527,22 @@ in vec2 vertTexCoord;
 out vec2 fragTexCoord;
 #endif
 uniform mat4 modelToCamera;
-uniform mat4 cameraToViewport;
+layout(std140) uniform CameraBlock {
+    mat4 cameraToViewport;
+};
+#ifdef INSTANCED
+in mat4 instItemToGroup;
+#endif
 #ifdef SKINNED
 in vec2 vertBlendIndices;
 in vec2 vertBlendWeights;
+layout(std140) uniform BonesBlock {
 #ifdef SKINNED_COMPAT
-uniform vec4 boneXformsC[64];
+    vec4 boneXformsC[MAX_PALETTE_SLOTS * 4];
 #else
-uniform mat4 boneXforms[16];
+    mat4 boneXforms[MAX_PALETTE_SLOTS];
 #endif
+};
 #endif
 out vec3 fragNormal;
 
@@ -409,8 +576,13 @@ void main() {
     vec4 pos = vec4(vertPosition, 1.0);
     vec4 norm = vec4(vertNormal, 0.0);
 #endif
-    fragNormal = vec3(modelToCamera * normalize(norm));
-    gl_Position = cameraToViewport * (modelToCamera * pos);
+#ifdef INSTANCED
+    mat4 itemToCamera = modelToCamera * instItemToGroup;
+#else
+    mat4 itemToCamera = modelToCamera;
+#endif
+    fragNormal = vec3(itemToCamera * normalize(norm));
+    gl_Position = cameraToViewport * (itemToCamera * pos);
 #ifdef DUOTONE
     fragTexCoord = vertTexCoord;
 #endif
@@ -419,19 +591,21 @@ void main() {
 
         Shader fragmentShader = Shader::compile(GL_FRAGMENT_SHADER, defines + R"(
 in vec3 fragNormal;
-uniform vec3 diffuse;
 #ifdef DUOTONE
 in vec2 fragTexCoord;
-uniform vec3 diffuse2;
 uniform sampler2D texImage;
 #endif
-uniform vec3 diffuseClamp;
-uniform vec3 specular;
-uniform float specPower;
-uniform vec4 rim;
-uniform vec2 rimFactor;
-uniform vec3 lightDir;
-uniform vec3 specLightDir;
+layout(std140) uniform PropsBlock {
+    vec3 diffuse;
+    vec3 diffuse2;
+    vec3 diffuseClamp;
+    vec3 specular;
+    float specPower;
+    vec4 rim;
+    vec2 rimFactor;
+    vec3 lightDir;
+    vec3 specLightDir;
+};
 out vec4 outColor;
 
 void main() {
@@ -478,43 +652,17 @@ void main() {
     uberShader->vertBlendWeightsAttrib =
         GL_NO_CHECK(GetAttribLocation(uberShader->shader.id, "vertBlendWeights"));
     PLY_ASSERT(skinned == (uberShader->vertBlendIndicesAttrib >= 0));
+    uberShader->instItemToGroupAttrib =
+        GL_NO_CHECK(GetAttribLocation(uberShader->shader.id, "instItemToGroup"));
+    PLY_ASSERT(instanced == (uberShader->instItemToGroupAttrib >= 0));
     uberShader->modelToCameraUniform =
         GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "modelToCamera"));
     PLY_ASSERT(uberShader->modelToCameraUniform >= 0);
-    uberShader->cameraToViewportUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "cameraToViewport"));
-    PLY_ASSERT(uberShader->cameraToViewportUniform >= 0);
-    uberShader->diffuseUniform = GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "diffuse"));
-    PLY_ASSERT(uberShader->diffuseUniform >= 0);
-    uberShader->diffuse2Uniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "diffuse2"));
-    PLY_ASSERT(duotone == (uberShader->diffuse2Uniform >= 0));
-    uberShader->diffuseClampUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "diffuseClamp"));
-    PLY_ASSERT(uberShader->diffuseClampUniform >= 0);
-    uberShader->specularUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "specular"));
-    PLY_ASSERT(uberShader->specularUniform >= 0);
-    uberShader->specPowerUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "specPower"));
-    PLY_ASSERT(uberShader->specPowerUniform >= 0);
-    uberShader->rimUniform = GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "rim"));
-    PLY_ASSERT(uberShader->rimUniform >= 0);
-    uberShader->rimFactorUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "rimFactor"));
-    PLY_ASSERT(uberShader->rimFactorUniform >= 0);
-    uberShader->lightDirUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "lightDir"));
-    PLY_ASSERT(uberShader->lightDirUniform >= 0);
-    uberShader->specLightDirUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "specLightDir"));
-    PLY_ASSERT(uberShader->specLightDirUniform >= 0);
-    uberShader->boneXformsUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "boneXforms"));
-    PLY_ASSERT((skinned && !skinnedCompat) == (uberShader->boneXformsUniform >= 0));
-    uberShader->boneXformsCUniform =
-        GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "boneXformsC"));
-    PLY_ASSERT((skinned && skinnedCompat) == (uberShader->boneXformsCUniform >= 0));
+    UniformBlock::setBinding(uberShader->shader.id, "CameraBlock", UniformBlock::Camera);
+    UniformBlock::setBinding(uberShader->shader.id, "PropsBlock", UniformBlock::Props);
+    if (skinned) {
+        UniformBlock::setBinding(uberShader->shader.id, "BonesBlock", UniformBlock::Bones);
+    }
     uberShader->texImageUniform =
         GL_NO_CHECK(GetUniformLocation(uberShader->shader.id, "texImage"));
     PLY_ASSERT(duotone == (uberShader->texImageUniform >= 0));
@@ -524,63 +672,71 @@ void main() {
 
 UberShader::Props UberShader::defaultProps;
 
-PLY_NO_INLINE void UberShader::draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
-                                    const DrawMesh* drawMesh, ArrayView<const Float4x4> boneToModel,
-                                    const Props* props) {
-    using F = UberShader::Flags;
-    const bool skinned = (this->flags & F::Skinned) != 0;
-    const bool duotone = (this->flags & F::Duotone) != 0;
-
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_TRUE));
-    GL_CHECK(Disable(GL_BLEND));
-
-    // Uniforms
-    GL_CHECK(
-        UniformMatrix4fv(this->cameraToViewportUniform, 1, GL_FALSE, (GLfloat*) &cameraToViewport));
-    GL_CHECK(UniformMatrix4fv(this->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
+// std140 layout of UberShader's PropsBlock uniform block
+struct UberPropsBlock {
+    Float4 diffuse = {0, 0, 0, 0};
+    Float4 diffuse2 = {0, 0, 0, 0};
+    Float4 diffuseClamp = {0, 0, 0, 0};
+    Float3 specular = {0, 0, 0};
+    float specPower = 0;
+    Float4 rim = {0, 0, 0, 0};
+    Float4 rimFactor = {0, 0, 0, 0};
+    Float4 lightDir = {0, 0, 0, 0};
+    Float4 specLightDir = {0, 0, 0, 0};
+};
+
+static UberPropsBlock packUberProps(const UberShader::Props* props, const Float3& diffuse) {
+    UberPropsBlock block;
+    block.diffuse = {diffuse, 0};
+    block.diffuse2 = {props->diffuse2, 0};
+    block.diffuseClamp = {props->diffuseClamp, 0};
+    block.specular = props->specular;
+    block.specPower = props->specPower;
+    block.rim = props->rim;
+    block.rimFactor = {props->rimFactor.x, props->rimFactor.y, 0, 0};
+    block.lightDir = {props->lightDir, 0};
+    block.specLightDir = {props->specLightDir, 0};
+    return block;
+}
 
-    if (!props) {
-        props = &UberShader::defaultProps;
-        GL_CHECK(Uniform3fv(this->diffuseUniform, 1, (const GLfloat*) &drawMesh->diffuse));
+// Same as bindMaterialProps
+static void bindUberProps(const UberShader::Props* props, const Float3& diffuse) {
+    if (props->ubo) {
+        GL_CHECK(BindBufferBase(GL_UNIFORM_BUFFER, UniformBlock::Props, props->ubo));
     } else {
-        GL_CHECK(Uniform3fv(this->diffuseUniform, 1, (const GLfloat*) &props->diffuse));
-    }
-    GL_CHECK(Uniform3fv(this->diffuseClampUniform, 1, (const GLfloat*) &props->diffuseClamp));
-    GL_CHECK(Uniform3fv(this->specularUniform, 1, (const GLfloat*) &props->specular));
-    GL_CHECK(Uniform1f(this->specPowerUniform, props->specPower));
-    GL_CHECK(Uniform4fv(this->rimUniform, 1, (const GLfloat*) &props->rim));
-    GL_CHECK(Uniform2fv(this->rimFactorUniform, 1, (const GLfloat*) &props->rimFactor));
-    GL_CHECK(Uniform3fv(this->lightDirUniform, 1, (const GLfloat*) &props->lightDir));
-    GL_CHECK(Uniform3fv(this->specLightDirUniform, 1, (const GLfloat*) &props->specLightDir));
-
-    if (this->boneXformsUniform >= 0 || this->boneXformsCUniform >= 0) {
-        Array<Float4x4> boneXforms;
-        boneXforms.resize(drawMesh->bones.numItems());
-        for (u32 i = 0; i < drawMesh->bones.numItems(); i++) {
-            u32 indexInSkel = drawMesh->bones[i].indexInSkel;
-            boneXforms[i] = boneToModel[indexInSkel] * drawMesh->bones[i].baseModelToBone;
-        }
-        if (this->boneXformsUniform >= 0) {
-            GL_CHECK(UniformMatrix4fv(this->boneXformsUniform, boneXforms.numItems(), GL_FALSE,
-                                      (const GLfloat*) boneXforms.get()));
-        } else {
-            PLY_ASSERT(this->boneXformsCUniform >= 0);
-            GL_CHECK(Uniform4fv(this->boneXformsCUniform, boneXforms.numItems() * 4,
-                                (const GLfloat*) boneXforms.get()));
-        }
+        UberPropsBlock block = packUberProps(props, diffuse);
+        DynamicArrayBuffers::Range range =
+            DynamicArrayBuffers::instance->uploadUniforms({(const char*) &block, sizeof(block)});
+        GL_CHECK(BindBufferRange(GL_UNIFORM_BUFFER, UniformBlock::Props, range.id, range.offset,
+                                 sizeof(block)));
     }
-    if (duotone) {
-        GL_CHECK(Uniform3fv(this->diffuse2Uniform, 1, (const GLfloat*) &props->diffuse2));
-        GL_CHECK(ActiveTexture(GL_TEXTURE0));
-        GL_CHECK(BindTexture(GL_TEXTURE_2D, props->texID));
+}
+
+PLY_NO_INLINE GLBuffer UberShader::createPropsUBO(Props* props) {
+    UberPropsBlock block = packUberProps(props, props->diffuse);
+    GLBuffer ubo = GLBuffer::create({(const char*) &block, sizeof(block)});
+    props->ubo = ubo.id;
+    return ubo;
+}
+
+PLY_NO_INLINE void UberShader::begin(const Float4x4& cameraToViewport) const {
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_TRUE));
+    GL_STATE(Disable(GL_BLEND));
+    CameraUniforms::instance->set(cameraToViewport);
+    if (this->flags & Flags::Duotone) {
         GL_CHECK(Uniform1i(this->texImageUniform, 0));
     }
+}
 
-    // Vertex attributes
+PLY_NO_INLINE void UberShader::bindMesh(const DrawMesh* drawMesh) const {
+    if (GLuint vao = drawMesh->findVAO(this)) {
+        GL_CHECK(BindVertexArray(vao));
+        return;
+    }
     GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, drawMesh->vbo.id));
-    if (skinned) {
+    if (this->flags & Flags::Skinned) {
         PLY_ASSERT(drawMesh->vertexType == DrawMesh::VertexType::Skinned);
         GL_CHECK(EnableVertexAttribArray(this->vertPositionAttrib));
         GL_CHECK(VertexAttribPointer(this->vertPositionAttrib, 3, GL_FLOAT, GL_FALSE,
@@ -598,7 +754,7 @@ PLY_NO_INLINE void UberShader::draw(const Float4x4& cameraToViewport, const Floa
         GL_CHECK(VertexAttribPointer(this->vertBlendWeightsAttrib, 2, GL_FLOAT, GL_FALSE,
                                      (GLsizei) sizeof(VertexPNW2),
                                      (GLvoid*) offsetof(VertexPNW2, blendWeights)));
-    } else if (duotone) {
+    } else if (this->flags & Flags::Duotone) {
         PLY_ASSERT(drawMesh->vertexType == DrawMesh::VertexType::TexturedNormal);
         GL_CHECK(EnableVertexAttribArray(this->vertPositionAttrib));
         GL_CHECK(VertexAttribPointer(this->vertPositionAttrib, 3, GL_FLOAT, GL_FALSE,
@@ -623,21 +779,84 @@ PLY_NO_INLINE void UberShader::draw(const Float4x4& cameraToViewport, const Floa
                                      (GLsizei) sizeof(VertexPN),
                                      (GLvoid*) offsetof(VertexPN, normal)));
     }
-
-    // Draw this VBO
     GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawMesh->indexBuffer.id));
+}
+
+static void setUberUniforms(const UberShader* uber, const Float4x4& modelToCamera,
+                            const DrawMesh* drawMesh, const SkinPalette* palette,
+                            const UberShader::Props* props) {
+    GL_CHECK(UniformMatrix4fv(uber->modelToCameraUniform, 1, GL_FALSE, (GLfloat*) &modelToCamera));
+    if (props) {
+        bindUberProps(props, props->diffuse);
+    } else {
+        bindUberProps(&UberShader::defaultProps, drawMesh->diffuse);
+    }
+
+    if (uber->flags & UberShader::Flags::Skinned) {
+        PLY_ASSERT(palette);
+        GL_CHECK(BindBufferBase(GL_UNIFORM_BUFFER, UniformBlock::Bones, palette->ubo.id));
+    }
+}
+
+PLY_NO_INLINE void UberShader::drawBound(const Float4x4& modelToCamera, const DrawMesh* drawMesh,
+                                         const SkinPalette* palette, const Props* props) const {
+    PLY_ASSERT(!(this->flags & Flags::Instanced));
+    setUberUniforms(this, modelToCamera, drawMesh, palette, props);
     GL_CHECK(
         DrawElements(GL_TRIANGLES, (GLsizei) drawMesh->numIndices, GL_UNSIGNED_SHORT, (void*) 0));
+}
+
+PLY_NO_INLINE void UberShader::bindInstances(GLuint instanceVBO, u32 firstInstance) const {
+    PLY_ASSERT(this->flags & Flags::Instanced);
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, instanceVBO));
+    for (u32 c = 0; c < 4; c++) {
+        GL_CHECK(EnableVertexAttribArray(this->instItemToGroupAttrib + c));
+        GL_CHECK(VertexAttribPointer(
+            this->instItemToGroupAttrib + c, 4, GL_FLOAT, GL_FALSE, (GLsizei) sizeof(Float4x4),
+            (GLvoid*) (sizeof(Float4x4) * firstInstance + sizeof(Float4) * c)));
+        GL_CHECK(VertexAttribDivisor(this->instItemToGroupAttrib + c, 1));
+    }
+}
 
+PLY_NO_INLINE void UberShader::drawBoundInstanced(const Float4x4& groupToCamera,
+                                                  const DrawMesh* drawMesh, u32 numInstances,
+                                                  const Props* props) const {
+    PLY_ASSERT(this->flags & Flags::Instanced);
+    setUberUniforms(this, groupToCamera, drawMesh, nullptr, props);
+    GL_CHECK(DrawElementsInstanced(GL_TRIANGLES, (GLsizei) drawMesh->numIndices, GL_UNSIGNED_SHORT,
+                                   (void*) 0, (GLsizei) numInstances));
+}
+
+PLY_NO_INLINE void UberShader::end() const {
+    GL_CHECK(BindVertexArray(GLVertexArray::defaultID));
     GL_CHECK(DisableVertexAttribArray(this->vertPositionAttrib));
     GL_CHECK(DisableVertexAttribArray(this->vertNormalAttrib));
-    if (duotone) {
+    if (this->flags & Flags::Duotone) {
         GL_CHECK(DisableVertexAttribArray(this->vertTexCoordAttrib));
     }
-    if (skinned) {
+    if (this->flags & Flags::Skinned) {
         GL_CHECK(DisableVertexAttribArray(this->vertBlendIndicesAttrib));
         GL_CHECK(DisableVertexAttribArray(this->vertBlendWeightsAttrib));
     }
+    if (this->flags & Flags::Instanced) {
+        for (u32 c = 0; c < 4; c++) {
+            GL_CHECK(VertexAttribDivisor(this->instItemToGroupAttrib + c, 0));
+            GL_CHECK(DisableVertexAttribArray(this->instItemToGroupAttrib + c));
+        }
+    }
+}
+
+PLY_NO_INLINE void UberShader::draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
+                                    const DrawMesh* drawMesh, const SkinPalette* palette,
+                                    const Props* props) const {
+    this->begin(cameraToViewport);
+    if (this->flags & Flags::Duotone) {
+        GL_STATE(ActiveTexture(GL_TEXTURE0));
+        GL_STATE(BindTexture(GL_TEXTURE_2D, (props ? props : &defaultProps)->texID));
+    }
+    this->bindMesh(drawMesh);
+    this->drawBound(modelToCamera, drawMesh, palette, props);
+    this->end();
 }
 
 //---------------------------------------------------------
@@ -694,10 +913,10 @@ void main() {
 
 PLY_NO_INLINE void GradientShader::draw(const Float4x4& modelToViewport, const DrawMesh* drawMesh,
                                         const Float4& color0, const Float4& color1) {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_TRUE));
-    GL_CHECK(Disable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_TRUE));
+    GL_STATE(Disable(GL_BLEND));
 
     // Uniforms
     GL_CHECK(
@@ -775,14 +994,14 @@ PLY_NO_INLINE Owned<FlatShader> FlatShader::create() {
 
 PLY_NO_INLINE void FlatShader::draw(const Float4x4& modelToViewport, const DrawMesh* drawMesh,
                                     bool writeDepth, bool useDepth) {
-    GL_CHECK(UseProgram(this->shader.id));
+    GL_STATE(UseProgram(this->shader.id));
     if (useDepth) {
-        GL_CHECK(Enable(GL_DEPTH_TEST));
+        GL_STATE(Enable(GL_DEPTH_TEST));
     } else {
-        GL_CHECK(Disable(GL_DEPTH_TEST));
+        GL_STATE(Disable(GL_DEPTH_TEST));
     }
-    GL_CHECK(DepthMask(writeDepth ? GL_TRUE : GL_FALSE));
-    GL_CHECK(Disable(GL_BLEND));
+    GL_STATE(DepthMask(writeDepth ? GL_TRUE : GL_FALSE));
+    GL_STATE(Disable(GL_BLEND));
 
     GL_CHECK(
         UniformMatrix4fv(this->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
@@ -806,20 +1025,20 @@ PLY_NO_INLINE void FlatShader::draw(const Float4x4& modelToViewport, const DrawM
 
 PLY_NO_INLINE void FlatShader::drawQuad(const Float4x4& modelToViewport, const Float4& linearColor,
                                         bool useDepth) {
-    GL_CHECK(UseProgram(this->shader.id));
+    GL_STATE(UseProgram(this->shader.id));
     if (useDepth) {
-        GL_CHECK(Enable(GL_DEPTH_TEST));
-        GL_CHECK(DepthMask(GL_TRUE));
+        GL_STATE(Enable(GL_DEPTH_TEST));
+        GL_STATE(DepthMask(GL_TRUE));
     } else {
-        GL_CHECK(Disable(GL_DEPTH_TEST));
-        GL_CHECK(DepthMask(GL_FALSE));
+        GL_STATE(Disable(GL_DEPTH_TEST));
+        GL_STATE(DepthMask(GL_FALSE));
     }
     if (linearColor.a() >= 1.f) {
-        GL_CHECK(Disable(GL_BLEND));
+        GL_STATE(Disable(GL_BLEND));
     } else {
-        GL_CHECK(Enable(GL_BLEND));
+        GL_STATE(Enable(GL_BLEND));
         GL_CHECK(BlendEquation(GL_FUNC_ADD));
-        GL_CHECK(BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+        GL_STATE(BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
     }
 
     GL_CHECK(
@@ -896,32 +1115,33 @@ void main() {
 
 PLY_NO_INLINE void StarShader::draw(const DrawMesh* drawMesh, GLuint textureID,
                                     ArrayView<const InstanceData> instanceData) {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
-    GL_CHECK(BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    GL_STATE(BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
 
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(this->textureUniform, 0));
 
     // Instance attributes
-    GLuint ibo = DynamicArrayBuffers::instance->upload(instanceData.stringView());
-    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ibo));
+    DynamicArrayBuffers::Range ibo =
+        DynamicArrayBuffers::instance->upload(instanceData.stringView());
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ibo.id));
     for (u32 c = 0; c < 4; c++) {
         GL_CHECK(EnableVertexAttribArray(this->instModelToViewportAttrib + c));
         GL_CHECK(VertexAttribPointer(
             this->instModelToViewportAttrib + c, 4, GL_FLOAT, GL_FALSE,
             (GLsizei) sizeof(InstanceData),
-            (GLvoid*) (offsetof(InstanceData, modelToViewport) + sizeof(Float4) * c)));
+            ibo.ptr(offsetof(InstanceData, modelToViewport) + sizeof(Float4) * c)));
         GL_CHECK(VertexAttribDivisor(this->instModelToViewportAttrib + c, 1));
     }
     GL_CHECK(EnableVertexAttribArray(this->instColorAttrib));
     GL_CHECK(VertexAttribPointer(this->instColorAttrib, 4, GL_FLOAT, GL_FALSE,
                                  (GLsizei) sizeof(InstanceData),
-                                 (GLvoid*) offsetof(InstanceData, color)));
+                                 ibo.ptr(offsetof(InstanceData, color))));
     GL_CHECK(VertexAttribDivisor(this->instColorAttrib, 1));
 
     // Draw
@@ -986,12 +1206,12 @@ PLY_NO_INLINE Owned<RayShader> RayShader::create() {
 }
 
 PLY_NO_INLINE void RayShader::draw(const Float4x4& modelToViewport, const DrawMesh* drawMesh) {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
-    GL_CHECK(BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    GL_STATE(BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
 
     GL_CHECK(
         UniformMatrix4fv(this->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
@@ -1075,19 +1295,19 @@ PLY_NO_INLINE Owned<FlashShader> FlashShader::create() {
 
 void FlashShader::drawQuad(const Float4x4& modelToViewport, const Float4& vertToTexCoord,
                            GLuint textureID, const Float4& color) const {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Disable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     // Premultiplied alpha
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
-    GL_CHECK(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_SRC_ALPHA));
+    GL_STATE(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_SRC_ALPHA));
 
     GL_CHECK(
         UniformMatrix4fv(this->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
     GL_CHECK(Uniform4fv(this->vertToTexCoordUniform, 1, (GLfloat*) &vertToTexCoord));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(this->textureUniform, 0));
     GL_CHECK(Uniform4fv(this->colorUniform, 1, (const GLfloat*) &color));
 
@@ -1156,40 +1376,41 @@ PLY_NO_INLINE Owned<TexturedShader> TexturedShader::create() {
 }
 
 void drawTexturedShader(const TexturedShader* shader, const Float4x4& modelToViewport,
-                        GLuint textureID, const Float4& color, GLuint vboID, GLuint indicesID,
-                        u32 numIndices, bool depthTest, bool useDstAlpha) {
-    GL_CHECK(UseProgram(shader->shader.id));
+                        GLuint textureID, const Float4& color, DynamicArrayBuffers::Range vbo,
+                        DynamicArrayBuffers::Range indices, u32 numIndices, bool depthTest,
+                        bool useDstAlpha) {
+    GL_STATE(UseProgram(shader->shader.id));
     if (depthTest) {
-        GL_CHECK(Enable(GL_DEPTH_TEST));
+        GL_STATE(Enable(GL_DEPTH_TEST));
     } else {
-        GL_CHECK(Disable(GL_DEPTH_TEST));
+        GL_STATE(Disable(GL_DEPTH_TEST));
     }
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     // Premultiplied alpha
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
-    GL_CHECK(BlendFuncSeparate(useDstAlpha ? GL_DST_ALPHA : GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE));
+    GL_STATE(BlendFuncSeparate(useDstAlpha ? GL_DST_ALPHA : GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE));
 
     GL_CHECK(
         UniformMatrix4fv(shader->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(shader->textureUniform, 0));
     GL_CHECK(Uniform4fv(shader->colorUniform, 1, (const GLfloat*) &color));
 
     // Bind VBO
-    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, vboID));
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, vbo.id));
     GL_CHECK(EnableVertexAttribArray(shader->positionAttrib));
     GL_CHECK(VertexAttribPointer(shader->positionAttrib, 4, GL_FLOAT, GL_FALSE,
-                                 (GLsizei) sizeof(VertexPT), (GLvoid*) offsetof(VertexPT, pos)));
+                                 (GLsizei) sizeof(VertexPT), vbo.ptr(offsetof(VertexPT, pos))));
     GL_CHECK(EnableVertexAttribArray(shader->texCoordAttrib));
     GL_CHECK(VertexAttribPointer(shader->texCoordAttrib, 2, GL_FLOAT, GL_FALSE,
-                                 (GLsizei) sizeof(VertexPT), (GLvoid*) offsetof(VertexPT, uv)));
+                                 (GLsizei) sizeof(VertexPT), vbo.ptr(offsetof(VertexPT, uv))));
 
     // Bind index buffer
-    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indicesID));
+    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.id));
 
-    GL_CHECK(DrawElements(GL_TRIANGLES, (GLsizei) numIndices, GL_UNSIGNED_SHORT, (void*) 0));
+    GL_CHECK(DrawElements(GL_TRIANGLES, (GLsizei) numIndices, GL_UNSIGNED_SHORT, indices.ptr()));
 
     GL_CHECK(DisableVertexAttribArray(shader->positionAttrib));
     GL_CHECK(DisableVertexAttribArray(shader->texCoordAttrib));
@@ -1198,17 +1419,17 @@ void drawTexturedShader(const TexturedShader* shader, const Float4x4& modelToVie
 void TexturedShader::draw(const Float4x4& modelToViewport, GLuint textureID, const Float4& color,
                           const DrawMesh* drawMesh, bool depthTest) {
     PLY_ASSERT(drawMesh->vertexType == DrawMesh::VertexType::TexturedFlat);
-    drawTexturedShader(this, modelToViewport, textureID, color, drawMesh->vbo.id,
-                       drawMesh->indexBuffer.id, drawMesh->numIndices, depthTest, false);
+    drawTexturedShader(this, modelToViewport, textureID, color, {drawMesh->vbo.id, 0},
+                       {drawMesh->indexBuffer.id, 0}, drawMesh->numIndices, depthTest, false);
 }
 
 void TexturedShader::draw(const Float4x4& modelToViewport, GLuint textureID, const Float4& color,
                           ArrayView<VertexPT> vertices, ArrayView<u16> indices,
                           bool useDstAlpha) const {
-    GLuint vboID = DynamicArrayBuffers::instance->upload(vertices.stringView());
-    GLuint indicesID = DynamicArrayBuffers::instance->upload(indices.stringView());
-    drawTexturedShader(this, modelToViewport, textureID, color, vboID, indicesID, indices.numItems,
-                       false, useDstAlpha);
+    DynamicArrayBuffers::Range vbo = DynamicArrayBuffers::instance->upload(vertices.stringView());
+    DynamicArrayBuffers::Range ibo = DynamicArrayBuffers::instance->upload(indices.stringView());
+    drawTexturedShader(this, modelToViewport, textureID, color, vbo, ibo, indices.numItems, false,
+                       useDstAlpha);
 }
 
 //---------------------------------------------------------
@@ -1319,35 +1540,36 @@ PLY_NO_INLINE void HypnoShader::draw(const Float4x4& modelToViewport, GLuint tex
         }
         exp += 1;
     }
-    GLuint ibo = DynamicArrayBuffers::instance->upload(instAttribs.stringView());
+    DynamicArrayBuffers::Range ibo =
+        DynamicArrayBuffers::instance->upload(instAttribs.stringView());
 
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Disable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Disable(GL_BLEND));
 
     // Uniforms
     GL_CHECK(
         UniformMatrix4fv(this->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(this->textureUniform, 0));
-    GL_CHECK(ActiveTexture(GL_TEXTURE1));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, palette.id));
+    GL_STATE(ActiveTexture(GL_TEXTURE1));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, palette.id));
     GL_CHECK(Uniform1i(this->paletteUniform, 1));
     GL_CHECK(Uniform1f(this->paletteSizeUniform, (GLfloat) palette.width));
 
     // Instance attributes
-    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ibo));
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ibo.id));
     GL_CHECK(EnableVertexAttribArray(this->instPlacementAttrib));
     GL_CHECK(VertexAttribPointer(this->instPlacementAttrib, 3, GL_FLOAT, GL_FALSE,
                                  (GLsizei) sizeof(InstanceAttribs),
-                                 (GLvoid*) offsetof(InstanceAttribs, placement)));
+                                 ibo.ptr(offsetof(InstanceAttribs, placement))));
     GL_CHECK(VertexAttribDivisor(this->instPlacementAttrib, 1));
     GL_CHECK(EnableVertexAttribArray(this->instScaleAttrib));
     GL_CHECK(VertexAttribPointer(this->instScaleAttrib, 2, GL_FLOAT, GL_FALSE,
                                  (GLsizei) sizeof(InstanceAttribs),
-                                 (GLvoid*) offsetof(InstanceAttribs, scale)));
+                                 ibo.ptr(offsetof(InstanceAttribs, scale))));
     GL_CHECK(VertexAttribDivisor(this->instScaleAttrib, 1));
 
     // Draw
@@ -1435,20 +1657,20 @@ PLY_NO_INLINE Owned<CopyShader> CopyShader::create() {
 
 PLY_NO_INLINE void CopyShader::drawQuad(const Float4x4& modelToViewport, GLuint textureID,
                                         float opacity, float premul) const {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Disable(GL_DEPTH_TEST));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
     if (opacity >= 1.f) {
-        GL_CHECK(Disable(GL_BLEND));
+        GL_STATE(Disable(GL_BLEND));
     } else {
-        GL_CHECK(Enable(GL_BLEND));
+        GL_STATE(Enable(GL_BLEND));
         GL_CHECK(BlendEquation(GL_FUNC_ADD));
-        GL_CHECK(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_SRC_ALPHA));
+        GL_STATE(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_SRC_ALPHA));
     }
 
     GL_CHECK(
         UniformMatrix4fv(this->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(this->textureUniform, 0));
     GL_CHECK(Uniform1f(this->opacityUniform, opacity));
     Float4 premulColor = {Float3{premul}, 1.f - premul};
@@ -1472,6 +1694,95 @@ PLY_NO_INLINE void CopyShader::drawQuad(const Float4x4& modelToViewport, GLuint
 
 //---------------------------------------------------------
 
+PLY_NO_INLINE Owned<LayerShader> LayerShader::create() {
+    Owned<LayerShader> layerShader = new LayerShader;
+    {
+        Shader vertexShader = Shader::compile(
+            GL_VERTEX_SHADER, "in vec3 vertPosition;\n"
+                              "in vec2 vertTexCoord;\n"
+                              "uniform mat4 modelToViewport;\n"
+                              "out vec2 fragTexCoord; \n"
+                              "\n"
+                              "void main() {\n"
+                              "    gl_Position = modelToViewport * vec4(vertPosition, 1.0);\n"
+                              "    fragTexCoord = vertTexCoord;\n"
+                              "}\n");
+
+        Shader fragmentShader = Shader::compile(GL_FRAGMENT_SHADER,
+                                                "in vec2 fragTexCoord;\n"
+                                                "uniform sampler2D texImage;\n"
+                                                "out vec4 fragColor;\n"
+                                                "\n"
+                                                "void main() {\n"
+                                                "    fragColor = texture(texImage, fragTexCoord);\n"
+                                                "}\n");
+
+        // Link shader program
+        layerShader->shader = ShaderProgram::link({vertexShader.id, fragmentShader.id});
+    }
+
+    // Get shader program's vertex attribute and uniform locations
+    layerShader->vertPositionAttrib =
+        GL_NO_CHECK(GetAttribLocation(layerShader->shader.id, "vertPosition"));
+    PLY_ASSERT(layerShader->vertPositionAttrib >= 0);
+    layerShader->vertTexCoordAttrib =
+        GL_NO_CHECK(GetAttribLocation(layerShader->shader.id, "vertTexCoord"));
+    PLY_ASSERT(layerShader->vertTexCoordAttrib >= 0);
+    layerShader->modelToViewportUniform =
+        GL_NO_CHECK(GetUniformLocation(layerShader->shader.id, "modelToViewport"));
+    PLY_ASSERT(layerShader->modelToViewportUniform >= 0);
+    layerShader->textureUniform =
+        GL_NO_CHECK(GetUniformLocation(layerShader->shader.id, "texImage"));
+    PLY_ASSERT(layerShader->textureUniform >= 0);
+
+    // Create vertex and index buffers
+    Array<VertexPT> vertices = {
+        {{-1.f, -1.f, 0.f}, {0.f, 0.f}},
+        {{1.f, -1.f, 0.f}, {1.f, 0.f}},
+        {{1.f, 1.f, 0.f}, {1.f, 1.f}},
+        {{-1.f, 1.f, 0.f}, {0.f, 1.f}},
+    };
+    layerShader->quadVBO = GLBuffer::create(vertices.stringView());
+    Array<u16> indices = {(u16) 0, 1, 2, 2, 3, 0};
+    layerShader->quadIndices = GLBuffer::create(indices.stringView());
+    layerShader->quadNumIndices = indices.numItems();
+
+    return layerShader;
+}
+
+PLY_NO_INLINE void LayerShader::drawQuad(const Float4x4& modelToViewport,
+                                         GLuint textureID) const {
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
+    GL_CHECK(BlendEquation(GL_FUNC_ADD));
+    GL_STATE(BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    GL_CHECK(
+        UniformMatrix4fv(this->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_CHECK(Uniform1i(this->textureUniform, 0));
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, this->quadVBO.id));
+    GL_CHECK(EnableVertexAttribArray(this->vertPositionAttrib));
+    GL_CHECK(VertexAttribPointer(this->vertPositionAttrib, 3, GL_FLOAT, GL_FALSE,
+                                 (GLsizei) sizeof(VertexPT), (GLvoid*) offsetof(VertexPT, pos)));
+    GL_CHECK(EnableVertexAttribArray(this->vertTexCoordAttrib));
+    GL_CHECK(VertexAttribPointer(this->vertTexCoordAttrib, 2, GL_FLOAT, GL_FALSE,
+                                 (GLsizei) sizeof(VertexPT), (GLvoid*) offsetof(VertexPT, uv)));
+
+    // Draw quad
+    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quadIndices.id));
+    GL_CHECK(
+        DrawElements(GL_TRIANGLES, (GLsizei) this->quadNumIndices, GL_UNSIGNED_SHORT, (void*) 0));
+
+    GL_CHECK(DisableVertexAttribArray(this->vertTexCoordAttrib));
+    GL_CHECK(DisableVertexAttribArray(this->vertPositionAttrib));
+}
+
+//---------------------------------------------------------
+
 PLY_NO_INLINE Owned<ColorCorrectShader> ColorCorrectShader::create() {
     Owned<ColorCorrectShader> colorCorrect = new ColorCorrectShader;
     {
@@ -1510,12 +1821,12 @@ PLY_NO_INLINE Owned<ColorCorrectShader> ColorCorrectShader::create() {
 }
 
 PLY_NO_INLINE void ColorCorrectShader::draw(const DrawMesh* drawMesh, GLuint textureID) const {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Disable(GL_DEPTH_TEST));
-    GL_CHECK(Disable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
+    GL_STATE(Disable(GL_BLEND));
 
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(this->textureUniform, 0));
 
     // Draw mesh (typically a fullscreen quad)
@@ -1619,33 +1930,34 @@ PLY_NO_INLINE void PuffShader::draw(const Float4x4& worldToViewport, GLuint text
     if (instanceData.isEmpty())
         return;
 
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Enable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Enable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
-    GL_CHECK(BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE));
+    GL_STATE(BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE));
 
     GL_CHECK(
         UniformMatrix4fv(this->worldToViewportUniform, 1, GL_FALSE, (GLfloat*) &worldToViewport));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(this->textureUniform, 0));
 
     // Instance attributes
-    GLuint ibo = DynamicArrayBuffers::instance->upload(instanceData.stringView());
-    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ibo));
+    DynamicArrayBuffers::Range ibo =
+        DynamicArrayBuffers::instance->upload(instanceData.stringView());
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ibo.id));
     for (u32 c = 0; c < 4; c++) {
         GL_CHECK(EnableVertexAttribArray(this->instModelToWorldAttrib + c));
         GL_CHECK(VertexAttribPointer(
             this->instModelToWorldAttrib + c, 4, GL_FLOAT, GL_FALSE, (GLsizei) sizeof(InstanceData),
-            (GLvoid*) (offsetof(InstanceData, modelToWorld) + sizeof(Float4) * c)));
+            ibo.ptr(offsetof(InstanceData, modelToWorld) + sizeof(Float4) * c)));
         GL_CHECK(VertexAttribDivisor(this->instModelToWorldAttrib + c, 1));
     }
     GL_CHECK(EnableVertexAttribArray(this->instColorAlphaAttrib));
     GL_CHECK(VertexAttribPointer(this->instColorAlphaAttrib, 2, GL_FLOAT, GL_FALSE,
                                  (GLsizei) sizeof(InstanceData),
-                                 (GLvoid*) offsetof(InstanceData, colorAlpha)));
+                                 ibo.ptr(offsetof(InstanceData, colorAlpha))));
     GL_CHECK(VertexAttribDivisor(this->instColorAlphaAttrib, 1));
 
     // Draw
@@ -1721,17 +2033,17 @@ PLY_NO_INLINE Owned<ShapeShader> ShapeShader::create() {
 
 void ShapeShader::draw(const Float4x4& modelToViewport, GLuint textureID, const Float4& color,
                        float slope, const DrawMesh* drawMesh) {
-    GL_CHECK(UseProgram(this->shader.id));
-    GL_CHECK(Disable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    GL_STATE(UseProgram(this->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
-    GL_CHECK(BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE));
+    GL_STATE(BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE));
 
     GL_CHECK(
         UniformMatrix4fv(this->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
     GL_CHECK(Uniform1i(this->textureUniform, 0));
     GL_CHECK(Uniform4fv(this->colorUniform, 1, (const GLfloat*) &color));
     GL_CHECK(Uniform1f(this->slopeUniform, slope));
@@ -1756,3 +2068,5 @@ void ShapeShader::draw(const Float4x4& modelToViewport, GLuint textureID, const
 }
 
 } // namespace flap
+
+#endif // !FLAPGAME_HEADLESS
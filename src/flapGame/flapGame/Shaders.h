@@ -5,12 +5,17 @@
 
 namespace flap {
 
+// MaterialShader, TexturedMaterialShader, PipeShader and UberShader read cameraToViewport from the
+// shared UniformBlock::Camera buffer, and their props from a UniformBlock::Props buffer.
 struct MaterialShader {
     struct Props {
         Float3 diffuse = {1, 1, 1};
         Float3 specular = {0.2f, 0.2f, 0.2f};
         float specPower = 5.f;
         Float4 fog = {0, 0, 0, 1};
+        // Uniform buffer created by createPropsUBO. Props without one are uploaded on each draw.
+        // It isn't updated if the props change afterwards.
+        GLuint ubo = 0;
     };
     static Props defaultProps;
 
@@ -18,16 +23,20 @@ struct MaterialShader {
     GLint vertPositionAttrib = 0;
     GLint vertNormalAttrib = 0;
     GLint modelToCameraUniform = 0;
-    GLint cameraToViewportUniform = 0;
-    GLint colorUniform = 0;
-    GLint specularUniform = 0;
-    GLint specPowerUniform = 0;
-    GLint fogUniform = 0;
 
     static Owned<MaterialShader> create();
-
+    // Also used by TexturedMaterialShader. Sets props->ubo; the caller owns the returned buffer.
+    static GLBuffer createPropsUBO(Props* props);
+
+    // draw is equivalent to calling begin, bindMesh, drawBound and end in sequence. DrawList calls
+    // them separately so that consecutive draws can share the program and mesh setup.
+    void begin(const Float4x4& cameraToViewport) const;
+    void bindMesh(const DrawMesh* drawMesh) const;
+    void drawBound(const Float4x4& modelToCamera, const DrawMesh* drawMesh,
+                   const Props* props = nullptr) const;
+    void end() const;
     void draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
-              const DrawMesh* drawMesh, const Props* props = nullptr);
+              const DrawMesh* drawMesh, const Props* props = nullptr) const;
 };
 
 struct TexturedMaterialShader {
@@ -44,31 +53,81 @@ struct TexturedMaterialShader {
     GLint vertTexCoordAttrib = 0;
     GLint vertNormalAttrib = 0;
     GLint modelToCameraUniform = 0;
-    GLint cameraToViewportUniform = 0;
     GLint textureUniform = 0;
-    GLint specularUniform = 0;
-    GLint specPowerUniform = 0;
-    GLint fogUniform = 0;
 
     static Owned<TexturedMaterialShader> create();
 
+    // Same as MaterialShader. The texture is bound to texture unit 0 by draw, or by the caller
+    // when using the other functions.
+    void begin(const Float4x4& cameraToViewport) const;
+    void bindMesh(const DrawMesh* drawMesh) const;
+    void drawBound(const Float4x4& modelToCamera, const DrawMesh* drawMesh,
+                   const MaterialShader::Props* props = nullptr) const;
+    void end() const;
     void draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
-              const DrawMesh* drawMesh, GLuint texID, const MaterialShader::Props* props = nullptr);
+              const DrawMesh* drawMesh, GLuint texID,
+              const MaterialShader::Props* props = nullptr) const;
 };
 
 struct PipeShader {
+    // When instanced, modelToCamera is a world-to-camera transform, and each instance supplies its
+    // own model-to-world transform from an instance buffer.
+    bool instanced = false;
     ShaderProgram shader;
     GLint vertPositionAttrib = 0;
     GLint vertNormalAttrib = 0;
+    GLint instModelToWorldAttrib = -1;
     GLint modelToCameraUniform = 0;
-    GLint cameraToViewportUniform = 0;
     GLint normalSkewUniform = 0;
     GLint textureUniform = 0;
 
-    static Owned<PipeShader> create();
-
+    static Owned<PipeShader> create(bool instanced = false);
+
+    // Same as TexturedMaterialShader
+    void begin(const Float4x4& cameraToViewport) const;
+    void bindMesh(const DrawMesh* drawMesh) const;
+    void drawBound(const Float4x4& modelToCamera, const Float2& normalSkew,
+                   const DrawMesh* drawMesh) const;
+    // Instanced shaders only. instanceVBO holds an array of Float3x4 model-to-world transforms.
+    void bindInstances(GLuint instanceVBO, u32 firstInstance) const;
+    void drawBoundInstanced(const Float4x4& worldToCamera, const Float2& normalSkew,
+                            const DrawMesh* drawMesh, u32 numInstances) const;
+    void end() const;
     void draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
-              const Float2& normalSkew, const DrawMesh* drawMesh, GLuint texID);
+              const Float2& normalSkew, const DrawMesh* drawMesh, GLuint texID) const;
+};
+
+// The skinning transforms needed by every mesh skinned to one skeleton. At load time, each mesh
+// bone is assigned a slot by addSlot, and the mesh's blend indices refer to slots instead of its
+// own bones. Read-only once the meshes are loaded.
+struct SkinPaletteLayout {
+    static constexpr u32 MaxSlots = 64; // Size of BonesBlock in UberShader
+
+    struct Slot {
+        u32 indexInSkel = 0;
+        Float4x4 baseModelToBone = Float4x4::identity();
+    };
+
+    Array<Slot> slots;
+    u32 numSkelBones = 0;
+
+    // Returns the existing slot if the same pair was already added.
+    u32 addSlot(u32 indexInSkel, const Float4x4& baseModelToBone);
+};
+
+// The final skinning transforms of a SkinPaletteLayout for the current frame, shared by every mesh
+// that uses the layout. Each frame, the caller calls begin, writes the skeleton's pose to
+// boneToModel and calls update, which computes every slot once and uploads them to the
+// UniformBlock::Bones buffer.
+struct SkinPalette {
+    const SkinPaletteLayout* layout = nullptr;
+    Array<Float4x4> boneToModel; // Current pose, indexed like the skeleton
+    Array<Float4x4> xforms;      // Staging for update; reused across frames
+    GLBuffer ubo;
+
+    // Sizes boneToModel for layout, and creates the uniform buffer the first time.
+    void begin(const SkinPaletteLayout* layout);
+    void update();
 };
 
 struct UberShader {
@@ -83,6 +142,7 @@ struct UberShader {
         Float2 rimFactor = {1.f, 2.5f};
         Float3 lightDir = {0, 0, 0};
         Float3 specLightDir = {0, 0, 0};
+        GLuint ubo = 0; // Same as MaterialShader::Props::ubo. Doesn't include texID.
 
         PLY_INLINE Props() {
             this->lightDir = Float3{1.f, -1.f, -0.5f}.normalized();
@@ -95,6 +155,9 @@ struct UberShader {
     struct Flags {
         static constexpr u32 Skinned = 1;
         static constexpr u32 Duotone = 2;
+        // modelToCamera becomes a group-to-camera transform, and each instance supplies its own
+        // item-to-group transform from an instance buffer. Not compatible with Skinned.
+        static constexpr u32 Instanced = 4;
     };
 
     u32 flags = 0;
@@ -104,28 +167,44 @@ struct UberShader {
     GLint vertTexCoordAttrib = -1;
     GLint vertBlendIndicesAttrib = -1;
     GLint vertBlendWeightsAttrib = -1;
+    GLint instItemToGroupAttrib = -1;
     GLint modelToCameraUniform = -1;
-    GLint cameraToViewportUniform = -1;
-    GLint diffuseUniform = -1;
-    GLint diffuse2Uniform = -1;
-    GLint diffuseClampUniform = -1;
-    GLint specularUniform = -1;
-    GLint specPowerUniform = -1;
-    GLint rimUniform = -1;
-    GLint rimFactorUniform = -1;
-    GLint lightDirUniform = -1;
-    GLint specLightDirUniform = -1;
-    GLint boneXformsUniform = -1;
-    GLint boneXformsCUniform = -1;
     GLint texImageUniform = -1;
 
     static Owned<UberShader> create(u32 flags);
-
+    static GLBuffer createPropsUBO(Props* props);
+
+    // Same as TexturedMaterialShader. Only Duotone shaders use Props::texID.
+    void begin(const Float4x4& cameraToViewport) const;
+    void bindMesh(const DrawMesh* drawMesh) const;
+    // Skinned shaders only use palette, which must be updated before drawing.
+    void drawBound(const Float4x4& modelToCamera, const DrawMesh* drawMesh,
+                   const SkinPalette* palette, const Props* props = nullptr) const;
+    // Instanced shaders only. instanceVBO holds an array of Float4x4 item-to-group transforms.
+    void bindInstances(GLuint instanceVBO, u32 firstInstance) const;
+    void drawBoundInstanced(const Float4x4& groupToCamera, const DrawMesh* drawMesh,
+                            u32 numInstances, const Props* props = nullptr) const;
+    void end() const;
     void draw(const Float4x4& cameraToViewport, const Float4x4& modelToCamera,
-              const DrawMesh* drawMesh, ArrayView<const Float4x4> boneToModel,
-              const Props* props = nullptr);
+              const DrawMesh* drawMesh, const SkinPalette* palette,
+              const Props* props = nullptr) const;
 };
 
+// Records the vertex attribute setup done by shader->bindMesh(drawMesh) into a VAO owned by
+// drawMesh. After that, bindMesh just binds the VAO, and end rebinds GLVertexArray::defaultID.
+// Works with MaterialShader, TexturedMaterialShader, PipeShader and UberShader. Call it once per
+// pair.
+template <typename ShaderType>
+void buildVAO(const ShaderType* shader, const DrawMesh* drawMesh) {
+    GLVertexArray vao = GLVertexArray::create();
+    GL_CHECK(BindVertexArray(vao.id));
+    shader->bindMesh(drawMesh);
+    GL_CHECK(BindVertexArray(GLVertexArray::defaultID));
+    DrawMesh::VAO& entry = drawMesh->vaos.append();
+    entry.shader = shader;
+    entry.vao = std::move(vao);
+}
+
 struct GradientShader {
     ShaderProgram shader;
     GLint vertPositionAttrib = -1;
@@ -249,6 +328,22 @@ struct CopyShader {
                   float premul) const;
 };
 
+// Draws a texture over the framebuffer, using its alpha as coverage. Used to composite layers that
+// were rendered to a texture cleared to transparent black.
+struct LayerShader {
+    ShaderProgram shader;
+    GLint vertPositionAttrib = 0;
+    GLint vertTexCoordAttrib = 0;
+    GLint modelToViewportUniform = 0;
+    GLint textureUniform = 0;
+    GLBuffer quadVBO;
+    GLBuffer quadIndices;
+    u32 quadNumIndices = 0;
+
+    static PLY_NO_INLINE Owned<LayerShader> create();
+    void drawQuad(const Float4x4& modelToViewport, GLuint textureID) const;
+};
+
 struct ColorCorrectShader {
     ShaderProgram shader;
     GLint vertPositionAttrib = 0;
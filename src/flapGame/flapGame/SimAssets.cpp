@@ -0,0 +1,298 @@
+#include <flapGame/Core.h>
+#include <flapGame/SimAssets.h>
+#include <assimp/Importer.hpp> // C++ importer interface
+#include <assimp/scene.h>      // Output data structure
+#include <ply-runtime/algorithm/Find.h>
+
+namespace flap {
+
+const SimAssets* SimAssets::instance = nullptr;
+
+StringView toStringView(const aiString& aiStr) {
+    return {aiStr.data, safeDemote<u32>(aiStr.length)};
+}
+
+void extractBones(Array<Bone>* resultBones, const aiNode* srcNode, s32 parentIdx = -1) {
+    for (u32 i = 0; i < srcNode->mNumChildren; i++) {
+        const aiNode* child = srcNode->mChildren[i];
+        u32 boneIdx = resultBones->numItems();
+        Bone& bone = resultBones->append();
+        bone.name = toStringView(child->mName);
+        bone.parentIdx = parentIdx;
+        bone.boneToParent = ((const Float4x4*) &child->mTransformation)->transposed();
+        if (parentIdx >= 0) {
+            bone.boneToModel = (*resultBones)[parentIdx].boneToModel * bone.boneToParent;
+        } else {
+            bone.boneToModel = bone.boneToParent;
+        }
+        extractBones(resultBones, child, boneIdx);
+    }
+}
+
+Quaternion toQuat(const aiQuaternion& q) {
+    return {q.x, q.y, q.z, q.w};
+}
+
+template <typename T, typename Convert>
+auto sampleFromKeys(ArrayView<const T> keys, float time, const Convert& convert) {
+    PLY_ASSERT(keys.numItems > 0);
+    u32 i = 0;
+    for (; i < keys.numItems; i++) {
+        if (keys[i].mTime > time)
+            break;
+    }
+    if (i == 0) {
+        return convert(keys[i].mValue);
+    } else if (i >= keys.numItems) {
+        return convert(keys.back().mValue);
+    } else {
+        const T& k0 = keys[i - 1];
+        const T& k1 = keys[i];
+        float f = unmix((float) k0.mTime, (float) k1.mTime, time);
+        return mix(convert(k0.mValue), convert(k1.mValue), f);
+    }
+}
+
+QuatPosScale sampleAnimCurve(const aiNodeAnim* channel, float time) {
+    QuatPosScale result;
+    result.quat = sampleFromKeys<aiQuatKey>({channel->mRotationKeys, channel->mNumRotationKeys},
+                                            time, toQuat);
+    result.pos = sampleFromKeys<aiVectorKey>({channel->mPositionKeys, channel->mNumPositionKeys},
+                                             time, [](const aiVector3D& v) {
+                                                 return Float3{v.x, v.y, v.z};
+                                             });
+    result.scale = sampleFromKeys<aiVectorKey>({channel->mScalingKeys, channel->mNumScalingKeys},
+                                               time, [](const aiVector3D& v) {
+                                                   return Float3{v.x, v.y, v.z};
+                                               });
+    return result;
+}
+
+Array<Float4x4> sampleAnimationToPose(ArrayView<const Bone> skel,
+                                      const aiAnimation* srcAnim = nullptr, float time = 0) {
+    Array<Float4x4> poseBoneToParent;
+    poseBoneToParent.resize(skel.numItems);
+    for (u32 i = 0; i < skel.numItems; i++) {
+        poseBoneToParent[i] = skel[i].boneToParent;
+    }
+    for (u32 c = 0; c < srcAnim->mNumChannels; c++) {
+        const aiNodeAnim* srcChannel = srcAnim->mChannels[c];
+        s32 bi = find(skel, [&](const Bone& bone) {
+            return bone.name == toStringView(srcChannel->mNodeName);
+        });
+        if (bi >= 0) {
+            poseBoneToParent[bi] = sampleAnimCurve(srcChannel, time).toFloat4x4();
+        }
+    }
+    return poseBoneToParent;
+}
+
+Array<PoseBone> extractPose(ArrayView<const Bone> skel, const aiAnimation* srcAnim, float srcTime,
+                            const std::initializer_list<StringView>& boneNames) {
+    Array<Float4x4> poseBoneToParent = sampleAnimationToPose(skel, srcAnim, srcTime);
+    Array<PoseBone> result;
+    for (StringView boneName : boneNames) {
+        u32 bi =
+            safeDemote<u32>(find(skel, [&](const Bone& bone) { return bone.name == boneName; }));
+        const Bone& bone = skel[bi];
+        Float4x4 delta = poseBoneToParent[bi].invertedOrtho() * bone.boneToParent;
+        float zAngle = atan2f(delta[1].x, delta[0].x);
+        result.append(bi, zAngle);
+    }
+    return result;
+}
+
+bool BirdAnimData::usePoseCache = true;
+
+void BirdAnimData::composePose(ArrayView<Float4x4> boneToModel, float wingMix, u32 eyeFrom,
+                               u32 eyeTo, float eyeMix, bool useCache) const {
+    PLY_ASSERT(boneToModel.numItems == this->birdSkel.numItems());
+    ArrayView<const PoseBone> eyeFromPose = this->eyePoses[eyeFrom];
+    ArrayView<const PoseBone> eyeToPose = this->eyePoses[eyeTo];
+    PLY_ASSERT(eyeFromPose.numItems == eyeToPose.numItems);
+
+    if (!useCache) {
+        // boneToModel first holds each bone's delta from its base pose
+        ArrayView<Float4x4> deltas = boneToModel;
+        for (Float4x4& delta : deltas) {
+            delta = Float4x4::identity();
+        }
+        for (u32 i = 0; i < this->loWingPose.numItems(); i++) {
+            PLY_ASSERT(this->loWingPose[i].boneIndex == this->hiWingPose[i].boneIndex);
+            float zAngle = mix(this->loWingPose[i].zAngle, this->hiWingPose[i].zAngle, wingMix);
+            deltas[this->loWingPose[i].boneIndex] = Float4x4::makeRotation({0, 0, 1}, zAngle);
+        }
+        for (u32 i = 0; i < eyeFromPose.numItems; i++) {
+            PLY_ASSERT(eyeFromPose[i].boneIndex == eyeToPose[i].boneIndex);
+            float zAngle = mix(eyeFromPose[i].zAngle, eyeToPose[i].zAngle, eyeMix);
+            deltas[eyeFromPose[i].boneIndex] = Float4x4::makeRotation({0, 0, 1}, zAngle);
+        }
+
+        // Compose in place. Parents come before their children, so each delta is replaced after
+        // its parent's boneToModel is complete.
+        for (u32 i = 0; i < this->birdSkel.numItems(); i++) {
+            const Bone& bone = this->birdSkel[i];
+            if (bone.parentIdx >= 0) {
+                PLY_ASSERT((u32) bone.parentIdx < i);
+                Float4x4 curBoneToParent = bone.boneToParent * deltas[i];
+                boneToModel[i] = boneToModel[bone.parentIdx] * curBoneToParent;
+            } else {
+                boneToModel[i] = bone.boneToParent * deltas[i];
+            }
+        }
+        return;
+    }
+
+    // Blend the two nearest wing samples. Bones that the wings don't affect are identical in both.
+    u32 numBones = this->birdSkel.numItems();
+    float s = clamp(wingMix, 0.f, 1.f) * (NumWingSamples - 1);
+    u32 s0 = min((u32) s, NumWingSamples - 2);
+    float f = s - s0;
+    const Float4x4* sample0 = this->wingSamples.get() + s0 * numBones;
+    const Float4x4* sample1 = sample0 + numBones;
+    for (u32 i = 0; i < numBones; i++) {
+        for (u32 c = 0; c < 4; c++) {
+            boneToModel[i][c] = sample0[i][c] * (1.f - f) + sample1[i][c] * f;
+        }
+    }
+
+    // Recompute the bones that depend on the eye pose
+    for (u32 i : this->eyeDependentBones) {
+        const Bone& bone = this->birdSkel[i];
+        Float4x4 curBoneToParent = bone.boneToParent;
+        for (u32 j = 0; j < eyeFromPose.numItems; j++) {
+            if (eyeFromPose[j].boneIndex == i) {
+                float zAngle = mix(eyeFromPose[j].zAngle, eyeToPose[j].zAngle, eyeMix);
+                curBoneToParent = curBoneToParent * Float4x4::makeRotation({0, 0, 1}, zAngle);
+            }
+        }
+        if (bone.parentIdx >= 0) {
+            boneToModel[i] = boneToModel[bone.parentIdx] * curBoneToParent;
+        } else {
+            boneToModel[i] = curBoneToParent;
+        }
+    }
+}
+
+void bakeWingSamples(BirdAnimData* bad) {
+    u32 numBones = bad->birdSkel.numItems();
+    for (u32 i = 0; i < numBones; i++) {
+        s32 parentIdx = bad->birdSkel[i].parentIdx;
+        bool dependsOnEyes =
+            (parentIdx >= 0 && find(bad->eyeDependentBones, (u32) parentIdx) >= 0);
+        for (const PoseBone& pb : bad->eyePoses[0]) {
+            dependsOnEyes = dependsOnEyes || (pb.boneIndex == i);
+        }
+        if (dependsOnEyes) {
+            bad->eyeDependentBones.append(i);
+        }
+    }
+    bad->wingSamples.resize(BirdAnimData::NumWingSamples * numBones);
+    for (u32 s = 0; s < BirdAnimData::NumWingSamples; s++) {
+        float wingMix = (float) s / (BirdAnimData::NumWingSamples - 1);
+        bad->composePose({bad->wingSamples.get() + s * numBones, numBones}, wingMix, 0, 0, 0.f,
+                         false);
+    }
+}
+
+void extractBirdAnimData(BirdAnimData* bad, const aiScene* scene) {
+    const aiNode* basePoseFromNode = scene->mRootNode->FindNode("Body");
+    PLY_ASSERT(basePoseFromNode->mNumMeshes > 0);
+    PLY_UNUSED(basePoseFromNode);
+    extractBones(&bad->birdSkel, scene->mRootNode->FindNode("BirdSkel"));
+    PLY_ASSERT(scene->mNumAnimations == 1);
+    bad->loWingPose = extractPose(bad->birdSkel, scene->mAnimations[0], 0,
+                                  {"W0_L", "W1_L", "W2_L", "W0_R", "W1_R", "W2_R"});
+    bad->hiWingPose = extractPose(bad->birdSkel, scene->mAnimations[0], 8,
+                                  {"W0_L", "W1_L", "W2_L", "W0_R", "W1_R", "W2_R"});
+    bad->eyePoses[0] =
+        extractPose(bad->birdSkel, scene->mAnimations[0], 0, {"Pupil_L", "Pupil_R"});
+    bad->eyePoses[1] =
+        extractPose(bad->birdSkel, scene->mAnimations[0], 8, {"Pupil_L", "Pupil_R"});
+    bad->eyePoses[2] =
+        extractPose(bad->birdSkel, scene->mAnimations[0], 16, {"Pupil_L", "Pupil_R"});
+    bad->eyePoses[3] =
+        extractPose(bad->birdSkel, scene->mAnimations[0], 24, {"Pupil_L", "Pupil_R"});
+    for (u32 i = 0; i < 5; i++) {
+        TongueBone& tongueBone = bad->tongueBones.append();
+        String boneName = String::format("T{}", i);
+        tongueBone.boneIndex = safeDemote<u32>(
+            find(bad->birdSkel, [&](const Bone& bone) { return bone.name == boneName; }));
+        if (i > 0) {
+            const Bone& parentBone = bad->birdSkel[bad->tongueBones[i - 1].boneIndex];
+            const Bone& curBone = bad->birdSkel[tongueBone.boneIndex];
+            bad->tongueBones[i - 1].length = curBone.boneToParent[3].asFloat3().length();
+            bad->tongueBones[i - 1].midPoint =
+                (parentBone.boneToModel * Float4{curBone.boneToParent[3].asFloat3() * 0.5f, 1.f})
+                    .asFloat3();
+        }
+    }
+    bad->tongueBones.pop();
+    bad->tongueRootRot =
+        Quaternion::fromOrtho(bad->birdSkel[bad->tongueBones[0].boneIndex].boneToModel);
+    bakeWingSamples(bad);
+}
+
+Array<FallAnimFrame> extractFallAnimation(const aiScene* scene, u32 numFrames) {
+    auto findChannel = [&](StringView name) -> const aiNodeAnim* {
+        PLY_ASSERT(scene->mNumAnimations == 1);
+        const aiAnimation* srcAnim = scene->mAnimations[0];
+        ArrayView<const aiNodeAnim* const> channels = {srcAnim->mChannels, srcAnim->mNumChannels};
+        s32 index = find(channels,
+                         [&](const aiNodeAnim* ch) { return toStringView(ch->mNodeName) == name; });
+        PLY_ASSERT(index >= 0);
+        return channels[safeDemote<u32>(index)];
+    };
+    const aiNodeAnim* gravChan = findChannel("GravityAndAngle");
+    const aiNodeAnim* recoilChan = findChannel("Recoil");
+    const aiNodeAnim* birdChan = findChannel("Bird");
+
+    Array<FallAnimFrame> frames;
+    frames.reserve(numFrames);
+    float angle = 0.f;
+    for (u32 i = 0; i < numFrames; i++) {
+        FallAnimFrame& frame = frames.append();
+        frame.verticalDrop = sampleAnimCurve(gravChan, (float) i).pos.z / -100.f;
+        frame.recoilDistance = sampleAnimCurve(recoilChan, (float) i).pos.x;
+        Quaternion quat = sampleAnimCurve(birdChan, (float) i).quat;
+        // Expect a z axis rotation:
+        PLY_ASSERT(cross(quat.asFloat3(), {0, 0, 1}).length2() < 1e-6f);
+        float srcAngle = atan2(quat.z, quat.w) * 2.f;
+        float delta = wrap(srcAngle - angle + Pi, 2 * Pi) - Pi;
+        angle += delta;
+        frame.rotationAngle = angle;
+    }
+    return frames;
+}
+
+float getGroupScale(const aiNode* srcNode) {
+    Float4x4 groupToWorld = ((Float4x4*) &srcNode->mTransformation)->transposed();
+    return groupToWorld[0].x;
+}
+
+Owned<SimAssets> SimAssets::load(StringView assetsPath) {
+    PLY_ASSERT(FileSystem::native()->exists(assetsPath) == ExistsResult::Directory);
+    Owned<SimAssets> simAssets = new SimAssets;
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(
+            NativePath::join(assetsPath, "Bird.fbx").withNullTerminator().bytes, 0);
+        extractBirdAnimData(&simAssets->bad, scene);
+    }
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(
+            NativePath::join(assetsPath, "Level.fbx").withNullTerminator().bytes, 0);
+        simAssets->shrubGroupScale = getGroupScale(scene->mRootNode->FindNode("ShrubGroup"));
+        simAssets->cityGroupScale = getGroupScale(scene->mRootNode->FindNode("CityGroup"));
+    }
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(
+            NativePath::join(assetsPath, "SideFall.fbx").withNullTerminator().bytes, 0);
+        simAssets->fallAnim = extractFallAnimation(scene, 35);
+    }
+    return simAssets;
+}
+
+} // namespace flap
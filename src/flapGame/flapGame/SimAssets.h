@@ -0,0 +1,72 @@
+#pragma once
+#include <flapGame/Core.h>
+
+namespace flap {
+
+struct Bone {
+    String name;
+    s32 parentIdx = -1;
+    Float4x4 boneToParent = Float4x4::identity();
+    Float4x4 boneToModel = Float4x4::identity();
+};
+
+struct PoseBone {
+    u32 boneIndex = 0;
+    float zAngle = 0;
+};
+
+struct TongueBone {
+    u32 boneIndex = 0;
+    Float3 midPoint = {0, 0, 0};
+    float length = 0;
+};
+
+struct BirdAnimData {
+    Array<Bone> birdSkel;
+    Array<PoseBone> loWingPose;
+    Array<PoseBone> hiWingPose;
+    Array<PoseBone> eyePoses[4];
+    Quaternion tongueRootRot = {0, 0, 0, 1};
+    Array<TongueBone> tongueBones;
+
+    // boneToModel of every skeleton bone at NumWingSamples evenly spaced wing mixes, stored one
+    // sample after another. Sampled with the eyes at eyePoses[0]; composePose overwrites the
+    // eyeDependentBones each frame.
+    static constexpr u32 NumWingSamples = 33;
+    Array<Float4x4> wingSamples;
+    // The eye bones and their descendants, in skeleton order
+    Array<u32> eyeDependentBones;
+
+    // Default value of composePose's useCache argument in the game
+    static bool usePoseCache;
+
+    // Writes the boneToModel of every skeleton bone, with the wings posed by wingMix and the eyes
+    // by eyeMix between eyePoses[eyeFrom] and eyePoses[eyeTo]. When useCache is true, the two
+    // nearest wing samples are blended and only the eye-dependent bones are recomputed. Otherwise,
+    // the whole hierarchy is composed.
+    void composePose(ArrayView<Float4x4> boneToModel, float wingMix, u32 eyeFrom, u32 eyeTo,
+                     float eyeMix, bool useCache) const;
+};
+
+struct FallAnimFrame {
+    float verticalDrop = 0;
+    float recoilDistance = 0;
+    float rotationAngle = 0;
+};
+
+// The subset of asset data used by the simulation (GameState, Tongue, etc.). It doesn't hold any
+// GL or audio objects, so it can be loaded without a GL context.
+struct SimAssets {
+    BirdAnimData bad;
+    Array<FallAnimFrame> fallAnim;
+    float shrubGroupScale = 0.f;
+    float cityGroupScale = 0.f;
+
+    // Points to Assets::instance in the full game. Read-only after loading, so it can be shared by
+    // GameStates running on different threads.
+    static const SimAssets* instance;
+
+    static Owned<SimAssets> load(StringView assetsPath);
+};
+
+} // namespace flap
@@ -0,0 +1,156 @@
+#include <flapGame/Core.h>
+#include <flapGame/Snapshot.h>
+
+namespace flap {
+
+bool GameState::snapshot(GameStateSnapshot* snap) const {
+    if (this->titleScreen)
+        return false;
+    const Playfield& pf = this->playfield;
+    if (pf.sequences.numItems() > GameStateSnapshot::MaxSequences ||
+        pf.obstacles.numItems() > GameStateSnapshot::MaxObstacles ||
+        pf.checkpoints.numItems() > GameStateSnapshot::MaxCheckpoints)
+        return false;
+
+    snap->random = this->random;
+    snap->mode = this->mode;
+    if (auto impact = snap->mode.impact()) {
+        impact->hit.obst = nullptr; // Only valid during the collision callback
+    }
+    snap->doJump = this->doJump;
+    snap->lifeState = this->lifeState;
+
+    // Score
+    snap->score = this->score;
+    for (u32 i = 0; i < 2; i++) {
+        snap->scoreTime[i] = this->scoreTime[i];
+    }
+    snap->damage = this->damage;
+    snap->note = this->note;
+
+    // Bird
+    for (u32 i = 0; i < 2; i++) {
+        snap->birdPos[i] = this->bird.pos[i];
+        snap->aimTarget[i] = this->bird.aimTarget[i];
+        snap->birdRot[i] = this->bird.rot[i];
+        snap->finalRot[i] = this->bird.finalRot[i];
+        snap->wobble[i] = this->bird.wobble[i];
+    }
+    snap->wobbleFactor = this->bird.wobbleFactor;
+    snap->birdAnim = this->birdAnim;
+    snap->rotator = this->rotator;
+
+    // Camera
+    snap->camera = this->camera;
+    for (u32 i = 0; i < 2; i++) {
+        snap->camToWorld[i] = this->camToWorld[i];
+    }
+
+    // Playfield
+    snap->numSequences = pf.sequences.numItems();
+    for (u32 i = 0; i < pf.sequences.numItems(); i++) {
+        const ObstacleSequence* seq = pf.sequences[i];
+        snap->sequences[i] = {seq->type, seq->xSeqRelWorld, seq->pipeIndex};
+    }
+    snap->numObstacles = pf.obstacles.numItems();
+    snap->firstObstacleSerial = pf.obstacles.nextSerial - pf.obstacles.numItems();
+    for (u32 i = 0; i < pf.obstacles.numItems(); i++) {
+        const ObstacleRecord& rec = pf.obstacles[i];
+        if (rec.type != ObstacleRecord::Pipe)
+            return false;
+        snap->pipeToWorld[i] = rec.pipeToWorld;
+    }
+    snap->numCheckpoints = pf.checkpoints.numItems();
+    for (u32 i = 0; i < pf.checkpoints.numItems(); i++) {
+        snap->checkpoints[i] = pf.checkpoints[i];
+    }
+    snap->spawnedToX = pf.spawnedToX;
+    for (u32 i = 0; i < 2; i++) {
+        snap->shrubX[i] = this->shrubX[i];
+        snap->buildingX[i] = this->buildingX[i];
+        snap->frontCloudX[i] = this->frontCloudX[i];
+    }
+    snap->cloudAngleOffset = this->cloudAngleOffset;
+
+    // FX
+    snap->sweat = this->sweat;
+    snap->sweatDelay = this->sweatDelay;
+    return true;
+}
+
+void GameState::restore(const GameStateSnapshot& snap) {
+    this->titleScreen.clear();
+    this->random = snap.random;
+    this->mode = snap.mode;
+    this->doJump = snap.doJump;
+    this->lifeState = snap.lifeState;
+
+    // Score
+    this->score = snap.score;
+    for (u32 i = 0; i < 2; i++) {
+        this->scoreTime[i] = snap.scoreTime[i];
+    }
+    this->damage = snap.damage;
+    this->note = snap.note;
+
+    // Bird
+    for (u32 i = 0; i < 2; i++) {
+        this->bird.pos[i] = snap.birdPos[i];
+        this->bird.aimTarget[i] = snap.aimTarget[i];
+        this->bird.rot[i] = snap.birdRot[i];
+        this->bird.finalRot[i] = snap.finalRot[i];
+        this->bird.wobble[i] = snap.wobble[i];
+    }
+    this->bird.wobbleFactor = snap.wobbleFactor;
+    this->birdAnim = snap.birdAnim;
+    this->rotator = snap.rotator;
+
+    // Camera
+    this->camera = snap.camera;
+    for (u32 i = 0; i < 2; i++) {
+        this->camToWorld[i] = snap.camToWorld[i];
+    }
+
+    // Sequences. Reuse the existing objects when possible to avoid heap allocations.
+    Playfield& pf = this->playfield;
+    pf.sequences.resize(min(pf.sequences.numItems(), snap.numSequences));
+    for (u32 i = 0; i < snap.numSequences; i++) {
+        const GameStateSnapshot::Sequence& ss = snap.sequences[i];
+        if (i >= pf.sequences.numItems()) {
+            pf.sequences.append(ObstacleSequence::create(ss.type, ss.xSeqRelWorld));
+        } else if (pf.sequences[i]->type != ss.type) {
+            pf.sequences[i] = ObstacleSequence::create(ss.type, ss.xSeqRelWorld);
+        }
+        pf.sequences[i]->xSeqRelWorld = ss.xSeqRelWorld;
+        pf.sequences[i]->pipeIndex = ss.pipeIndex;
+    }
+
+    // Obstacles. The pool recycles its chunks, so this doesn't allocate either.
+    while (pf.obstacles.numItems() > 0) {
+        pf.obstacles.popFront();
+    }
+    pf.index.clear();
+    pf.obstacles.nextSerial = snap.firstObstacleSerial;
+    for (u32 i = 0; i < snap.numObstacles; i++) {
+        pf.addPipe(snap.pipeToWorld[i]);
+    }
+
+    // Checkpoints
+    pf.checkpoints.clear();
+    for (u32 i = 0; i < snap.numCheckpoints; i++) {
+        pf.checkpoints.push(snap.checkpoints[i]);
+    }
+    pf.spawnedToX = snap.spawnedToX;
+    for (u32 i = 0; i < 2; i++) {
+        this->shrubX[i] = snap.shrubX[i];
+        this->buildingX[i] = snap.buildingX[i];
+        this->frontCloudX[i] = snap.frontCloudX[i];
+    }
+    this->cloudAngleOffset = snap.cloudAngleOffset;
+
+    // FX
+    this->sweat = snap.sweat;
+    this->sweatDelay = snap.sweatDelay;
+}
+
+} // namespace flap
@@ -0,0 +1,71 @@
+#pragma once
+#include <flapGame/Core.h>
+#include <flapGame/GameState.h>
+
+namespace flap {
+
+// The simulation state of a GameState, stored by value without any pointers or heap allocations,
+// so that it can be copied cheaply for lookahead and rollback.
+//
+// Presentation-only state is not included: puffs, the tongue, voice handles, and the title screen
+// and its render targets. GameState::restore leaves that state unchanged. Snapshots can only be
+// taken once the title screen is gone, and only if the playfield contains no custom obstacles.
+struct GameStateSnapshot {
+    static constexpr u32 MaxSequences = 4;
+    static constexpr u32 MaxObstacles = 64;
+    static constexpr u32 MaxCheckpoints = 64;
+
+    struct Sequence {
+        ObstacleSequence::Type type = ObstacleSequence::Pipe;
+        float xSeqRelWorld = 0;
+        u32 pipeIndex = 0;
+    };
+
+    Random random;
+    GameState::Mode mode;
+    bool doJump = false;
+    GameState::LifeState lifeState;
+
+    // Score
+    u32 score = 0;
+    float scoreTime[2] = {0, 0};
+    u32 damage = 0;
+    u32 note = 0;
+
+    // Bird, except for the tongue
+    Float3 birdPos[2] = {{0, 0, 0}, {0, 0, 0}};
+    Float3 aimTarget[2] = {{0, 0, 0}, {0, 0, 0}};
+    Quaternion birdRot[2] = {{0, 0, 0, 1}, {0, 0, 0, 1}};
+    Quaternion finalRot[2] = {{0, 0, 0, 1}, {0, 0, 0, 1}};
+    float wobble[2] = {0, 0};
+    float wobbleFactor = 0;
+    GameState::BirdAnim birdAnim;
+    GameState::Rotator rotator;
+
+    // Camera
+    GameState::Camera camera;
+    QuatPos camToWorld[2] = {
+        {Quaternion::identity(), {0, 0, 0}},
+        {Quaternion::identity(), {0, 0, 0}},
+    };
+
+    // Playfield
+    u32 numSequences = 0;
+    Sequence sequences[MaxSequences];
+    u32 firstObstacleSerial = 0;
+    u32 numObstacles = 0;
+    Float3x4 pipeToWorld[MaxObstacles];
+    u32 numCheckpoints = 0;
+    float checkpoints[MaxCheckpoints];
+    float spawnedToX = 0;
+    float shrubX[2] = {0, 0};
+    float buildingX[2] = {0, 0};
+    float frontCloudX[2] = {0, 0};
+    float cloudAngleOffset = 0;
+
+    // FX that consume random numbers
+    Sweat sweat;
+    float sweatDelay = 0;
+};
+
+} // namespace flap
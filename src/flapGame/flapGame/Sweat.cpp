@@ -9,6 +9,7 @@ bool Sweat::update(float dt) {
     return this->time < 1.4f;
 };
 
+#if !FLAPGAME_HEADLESS
 void Sweat::addInstances(const Float4x4& birdToViewport,
                          Array<StarShader::InstanceData>& instances) const {
     Random r{this->seed};
@@ -37,5 +38,6 @@ void Sweat::addInstances(const Float4x4& birdToViewport,
         }
     }
 }
+#endif // !FLAPGAME_HEADLESS
 
 } // namespace flap
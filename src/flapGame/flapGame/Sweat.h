@@ -1,6 +1,8 @@
 #pragma once
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/Shaders.h>
+#endif
 
 namespace flap {
 
@@ -12,7 +14,9 @@ struct Sweat {
     PLY_INLINE Sweat(u32 seed = 1) : seed{seed} {
     }
     bool update(float dt);
+#if !FLAPGAME_HEADLESS
     void addInstances(const Float4x4& birdToViewport, Array<StarShader::InstanceData>& instances) const;
+#endif
 };
 
 } // namespace flap
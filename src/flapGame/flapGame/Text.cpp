@@ -1,6 +1,11 @@
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/Text.h>
 #include <flapGame/VertexFormats.h>
+#include <flapGame/Hash.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 // clang-format off
 #define STBI_MALLOC(sz)         PLY_HEAP.alloc(sz)
@@ -80,6 +85,8 @@ PLY_NO_INLINE Owned<SDFCommon> SDFCommon::create() {
     PLY_ASSERT(common->sdfParamsUniform >= 0);
     common->colorUniform = GL_NO_CHECK(GetUniformLocation(common->shader.id, "color"));
     PLY_ASSERT(common->colorUniform >= 0);
+
+    common->instanced.init(false);
     return common;
 }
 
@@ -136,115 +143,433 @@ PLY_NO_INLINE Owned<SDFOutline> SDFOutline::create() {
     PLY_ASSERT(outline->centerSlopeUniform >= 0);
     outline->separatorUniform = GL_NO_CHECK(GetUniformLocation(outline->shader.id, "separator"));
     PLY_ASSERT(outline->separatorUniform >= 0);
+
+    outline->instanced.init(true);
     return outline;
 }
 
-PLY_NO_INLINE Owned<SDFFont> SDFFont::bake(StringView ttfBuffer, float pixelHeight) {
-    Owned<SDFFont> sdfFont = new SDFFont;
+PLY_NO_INLINE void SDFInstancedProgram::init(bool outline) {
+    {
+        StringView defines = outline ? "#define OUTLINE 1\n" : "";
+        Shader vertexShader = Shader::compile(GL_VERTEX_SHADER, defines + R"(
+in vec2 vertPosition;
+in vec2 instOrigin;
+in vec2 instXAxis;
+in vec2 instYAxis;
+in vec4 instUVRect;
+in vec4 instColor;
+out vec2 fragTexCoord;
+out vec4 fragColor;
+#ifndef OUTLINE
+in vec2 instSDFParams;
+out vec2 fragSDFParams;
+#endif
+
+void main() {
+    fragTexCoord = mix(instUVRect.xy, instUVRect.zw, vertPosition);
+    fragColor = instColor;
+#ifndef OUTLINE
+    fragSDFParams = instSDFParams;
+#endif
+    vec2 pos = instOrigin + instXAxis * vertPosition.x + instYAxis * vertPosition.y;
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
+)");
+
+        Shader fragmentShader = Shader::compile(GL_FRAGMENT_SHADER, defines + R"(
+in vec2 fragTexCoord;
+in vec4 fragColor;
+uniform sampler2D texImage;
+#ifdef OUTLINE
+uniform vec4 outlineColor;
+uniform vec2 centerSlope[2];
+uniform float separator;
+#else
+in vec2 fragSDFParams;
+#endif
+out vec4 outColor;
+
+void main() {
+#ifdef OUTLINE
+    float c = texture(texImage, fragTexCoord).r;
+    int i = int(c > separator);
+    float f = clamp((c - centerSlope[i].x) * centerSlope[i].y, 0.0, 1.0);
+    vec4 colors[3] = vec4[3](vec4(0.0, 0.0, 0.0, 1.0), outlineColor, fragColor);
+    outColor = mix(colors[i], colors[i + 1], f);
+#else
+    vec4 c = texture(texImage, fragTexCoord);
+    float v = clamp(0.5 - (fragSDFParams.x - c.r) * fragSDFParams.y, 0.0, 1.0);
+    outColor = vec4(fragColor.rgb * v * fragColor.a, 1.0 - v * fragColor.a);
+#endif
+}
+)");
 
-    s32 padding = 8;
-    u8 onEdgeValue = 192;
-    float pixelDistScale = 16.f;
+        // Link shader program
+        this->shader = ShaderProgram::link({vertexShader.id, fragmentShader.id});
+    }
 
-    image::OwnImage atlasIm{512, 512, image::Format::Byte};
-    memset(atlasIm.data, 0, atlasIm.size());
+    // Get shader program's vertex attribute and uniform locations
+    this->vertPositionAttrib = GL_NO_CHECK(GetAttribLocation(this->shader.id, "vertPosition"));
+    PLY_ASSERT(this->vertPositionAttrib >= 0);
+    this->instOriginAttrib = GL_NO_CHECK(GetAttribLocation(this->shader.id, "instOrigin"));
+    PLY_ASSERT(this->instOriginAttrib >= 0);
+    this->instXAxisAttrib = GL_NO_CHECK(GetAttribLocation(this->shader.id, "instXAxis"));
+    PLY_ASSERT(this->instXAxisAttrib >= 0);
+    this->instYAxisAttrib = GL_NO_CHECK(GetAttribLocation(this->shader.id, "instYAxis"));
+    PLY_ASSERT(this->instYAxisAttrib >= 0);
+    this->instUVRectAttrib = GL_NO_CHECK(GetAttribLocation(this->shader.id, "instUVRect"));
+    PLY_ASSERT(this->instUVRectAttrib >= 0);
+    this->instColorAttrib = GL_NO_CHECK(GetAttribLocation(this->shader.id, "instColor"));
+    PLY_ASSERT(this->instColorAttrib >= 0);
+    this->textureUniform = GL_NO_CHECK(GetUniformLocation(this->shader.id, "texImage"));
+    PLY_ASSERT(this->textureUniform >= 0);
+    if (outline) {
+        this->outlineColorUniform =
+            GL_NO_CHECK(GetUniformLocation(this->shader.id, "outlineColor"));
+        PLY_ASSERT(this->outlineColorUniform >= 0);
+        this->centerSlopeUniform = GL_NO_CHECK(GetUniformLocation(this->shader.id, "centerSlope"));
+        PLY_ASSERT(this->centerSlopeUniform >= 0);
+        this->separatorUniform = GL_NO_CHECK(GetUniformLocation(this->shader.id, "separator"));
+        PLY_ASSERT(this->separatorUniform >= 0);
+    } else {
+        this->instSDFParamsAttrib =
+            GL_NO_CHECK(GetAttribLocation(this->shader.id, "instSDFParams"));
+        PLY_ASSERT(this->instSDFParamsAttrib >= 0);
+    }
 
-    sdfFont->chars.reserve(96);
+    Array<Float2> vertices = {
+        {0.f, 0.f},
+        {1.f, 0.f},
+        {1.f, 1.f},
+        {0.f, 1.f},
+    };
+    this->quadVBO = GLBuffer::create(vertices.stringView());
+    Array<u16> indices = {(u16) 0, 1, 2, 2, 3, 0};
+    this->quadIndices = GLBuffer::create(indices.stringView());
+    this->quadNumIndices = indices.numItems();
+}
 
+// The caller sets the program, blend state and uniforms other than the texture.
+PLY_NO_INLINE void SDFInstancedProgram::draw(GLuint textureID,
+                                             ArrayView<const InstanceData> instanceData) const {
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, textureID));
+    GL_CHECK(Uniform1i(this->textureUniform, 0));
+
+    // Instance attributes
+    struct InstanceAttrib {
+        GLint attrib;
+        GLint numComponents;
+        uptr offset;
+    };
+    InstanceAttrib instAttribs[] = {
+        {this->instOriginAttrib, 2, offsetof(InstanceData, origin)},
+        {this->instXAxisAttrib, 2, offsetof(InstanceData, xAxis)},
+        {this->instYAxisAttrib, 2, offsetof(InstanceData, yAxis)},
+        {this->instSDFParamsAttrib, 2, offsetof(InstanceData, sdfParams)},
+        {this->instUVRectAttrib, 4, offsetof(InstanceData, uvRect)},
+        {this->instColorAttrib, 4, offsetof(InstanceData, color)},
+    };
+    DynamicArrayBuffers::Range ibo =
+        DynamicArrayBuffers::instance->upload(instanceData.stringView());
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, ibo.id));
+    for (const InstanceAttrib& ia : instAttribs) {
+        if (ia.attrib < 0)
+            continue;
+        GL_CHECK(EnableVertexAttribArray(ia.attrib));
+        GL_CHECK(VertexAttribPointer(ia.attrib, ia.numComponents, GL_FLOAT, GL_FALSE,
+                                     (GLsizei) sizeof(InstanceData), ibo.ptr(ia.offset)));
+        GL_CHECK(VertexAttribDivisor(ia.attrib, 1));
+    }
+
+    // Draw
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, this->quadVBO.id));
+    GL_CHECK(EnableVertexAttribArray(this->vertPositionAttrib));
+    GL_CHECK(VertexAttribPointer(this->vertPositionAttrib, 2, GL_FLOAT, GL_FALSE,
+                                 (GLsizei) sizeof(Float2), (GLvoid*) 0));
+    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quadIndices.id));
+    GL_CHECK(DrawElementsInstanced(GL_TRIANGLES, (GLsizei) this->quadNumIndices, GL_UNSIGNED_SHORT,
+                                   (void*) 0, instanceData.numItems));
+
+    for (const InstanceAttrib& ia : instAttribs) {
+        if (ia.attrib < 0)
+            continue;
+        GL_CHECK(VertexAttribDivisor(ia.attrib, 0));
+        GL_CHECK(DisableVertexAttribArray(ia.attrib));
+    }
+    GL_CHECK(DisableVertexAttribArray(this->vertPositionAttrib));
+}
+
+// Bake parameters. Changing any of them invalidates cached atlases.
+static const s32 SDFPadding = 8;
+static const u8 SDFOnEdgeValue = 192;
+static const float SDFPixelDistScale = 16.f;
+
+namespace {
+struct GlyphTask {
+    s32 glyph = 0;
+    float scale = 0;
+    // Filled in by the worker threads, and freed after being copied to the atlas
+    u8* sdf = nullptr;
+    IntVec2 size = {0, 0};
+    IntVec2 offset = {0, 0};
+};
+} // namespace
+
+PLY_NO_INLINE Array<Owned<SDFBakedFont>>
+bakeSDFFonts(StringView ttfBuffer, ArrayView<const SDFFontDesc> descs, u32 numThreads) {
+    PLY_ASSERT(numThreads > 0);
     stbtt_fontinfo stbFont;
     stbFont.userdata = nullptr;
     int rc = stbtt_InitFont(&stbFont, (const unsigned char*) ttfBuffer.bytes, 0);
     PLY_ASSERT(rc);
     PLY_UNUSED(rc);
 
-    float scale = stbtt_ScaleForPixelHeight(&stbFont, pixelHeight);
-
-    Array<image::Image> glyphImages;
-    Array<stbrp_rect> rectsToPack;
-    glyphImages.reserve(96);
-    for (u32 i = 0; i < 96; i++) {
-        // Find glyph index for this code point
-        int codePoint = i + 32;
-        if (codePoint == 64) {
-            // Replace @ with copyright symbol
-            codePoint = 0xa9;
+    // Look up each glyph and its metrics, which is quick, and make a task for its SDF
+    Array<Owned<SDFBakedFont>> bakedFonts;
+    Array<GlyphTask> tasks;
+    for (const SDFFontDesc& desc : descs) {
+        SDFBakedFont* baked = bakedFonts.append(new SDFBakedFont{desc});
+        float scale = stbtt_ScaleForPixelHeight(&stbFont, desc.pixelHeight);
+        baked->chars.reserve(desc.numCodePoints);
+        for (u32 i = 0; i < desc.numCodePoints; i++) {
+            // Find glyph index for this code point
+            int codePoint = desc.firstCodePoint + i;
+            if (codePoint == 64) {
+                // Replace @ with copyright symbol
+                codePoint = 0xa9;
+            }
+            s32 g = stbtt_FindGlyphIndex(&stbFont, codePoint);
+
+            // Append char data
+            SDFFont::Char& cd = baked->chars.append();
+            s32 rawXAdvance = 0;
+            stbtt_GetGlyphHMetrics(&stbFont, g, &rawXAdvance, nullptr);
+            cd.xAdvance = rawXAdvance * scale;
+
+            GlyphTask& task = tasks.append();
+            task.glyph = g;
+            task.scale = scale;
         }
-        s32 g = stbtt_FindGlyphIndex(&stbFont, codePoint);
-
-        // Create temporary glyph image (manually freed below)
-        IntVec2 glyphOffset = {0, 0};
-        IntVec2 glyphSize = {0, 0};
-        image::Image& glyphIm = glyphImages.append(nullptr, 0, 0, 0, image::Format::Byte);
-        glyphIm.data =
-            (char*) stbtt_GetGlyphSDF(&stbFont, scale, g, padding, onEdgeValue, pixelDistScale,
-                                      &glyphSize.x, &glyphSize.y, &glyphOffset.x, &glyphOffset.y);
-        glyphIm.width = glyphSize.x;
-        glyphIm.height = glyphSize.y;
-        glyphIm.stride = glyphSize.x;
-
-        // Append pack rect
-        stbrp_rect& rtp = rectsToPack.append();
-        rtp.id = 0;
-        rtp.w = safeDemote<stbrp_coord>(glyphIm.width);
-        rtp.h = safeDemote<stbrp_coord>(glyphIm.height);
-        rtp.x = 0;
-        rtp.y = 0;
-        rtp.was_packed = 0;
-
-        // Append char data
-        SDFFont::Char& cd = sdfFont->chars.append();
-        s32 rawXAdvance = 0;
-        stbtt_GetGlyphHMetrics(&stbFont, g, &rawXAdvance, nullptr);
-        cd.offset = glyphOffset.to<Int2<s16>>();
-        cd.xAdvance = rawXAdvance * scale;
     }
 
-    {
-        // Init rect packing context
-        Array<stbrp_node> packNodes;
-        packNodes.resize(atlasIm.width);
-        stbrp_context packContext;
-        stbrp_init_target(&packContext, atlasIm.width, atlasIm.height, packNodes.get(),
-                          packNodes.numItems());
-
-        // Pack rects
-        stbrp_pack_rects(&packContext, rectsToPack.get(), rectsToPack.numItems());
+    // Generate the glyph SDFs. Glyphs are independent, so each thread repeatedly claims the next
+    // one from a shared counter until none are left. stbtt_GetGlyphSDF only reads stbFont.
+    std::atomic<u32> nextTask{0};
+    auto worker = [&] {
+        for (;;) {
+            u32 t = nextTask.fetch_add(1, std::memory_order_relaxed);
+            if (t >= tasks.numItems())
+                break;
+            GlyphTask& task = tasks[t];
+            task.sdf = stbtt_GetGlyphSDF(&stbFont, task.scale, task.glyph, SDFPadding,
+                                         SDFOnEdgeValue, SDFPixelDistScale, &task.size.x,
+                                         &task.size.y, &task.offset.x, &task.offset.y);
+        }
+    };
+    Array<std::thread> threads;
+    for (u32 t = 1; t < numThreads; t++) {
+        threads.append(std::thread{worker});
+    }
+    worker(); // The calling thread works too
+    for (std::thread& thread : threads) {
+        thread.join();
     }
 
-    for (u32 i = 0; i < rectsToPack.numItems(); i++) {
-        stbrp_rect& sr = rectsToPack[i];
-        PLY_ASSERT(sr.was_packed);
+    // Pack each font's glyphs into its own atlas
+    u32 firstTask = 0;
+    for (u32 f = 0; f < bakedFonts.numItems(); f++) {
+        SDFBakedFont* baked = bakedFonts[f];
+        image::Image& atlasIm = baked->atlasIm;
+        memset(atlasIm.data, 0, atlasIm.size());
+        u32 numChars = baked->chars.numItems();
+
+        Array<stbrp_rect> rectsToPack;
+        rectsToPack.resize(numChars);
+        for (u32 i = 0; i < numChars; i++) {
+            const GlyphTask& task = tasks[firstTask + i];
+            stbrp_rect& rtp = rectsToPack[i];
+            rtp.id = 0;
+            rtp.w = safeDemote<stbrp_coord>(task.size.x);
+            rtp.h = safeDemote<stbrp_coord>(task.size.y);
+            rtp.x = 0;
+            rtp.y = 0;
+            rtp.was_packed = 0;
+            baked->chars[i].offset = task.offset.to<Int2<s16>>();
+        }
 
-        // Copy image to atlas
-        IntRect dstRect = IntRect::fromSize({sr.x, sr.y}, {sr.w, sr.h});
-        PLY_ASSERT(atlasIm.getRect().contains(dstRect));
-        image::Image dstIm = image::crop(atlasIm, dstRect);
-        copy8Bit(dstIm, glyphImages[i]);
+        {
+            // Init rect packing context
+            Array<stbrp_node> packNodes;
+            packNodes.resize(atlasIm.width);
+            stbrp_context packContext;
+            stbrp_init_target(&packContext, atlasIm.width, atlasIm.height, packNodes.get(),
+                              packNodes.numItems());
 
-        // Set information in charDatas
-        sdfFont->chars[i].atlasCoords = dstRect.to<Box<Int2<s16>>>();
-    }
+            // Pack rects
+            stbrp_pack_rects(&packContext, rectsToPack.get(), rectsToPack.numItems());
+        }
 
-    // Manually free temporary glyph images
-    for (image::Image& glyphIm : glyphImages) {
-        stbtt_FreeSDF((unsigned char*) glyphIm.data, stbFont.userdata);
+        for (u32 i = 0; i < numChars; i++) {
+            const GlyphTask& task = tasks[firstTask + i];
+            stbrp_rect& sr = rectsToPack[i];
+            PLY_ASSERT(sr.was_packed);
+
+            // Copy image to atlas
+            image::Image glyphIm{nullptr, 0, 0, 0, image::Format::Byte};
+            glyphIm.data = (char*) task.sdf;
+            glyphIm.width = task.size.x;
+            glyphIm.height = task.size.y;
+            glyphIm.stride = task.size.x;
+            IntRect dstRect = IntRect::fromSize({sr.x, sr.y}, {sr.w, sr.h});
+            PLY_ASSERT(atlasIm.getRect().contains(dstRect));
+            image::Image dstIm = image::crop(atlasIm, dstRect);
+            copy8Bit(dstIm, glyphIm);
+
+            // Set information in charDatas
+            baked->chars[i].atlasCoords = dstRect.to<Box<Int2<s16>>>();
+
+            // Manually free temporary glyph image
+            stbtt_FreeSDF(task.sdf, stbFont.userdata);
+        }
+        firstTask += numChars;
     }
 
+    return bakedFonts;
+}
+
+PLY_NO_INLINE Owned<SDFFont> SDFFont::create(SDFBakedFont* baked) {
+    Owned<SDFFont> sdfFont = new SDFFont;
+    sdfFont->firstCodePoint = baked->desc.firstCodePoint;
+    sdfFont->chars = std::move(baked->chars);
+
     // Upload atlas to OpenGL
-    sdfFont->fontTexture.init(atlasIm);
+    sdfFont->fontTexture.init(baked->atlasIm);
 
     return sdfFont;
 }
 
-PLY_NO_INLINE TextBuffers generateTextBuffers(const SDFFont* sdfFont, StringView text) {
-    TextBuffers tb;
+PLY_NO_INLINE Array<Owned<SDFFont>> SDFFont::bakeMany(StringView ttfBuffer,
+                                                      ArrayView<const SDFFontDesc> descs,
+                                                      u32 numThreads) {
+    if (numThreads == 0) {
+        numThreads = max(std::thread::hardware_concurrency(), 1u);
+    }
+    Array<Owned<SDFBakedFont>> bakedFonts = bakeSDFFonts(ttfBuffer, descs, numThreads);
+    Array<Owned<SDFFont>> sdfFonts;
+    for (SDFBakedFont* baked : bakedFonts) {
+        sdfFonts.append(SDFFont::create(baked));
+    }
+    return sdfFonts;
+}
+
+PLY_NO_INLINE Owned<SDFFont> SDFFont::bake(StringView ttfBuffer, float pixelHeight) {
+    SDFFontDesc desc;
+    desc.pixelHeight = pixelHeight;
+    Array<Owned<SDFFont>> sdfFonts = bakeMany(ttfBuffer, {&desc, 1});
+    return std::move(sdfFonts[0]);
+}
+
+// The cache file holds this header, then the chars, then the atlas rows.
+struct SDFCacheHeader {
+    char magic[4] = {'F', 'L', 'S', 'D'};
+    u32 version = 1;
+    u64 key = 0; // Hash of the TTF data and bake parameters
+    u32 atlasWidth = 0;
+    u32 atlasHeight = 0;
+    u32 numChars = 0;
+    float bakeSeconds = 0;
+};
+
+static u64 getSDFCacheKey(StringView ttfBuffer, const SDFFontDesc& desc) {
+    StateHasher hasher;
+    hasher.append(ttfBuffer.bytes, ttfBuffer.numBytes);
+    hasher.append(desc.pixelHeight);
+    hasher.append(desc.firstCodePoint);
+    hasher.append(desc.numCodePoints);
+    hasher.append(desc.atlasSize);
+    hasher.append(SDFPadding);
+    hasher.append(SDFOnEdgeValue);
+    hasher.append(SDFPixelDistScale);
+    return hasher.value;
+}
+
+PLY_NO_INLINE Owned<SDFFont> SDFFont::loadOrBake(StringView ttfBuffer, float pixelHeight,
+                                                 StringView cachePath, LoadInfo* info) {
+    SDFFontDesc desc;
+    desc.pixelHeight = pixelHeight;
+    u64 key = getSDFCacheKey(ttfBuffer, desc);
+
+    // Try the cache
+    String data = FileSystem::native()->loadBinary(cachePath);
+    if (FileSystem::native()->lastResult() == FSResult::OK &&
+        data.numBytes >= sizeof(SDFCacheHeader)) {
+        SDFCacheHeader header;
+        memcpy(&header, data.bytes, sizeof(header));
+        if (memcmp(header.magic, SDFCacheHeader{}.magic, 4) == 0 &&
+            header.version == SDFCacheHeader{}.version && header.key == key &&
+            header.atlasWidth == (u32) desc.atlasSize &&
+            header.atlasHeight == (u32) desc.atlasSize &&
+            data.numBytes == sizeof(header) + header.numChars * sizeof(Char) +
+                                 header.atlasWidth * header.atlasHeight) {
+            Owned<SDFFont> sdfFont = new SDFFont;
+            sdfFont->firstCodePoint = desc.firstCodePoint;
+            const char* src = data.bytes + sizeof(header);
+            sdfFont->chars.resize(header.numChars);
+            memcpy(sdfFont->chars.get(), src, header.numChars * sizeof(Char));
+            src += header.numChars * sizeof(Char);
+
+            // The atlas rows are stored without padding, as Texture::upload expects, so upload
+            // them straight from the file data
+            image::Image atlasIm{nullptr, 0, 0, 0, image::Format::Byte};
+            atlasIm.data = (char*) src;
+            atlasIm.width = header.atlasWidth;
+            atlasIm.height = header.atlasHeight;
+            atlasIm.stride = header.atlasWidth;
+            sdfFont->fontTexture.init(atlasIm);
+            if (info) {
+                info->fromCache = true;
+                info->bakeSeconds = header.bakeSeconds;
+            }
+            return sdfFont;
+        }
+    }
+
+    // Bake and save to the cache
+    auto startTime = std::chrono::steady_clock::now();
+    Array<Owned<SDFBakedFont>> bakedFonts =
+        bakeSDFFonts(ttfBuffer, {&desc, 1}, max(std::thread::hardware_concurrency(), 1u));
+    SDFBakedFont* baked = bakedFonts[0];
+    SDFCacheHeader header;
+    header.key = key;
+    header.atlasWidth = baked->atlasIm.width;
+    header.atlasHeight = baked->atlasIm.height;
+    header.numChars = baked->chars.numItems();
+    std::chrono::duration<double> bakeTime = std::chrono::steady_clock::now() - startTime;
+    header.bakeSeconds = (float) bakeTime.count();
+    MemOutStream mout;
+    mout << StringView{(const char*) &header, sizeof(header)};
+    mout << baked->chars.stringView();
+    for (s32 y = 0; y < baked->atlasIm.height; y++) {
+        mout << StringView{(const char*) baked->atlasIm.getPixel(0, y),
+                           (u32) baked->atlasIm.width};
+    }
+    FileSystem::native()->makeDirsAndSaveBinaryIfDifferent(cachePath, mout.moveToString());
+    if (info) {
+        info->fromCache = false;
+        info->bakeSeconds = header.bakeSeconds;
+    }
+
+    return SDFFont::create(baked);
+}
+
+static void layoutText(TextBuffers& tb, Array<TextGlyph>& glyphs, Array<u16>& indices,
+                       Array<VertexP2T>& vertices, const SDFFont* sdfFont, StringView text) {
     Float2 pos = {0, 0};
-    Float2 ooAtlasSize = 1.f / Float2{512, 512};
+    Float2 ooAtlasSize = 1.f / sdfFont->fontTexture.dims();
 
-    Array<u16> indices;
-    Array<VertexP2T> vertices;
     for (u32 i = 0; i < text.numBytes; i++) {
-        u32 code = text[i] - 32;
+        u32 code = text[i] - sdfFont->firstCodePoint;
         const SDFFont::Char& cd = sdfFont->chars[code];
 
         Rect uv = cd.atlasCoords.to<Rect>() * ooAtlasSize;
@@ -253,11 +578,16 @@ PLY_NO_INLINE TextBuffers generateTextBuffers(const SDFFont* sdfFont, StringView
         tb.xMax = max(tb.xMax, r.maxs.x);
         pos.x += cd.xAdvance;
 
+        TextGlyph& glyph = glyphs.append();
+        glyph.rect = {{r.mins.x, -r.maxs.y}, {r.maxs.x, -r.mins.y}};
+        glyph.uv0 = {uv.mins.x, uv.maxs.y};
+        glyph.uv1 = {uv.maxs.x, uv.mins.y};
+
         u32 base = vertices.numItems();
-        vertices.append() = {{r.mins.x, -r.maxs.y}, {uv.mins.x, uv.maxs.y}};
-        vertices.append() = {{r.maxs.x, -r.maxs.y}, {uv.maxs.x, uv.maxs.y}};
-        vertices.append() = {{r.maxs.x, -r.mins.y}, {uv.maxs.x, uv.mins.y}};
-        vertices.append() = {{r.mins.x, -r.mins.y}, {uv.mins.x, uv.mins.y}};
+        vertices.append() = {glyph.rect.mins, glyph.uv0};
+        vertices.append() = {{glyph.rect.maxs.x, glyph.rect.mins.y}, {glyph.uv1.x, glyph.uv0.y}};
+        vertices.append() = {glyph.rect.maxs, glyph.uv1};
+        vertices.append() = {{glyph.rect.mins.x, glyph.rect.maxs.y}, {glyph.uv0.x, glyph.uv1.y}};
         indices.append(safeDemote<u16>(base));
         indices.append(safeDemote<u16>(base + 1));
         indices.append(safeDemote<u16>(base + 2));
@@ -266,53 +596,220 @@ PLY_NO_INLINE TextBuffers generateTextBuffers(const SDFFont* sdfFont, StringView
         indices.append(safeDemote<u16>(base));
     }
 
-    tb.indices = DynamicArrayBuffers::instance->upload(indices.stringView());
-    tb.vbo = DynamicArrayBuffers::instance->upload(vertices.stringView());
     tb.numIndices = indices.numItems();
     if (tb.xMin == Limits<float>::Max) {
         tb.xMin = 0;
         tb.xMax = 0;
     }
+}
+
+TextLayoutCache* TextLayoutCache::instance = nullptr;
+
+PLY_NO_INLINE const TextBuffers* TextLayoutCache::get(const SDFFont* sdfFont, StringView text) {
+    // Linear search is fine; only a few dozen strings are drawn per frame
+    Entry* lru = nullptr;
+    for (Entry& entry : this->entries) {
+        if (entry.sdfFont == sdfFont && entry.text == text) {
+            entry.lastFrameUsed = this->frameNumber;
+            return &entry.tb;
+        }
+        if (!lru || entry.lastFrameUsed < lru->lastFrameUsed) {
+            lru = &entry;
+        }
+    }
+
+    Entry* entry = nullptr;
+    if (this->entries.numItems() < MaxEntries) {
+        entry = &this->entries.append();
+    } else if (lru->lastFrameUsed != this->frameNumber) {
+        // Its buffers are replaced below. They may still be in use by the GPU, but GL defers
+        // deleting them until they aren't.
+        entry = lru;
+        entry->tb = {};
+        entry->glyphs.clear();
+    } else {
+        return nullptr;
+    }
+
+    Array<u16> indices;
+    Array<VertexP2T> vertices;
+    layoutText(entry->tb, entry->glyphs, indices, vertices, sdfFont, text);
+    entry->sdfFont = sdfFont;
+    entry->text = text;
+    entry->indices = GLBuffer::create(indices.stringView());
+    entry->vbo = GLBuffer::create(vertices.stringView());
+    entry->tb.indices = {entry->indices.id, 0};
+    entry->tb.vbo = {entry->vbo.id, 0};
+    entry->tb.glyphs = entry->glyphs;
+    entry->lastFrameUsed = this->frameNumber;
+    this->numLayouts++;
+    return &entry->tb;
+}
+
+PLY_NO_INLINE TextBuffers generateTextBuffers(const SDFFont* sdfFont, StringView text) {
+    TextLayoutCache* cache = TextLayoutCache::instance;
+    if (cache && cache->useCache) {
+        if (const TextBuffers* cached = cache->get(sdfFont, text)) {
+            return *cached;
+        }
+    }
+    if (cache) {
+        cache->numLayouts++;
+    }
+
+    TextBuffers tb;
+    Array<TextGlyph> localGlyphs;
+    Array<TextGlyph>& glyphs = cache ? cache->frameGlyphs.append() : localGlyphs;
+    Array<u16> indices;
+    Array<VertexP2T> vertices;
+    layoutText(tb, glyphs, indices, vertices, sdfFont, text);
+    if (cache) {
+        tb.glyphs = glyphs;
+    }
+    tb.indices = DynamicArrayBuffers::instance->upload(indices.stringView());
+    tb.vbo = DynamicArrayBuffers::instance->upload(vertices.stringView());
     return tb;
 }
 
+TextBatch* TextBatch::instance = nullptr;
+
+PLY_NO_INLINE void TextBatch::setOutline(const Float4& outlineColor,
+                                         ArrayView<const Float2> centerSlope) {
+    PLY_ASSERT(centerSlope.numItems == 2);
+    if (!this->instances.isEmpty() &&
+        (this->mode != Outlined ||
+         memcmp(&outlineColor, &this->outlineColor, sizeof(Float4)) != 0 ||
+         memcmp(centerSlope.items, this->centerSlope, sizeof(this->centerSlope)) != 0)) {
+        this->flush();
+    }
+    this->outlineColor = outlineColor;
+    this->centerSlope[0] = centerSlope[0];
+    this->centerSlope[1] = centerSlope[1];
+}
+
+PLY_NO_INLINE void TextBatch::add(Mode mode, const SDFInstancedProgram* program,
+                                  const SDFFont* sdfFont, const TextBuffers& tb,
+                                  const Float4x4& modelToViewport, const Float2& sdfParams,
+                                  const Float4& color) {
+    if (!this->instances.isEmpty() &&
+        (mode != this->mode || program != this->program || sdfFont != this->sdfFont)) {
+        this->flush();
+    }
+    this->mode = mode;
+    this->program = program;
+    this->sdfFont = sdfFont;
+
+    // Transform each glyph quad to viewport space here, so that strings with different
+    // transforms can share a draw call
+    const Float4x4& m = modelToViewport;
+    PLY_ASSERT(m[0].w == 0 && m[1].w == 0 && m[3].w == 1);
+    for (const TextGlyph& glyph : tb.glyphs) {
+        Float2 size = glyph.rect.size();
+        SDFInstancedProgram::InstanceData& inst = this->instances.append();
+        inst.origin = (m[0] * glyph.rect.mins.x + m[1] * glyph.rect.mins.y + m[3]).asFloat2();
+        inst.xAxis = m[0].asFloat2() * size.x;
+        inst.yAxis = m[1].asFloat2() * size.y;
+        inst.sdfParams = sdfParams;
+        inst.uvRect = {glyph.uv0.x, glyph.uv0.y, glyph.uv1.x, glyph.uv1.y};
+        inst.color = color;
+    }
+}
+
+PLY_NO_INLINE void TextBatch::flush() {
+    if (this->instances.isEmpty())
+        return;
+
+    GL_STATE(UseProgram(this->program->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
+    // Premultiplied alpha
+    GL_CHECK(BlendEquation(GL_FUNC_ADD));
+    switch (this->mode) {
+        case Normal: {
+            GL_STATE(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE));
+            break;
+        }
+        case AlphaOnly: {
+            GL_STATE(BlendFuncSeparate(GL_ZERO, GL_ONE, GL_ZERO, GL_SRC_ALPHA));
+            break;
+        }
+        case Outlined: {
+            GL_STATE(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_SRC_ALPHA));
+            GL_CHECK(Uniform4fv(this->program->outlineColorUniform, 1,
+                                (const GLfloat*) &this->outlineColor));
+            GL_CHECK(Uniform2fv(this->program->centerSlopeUniform, 2,
+                                (const GLfloat*) this->centerSlope));
+            GL_CHECK(Uniform1f(this->program->separatorUniform,
+                               mix(this->centerSlope[0].x, this->centerSlope[1].x, 0.5f)));
+            break;
+        }
+    }
+
+    this->program->draw(this->sdfFont->fontTexture.id, this->instances);
+    this->numDrawCalls++;
+    this->instances.clear();
+}
+
+// Strings can only be batched if their glyphs were kept by generateTextBuffers.
+static PLY_INLINE TextBatch* getTextBatch(const TextBuffers& tb) {
+    TextBatch* batch = TextBatch::instance;
+    if (!batch)
+        return nullptr;
+    if (batch->useBatching && tb.glyphs.numItems * 6 == tb.numIndices)
+        return batch;
+    // This string is drawn immediately, after any text that was added before it
+    batch->flush();
+    batch->numDrawCalls++;
+    return nullptr;
+}
+
 PLY_NO_INLINE void drawText(const SDFCommon* common, const SDFFont* sdfFont, const TextBuffers& tb,
                             const Float4x4& modelToViewport, const Float2& sdfParams,
                             const Float4& color, bool alphaOnly) {
-    GL_CHECK(UseProgram(common->shader.id));
-    GL_CHECK(Disable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    if (TextBatch* batch = getTextBatch(tb)) {
+        batch->add(alphaOnly ? TextBatch::AlphaOnly : TextBatch::Normal, &common->instanced,
+                   sdfFont, tb, modelToViewport, sdfParams, color);
+        return;
+    }
+
+    GL_STATE(UseProgram(common->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     // Premultiplied alpha
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
     if (alphaOnly) {
-        GL_CHECK(BlendFuncSeparate(GL_ZERO, GL_ONE, GL_ZERO, GL_SRC_ALPHA));
+        GL_STATE(BlendFuncSeparate(GL_ZERO, GL_ONE, GL_ZERO, GL_SRC_ALPHA));
     } else {
-        GL_CHECK(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE));
+        GL_STATE(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE));
     }
 
     GL_CHECK(
         UniformMatrix4fv(common->modelToViewportUniform, 1, GL_FALSE, (GLfloat*) &modelToViewport));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, sdfFont->fontTexture.id));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, sdfFont->fontTexture.id));
     GL_CHECK(Uniform1i(common->textureUniform, 0));
     GL_CHECK(Uniform2fv(common->sdfParamsUniform, 1, (const GLfloat*) &sdfParams));
     GL_CHECK(Uniform4fv(common->colorUniform, 1, (const GLfloat*) &color));
 
     // Bind VBO
-    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, tb.vbo));
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, tb.vbo.id));
     GL_CHECK(EnableVertexAttribArray(common->positionAttrib));
     GL_CHECK(VertexAttribPointer(common->positionAttrib, 2, GL_FLOAT, GL_FALSE,
-                                 (GLsizei) sizeof(VertexP2T), (GLvoid*) offsetof(VertexP2T, pos)));
+                                 (GLsizei) sizeof(VertexP2T),
+                                 tb.vbo.ptr(offsetof(VertexP2T, pos))));
     GL_CHECK(EnableVertexAttribArray(common->texCoordAttrib));
     GL_CHECK(VertexAttribPointer(common->texCoordAttrib, 2, GL_FLOAT, GL_FALSE,
-                                 (GLsizei) sizeof(VertexP2T), (GLvoid*) offsetof(VertexP2T, uv)));
+                                 (GLsizei) sizeof(VertexP2T),
+                                 tb.vbo.ptr(offsetof(VertexP2T, uv))));
 
     // Bind index buffer
-    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, tb.indices));
+    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, tb.indices.id));
 
     // Draw
-    GL_CHECK(DrawElements(GL_TRIANGLES, (GLsizei) tb.numIndices, GL_UNSIGNED_SHORT, (void*) 0));
+    GL_CHECK(
+        DrawElements(GL_TRIANGLES, (GLsizei) tb.numIndices, GL_UNSIGNED_SHORT, tb.indices.ptr()));
 
     GL_CHECK(DisableVertexAttribArray(common->texCoordAttrib));
     GL_CHECK(DisableVertexAttribArray(common->positionAttrib));
@@ -322,18 +819,26 @@ PLY_NO_INLINE void drawOutlinedText(const SDFOutline* outline, const SDFFont* sd
                                     const TextBuffers& tb, const Float4x4& modelToViewport,
                                     const Float4& fillColor, const Float4& outlineColor,
                                     ArrayView<const Float2> centerSlope) {
-    GL_CHECK(UseProgram(outline->shader.id));
-    GL_CHECK(Disable(GL_DEPTH_TEST));
-    GL_CHECK(DepthMask(GL_FALSE));
-    GL_CHECK(Enable(GL_BLEND));
+    if (TextBatch* batch = getTextBatch(tb)) {
+        // The outline shader doesn't use sdfParams
+        batch->setOutline(outlineColor, centerSlope);
+        batch->add(TextBatch::Outlined, &outline->instanced, sdfFont, tb, modelToViewport,
+                   {0, 0}, fillColor);
+        return;
+    }
+
+    GL_STATE(UseProgram(outline->shader.id));
+    GL_STATE(Disable(GL_DEPTH_TEST));
+    GL_STATE(DepthMask(GL_FALSE));
+    GL_STATE(Enable(GL_BLEND));
     // Premultiplied alpha
     GL_CHECK(BlendEquation(GL_FUNC_ADD));
-    GL_CHECK(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_SRC_ALPHA));
+    GL_STATE(BlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_SRC_ALPHA));
 
     GL_CHECK(UniformMatrix4fv(outline->modelToViewportUniform, 1, GL_FALSE,
                               (GLfloat*) &modelToViewport));
-    GL_CHECK(ActiveTexture(GL_TEXTURE0));
-    GL_CHECK(BindTexture(GL_TEXTURE_2D, sdfFont->fontTexture.id));
+    GL_STATE(ActiveTexture(GL_TEXTURE0));
+    GL_STATE(BindTexture(GL_TEXTURE_2D, sdfFont->fontTexture.id));
     GL_CHECK(Uniform1i(outline->textureUniform, 0));
     Float4 colors[3] = {{0, 0, 0, 1}, outlineColor, fillColor};
     GL_CHECK(Uniform4fv(outline->colorsUniform, 3, (const GLfloat*) colors));
@@ -342,22 +847,27 @@ PLY_NO_INLINE void drawOutlinedText(const SDFOutline* outline, const SDFFont* sd
     GL_CHECK(Uniform1f(outline->separatorUniform, mix(centerSlope[0].x, centerSlope[1].x, 0.5f)));
 
     // Bind VBO
-    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, tb.vbo));
+    GL_CHECK(BindBuffer(GL_ARRAY_BUFFER, tb.vbo.id));
     GL_CHECK(EnableVertexAttribArray(outline->positionAttrib));
     GL_CHECK(VertexAttribPointer(outline->positionAttrib, 2, GL_FLOAT, GL_FALSE,
-                                 (GLsizei) sizeof(VertexP2T), (GLvoid*) offsetof(VertexP2T, pos)));
+                                 (GLsizei) sizeof(VertexP2T),
+                                 tb.vbo.ptr(offsetof(VertexP2T, pos))));
     GL_CHECK(EnableVertexAttribArray(outline->texCoordAttrib));
     GL_CHECK(VertexAttribPointer(outline->texCoordAttrib, 2, GL_FLOAT, GL_FALSE,
-                                 (GLsizei) sizeof(VertexP2T), (GLvoid*) offsetof(VertexP2T, uv)));
+                                 (GLsizei) sizeof(VertexP2T),
+                                 tb.vbo.ptr(offsetof(VertexP2T, uv))));
 
     // Bind index buffer
-    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, tb.indices));
+    GL_CHECK(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, tb.indices.id));
 
     // Draw
-    GL_CHECK(DrawElements(GL_TRIANGLES, (GLsizei) tb.numIndices, GL_UNSIGNED_SHORT, (void*) 0));
+    GL_CHECK(
+        DrawElements(GL_TRIANGLES, (GLsizei) tb.numIndices, GL_UNSIGNED_SHORT, tb.indices.ptr()));
 
     GL_CHECK(DisableVertexAttribArray(outline->texCoordAttrib));
     GL_CHECK(DisableVertexAttribArray(outline->positionAttrib));
 }
 
 } // namespace flap
+
+#endif // !FLAPGAME_HEADLESS
@@ -4,6 +4,38 @@
 
 namespace flap {
 
+// Instanced program used by TextBatch, where each instance is a glyph. The outline variant takes
+// its fill color from the instance and its other parameters from uniforms, as in SDFOutline.
+struct SDFInstancedProgram {
+    struct InstanceData {
+        Float2 origin = {0, 0}; // Viewport space
+        Float2 xAxis = {0, 0};
+        Float2 yAxis = {0, 0};
+        Float2 sdfParams = {0, 0};
+        Float4 uvRect = {0, 0, 0, 0}; // Atlas coordinates at origin and origin + xAxis + yAxis
+        Float4 color = {0, 0, 0, 0};
+    };
+
+    ShaderProgram shader;
+    GLint vertPositionAttrib = 0;
+    GLint instOriginAttrib = 0;
+    GLint instXAxisAttrib = 0;
+    GLint instYAxisAttrib = 0;
+    GLint instSDFParamsAttrib = -1; // Not used by the outline variant
+    GLint instUVRectAttrib = 0;
+    GLint instColorAttrib = 0;
+    GLint textureUniform = 0;
+    GLint outlineColorUniform = -1; // Outline variant only
+    GLint centerSlopeUniform = -1;
+    GLint separatorUniform = -1;
+    GLBuffer quadVBO;
+    GLBuffer quadIndices;
+    u32 quadNumIndices = 0;
+
+    void init(bool outline);
+    void draw(GLuint textureID, ArrayView<const InstanceData> instanceData) const;
+};
+
 struct SDFCommon {
     ShaderProgram shader;
     GLint positionAttrib = 0;
@@ -12,6 +44,7 @@ struct SDFCommon {
     GLint textureUniform = 0;
     GLint sdfParamsUniform = 0;
     GLint colorUniform = 0;
+    SDFInstancedProgram instanced;
 
     static Owned<SDFCommon> create();
 };
@@ -25,10 +58,21 @@ struct SDFOutline {
     GLint colorsUniform = 0;
     GLint centerSlopeUniform = 0;
     GLint separatorUniform = 0;
+    SDFInstancedProgram instanced;
 
     static Owned<SDFOutline> create();
 };
 
+// Describes a font to bake: its size and the range of code points it covers.
+struct SDFFontDesc {
+    float pixelHeight = 48.f;
+    u32 firstCodePoint = 32;
+    u32 numCodePoints = 96;
+    s32 atlasSize = 512;
+};
+
+struct SDFBakedFont;
+
 struct SDFFont {
     struct Char {
         Box<Int2<s16>> atlasCoords;
@@ -36,16 +80,60 @@ struct SDFFont {
         float xAdvance = 0;
     };
 
+    struct LoadInfo {
+        bool fromCache = false;
+        // Time taken by the bake that produced the atlas, even if it was loaded from the cache
+        double bakeSeconds = 0;
+    };
+
     Texture fontTexture;
+    u32 firstCodePoint = 32; // chars[i] is code point firstCodePoint + i
     Array<Char> chars;
 
+    // Takes the chars of baked and uploads its atlas
+    static Owned<SDFFont> create(SDFBakedFont* baked);
+    // numThreads = 0 uses one thread per core. See bakeSDFFonts.
+    static Array<Owned<SDFFont>> bakeMany(StringView ttfBuffer, ArrayView<const SDFFontDesc> descs,
+                                          u32 numThreads = 0);
     static Owned<SDFFont> bake(StringView ttfBuffer, float pixelHeight);
+    // Loads the atlas and character metrics from cachePath if they were baked from the same TTF
+    // data with the same parameters. Otherwise, bakes them and saves them to cachePath.
+    static Owned<SDFFont> loadOrBake(StringView ttfBuffer, float pixelHeight,
+                                     StringView cachePath, LoadInfo* info = nullptr);
+};
+
+// A font baked on the CPU, before its atlas is uploaded
+struct SDFBakedFont {
+    SDFFontDesc desc;
+    Array<SDFFont::Char> chars;
+    image::OwnImage atlasIm;
+
+    PLY_INLINE SDFBakedFont(const SDFFontDesc& desc)
+        : desc{desc}, atlasIm{desc.atlasSize, desc.atlasSize, image::Format::Byte} {
+    }
+};
+
+// Bakes all the given fonts in one job. The glyph SDFs of every font are generated in parallel by
+// numThreads threads, including the calling thread. Then, each font's glyphs are packed into its
+// own atlas. Doesn't need a GL context.
+Array<Owned<SDFBakedFont>> bakeSDFFonts(StringView ttfBuffer, ArrayView<const SDFFontDesc> descs,
+                                        u32 numThreads);
+
+// A glyph quad in the model space of its string. uv0 and uv1 are the atlas coordinates at
+// rect.mins and rect.maxs.
+struct TextGlyph {
+    Rect rect = {{0, 0}, {0, 0}};
+    Float2 uv0 = {0, 0};
+    Float2 uv1 = {0, 0};
 };
 
 struct TextBuffers {
-    GLuint indices = 0;
-    GLuint vbo = 0;
+    DynamicArrayBuffers::Range indices;
+    DynamicArrayBuffers::Range vbo;
     u32 numIndices = 0;
+    // Used by TextBatch. Valid until the end of the frame, and empty if there's no
+    // TextLayoutCache::instance.
+    ArrayView<const TextGlyph> glyphs;
     float xMin = Limits<float>::Max;
     float xMax = Limits<float>::Min;
 
@@ -57,7 +145,92 @@ struct TextBuffers {
     }
 };
 
+// Keeps the vertex and index buffers of recently drawn strings in GPU memory, so that text that
+// doesn't change from one frame to the next is laid out and uploaded only once. Owned by GameFlow
+// and installed as TextLayoutCache::instance during render. When the cache is full, the least
+// recently used string is evicted, unless it was already drawn this frame. When useCache is false,
+// every string is laid out and uploaded again each frame, as before.
+struct TextLayoutCache {
+    struct Entry {
+        const SDFFont* sdfFont = nullptr;
+        String text;
+        GLBuffer indices;
+        GLBuffer vbo;
+        Array<TextGlyph> glyphs;
+        TextBuffers tb;
+        u32 lastFrameUsed = 0;
+    };
+
+    static const u32 MaxEntries = 64;
+
+    bool useCache = true;
+    Array<Entry> entries;
+    u32 frameNumber = 0;
+    // Strings laid out since the last call to beginFrame, whether cached or not
+    u32 numLayouts = 0;
+    // Glyphs of strings that weren't cached this frame
+    Array<Array<TextGlyph>> frameGlyphs;
+
+    // Returns nullptr if the string isn't cached and no entry can be evicted.
+    const TextBuffers* get(const SDFFont* sdfFont, StringView text);
+    PLY_INLINE void beginFrame() {
+        this->frameNumber++;
+        this->numLayouts = 0;
+        this->frameGlyphs.clear();
+    }
+
+    static TextLayoutCache* instance;
+};
+
+// Uses TextLayoutCache::instance when there is one; otherwise, uploads the buffers through
+// DynamicArrayBuffers and they're only valid for the current frame.
 TextBuffers generateTextBuffers(const SDFFont* sdfFont, StringView text);
+
+// Collects the glyphs of consecutive drawText and drawOutlinedText calls that share a program,
+// blend mode and font, so that they're drawn together with a single instanced call. This includes
+// drop shadows, which are drawn with the same program just before the text. Owned by GameFlow and
+// installed as TextBatch::instance during render. Code that draws text must call flush before
+// drawing anything else, so that the text is still drawn in painter order. Only 2D affine
+// modelToViewport transforms are supported, which is all that text uses. When useBatching is
+// false, each string is drawn immediately, as before.
+struct TextBatch {
+    enum Mode : u8 {
+        Normal,
+        AlphaOnly,
+        Outlined,
+    };
+
+    bool useBatching = true;
+    Mode mode = Normal;
+    const SDFInstancedProgram* program = nullptr;
+    const SDFFont* sdfFont = nullptr;
+    Float4 outlineColor = {0, 0, 0, 0}; // Outlined mode only
+    Float2 centerSlope[2] = {{0, 0}, {0, 0}};
+    Array<SDFInstancedProgram::InstanceData> instances;
+    // Text draw calls issued since the last call to beginFrame, whether batched or not
+    u32 numDrawCalls = 0;
+
+    // Call before adding glyphs in Outlined mode.
+    void setOutline(const Float4& outlineColor, ArrayView<const Float2> centerSlope);
+    void add(Mode mode, const SDFInstancedProgram* program, const SDFFont* sdfFont,
+             const TextBuffers& tb, const Float4x4& modelToViewport, const Float2& sdfParams,
+             const Float4& color);
+    void flush();
+    PLY_INLINE void beginFrame() {
+        PLY_ASSERT(this->instances.isEmpty());
+        this->numDrawCalls = 0;
+    }
+
+    // Does nothing if there's no instance
+    static PLY_INLINE void flushInstance() {
+        if (instance) {
+            instance->flush();
+        }
+    }
+
+    static TextBatch* instance;
+};
+
 void drawText(const SDFCommon* common, const SDFFont* sdfFont, const TextBuffers& tb,
               const Float4x4& modelToViewport, const Float2& sdfParams, const Float4& color,
               bool alphaOnly = false);
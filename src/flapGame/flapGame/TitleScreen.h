@@ -1,6 +1,8 @@
 #pragma once
 #include <flapGame/Core.h>
+#if !FLAPGAME_HEADLESS
 #include <flapGame/GLHelpers.h>
+#endif
 #include <flapGame/Button.h>
 
 namespace flap {
@@ -45,8 +47,15 @@ struct StarSystem {
 };
 
 struct TitleScreen {
+#if !FLAPGAME_HEADLESS
     Texture tempTex;
     RenderToTexture tempRTT;
+    // The title meshes alone, over transparent black. Redrawn when titleToViewport changes.
+    Texture titleLayerTex;
+    RenderToTexture titleLayerRTT;
+    Float4x4 titleLayerToViewport = Float4x4::identity();
+    bool titleLayerValid = false;
+#endif
     TitleRotator titleRot;
     StarSystem starSys;
     bool showPrompt = true;
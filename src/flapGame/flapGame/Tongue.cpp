@@ -1,11 +1,11 @@
 #include <flapGame/Core.h>
 #include <flapGame/Tongue.h>
-#include <flapGame/Assets.h>
+#include <flapGame/SimAssets.h>
 
 namespace flap {
 
 Tongue::Tongue() {
-    const Assets* a = Assets::instance;
+    const SimAssets* a = SimAssets::instance;
     for (u32 i = 0; i < a->bad.tongueBones.numItems(); i++) {
         this->states[0].pts.append(Float3{0.4f * i, 0, 0});
     }
@@ -37,7 +37,7 @@ Float3 constrainToCone(const Float3& ray, const Float3& fwd, const Float2& coneC
 
 void Tongue::update(const Float3& correction, const Quaternion& birdToWorldRot, float dt,
                     bool applySidewaysForce, float limitZ) {
-    const Assets* a = Assets::instance;
+    const SimAssets* a = SimAssets::instance;
     s32 iters = 1;
     for (; iters > 0; iters--) {
         this->curIndex = 1 - this->curIndex;
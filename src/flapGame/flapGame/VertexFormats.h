@@ -33,11 +33,6 @@ struct VertexPNT {
 };
 
 struct DrawMesh {
-    struct Bone {
-        u32 indexInSkel = 0;
-        Float4x4 baseModelToBone = Float4x4::identity();
-    };
-
     enum class VertexType {
         Skinned,
         NotSkinned,
@@ -49,8 +44,25 @@ struct DrawMesh {
     Float3 diffuse = {0, 0, 0};
     u32 numIndices = 0;
     GLBuffer vbo;
-    GLBuffer indexBuffer;
-    Array<Bone> bones;
+    GLBuffer indexBuffer; // Skinned meshes' blend indices refer to SkinPaletteLayout slots
+
+    struct VAO {
+        const void* shader = nullptr;
+        GLVertexArray vao;
+    };
+    // Vertex attribute setup recorded for each shader that draws this mesh. Filled in at load time
+    // by buildVAO (see Shaders.h); mutable since it's a GL-side cache of the mesh's own data.
+    mutable Array<VAO> vaos;
+
+    PLY_INLINE GLuint findVAO(const void* shader) const {
+        if (!GLVertexArray::useMeshVAOs)
+            return 0;
+        for (const VAO& v : this->vaos) {
+            if (v.shader == shader)
+                return v.vao.id;
+        }
+        return 0;
+    }
 };
 
 } // namespace flap
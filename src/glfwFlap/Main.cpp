@@ -2,6 +2,7 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
+#include <chrono>
 
 #define WITH_GL_DEBUG_MESSAGES 0
 
@@ -68,10 +69,100 @@ static void mousebutton_callback(GLFWwindow* window, int button, int action, int
     }
 }
 
+//---------------------------------------------------------------------------
+//  Font bake benchmark
+//---------------------------------------------------------------------------
+// Measures how long baking the SDF font takes with 1, 2, 4, ... threads up to maxThreads, both for
+// the game's font alone and for a job that also bakes a smaller and a larger size.
+int runFontBakeBenchmark(StringView assetsPath, u32 maxThreads) {
+    String ttfBuffer = FileSystem::native()->loadBinary(
+        NativePath::join(assetsPath, "poppins-bold-694-webfont.ttf"));
+    if (FileSystem::native()->lastResult() != FSResult::OK) {
+        StdErr::text() << "Error: Can't load font\n";
+        return 1;
+    }
+    static const float PixelHeights[] = {48.f, 24.f, 96.f};
+    static const u32 NumIterations = 5;
+    for (u32 numThreads = 1;; numThreads = min(numThreads * 2, maxThreads)) {
+        double seconds[2] = {0, 0};
+        for (u32 j = 0; j < 2; j++) {
+            ArrayView<const float> job{PixelHeights, j == 0 ? 1u : 3u};
+            auto startTime = std::chrono::steady_clock::now();
+            for (u32 i = 0; i < NumIterations; i++) {
+                flap::benchmarkSDFFontBake(ttfBuffer, job, numThreads);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+            seconds[j] = elapsed.count() / NumIterations;
+        }
+        StdOut::text().format("{} threads: {} ms for 48px, {} ms for 24px + 48px + 96px\n",
+                              numThreads, seconds[0] * 1000.0, seconds[1] * 1000.0);
+        if (numThreads >= maxThreads)
+            break;
+    }
+    return 0;
+}
+
 //---------------------------------------------------------------------------
 //  Main loop
 //---------------------------------------------------------------------------
 int main(int argc, char* argv[]) {
+    // Parse command line
+    // --record <path>: Record input until the window is closed
+    // --replay <path>: Play back a recording and report the average frame time. State hashes are
+    //                  written to <path>.hashes for comparison with headlessFlap.
+    // --sim-rate <hz>: Run the simulation at the given number of steps per second, using swept
+    //                  collision
+    // --vaos <0|1>:    Use per-mesh VAOs (default 1)
+    // --ring-buffer <0|1>: Sub-allocate dynamic data from per-frame ring buffers (default 1)
+    // --text-cache <0|1>:  Keep the buffers of recently drawn strings (default 1)
+    // --text-batch <0|1>:  Draw consecutive strings with one instanced call (default 1)
+    // --pose-cache <0|1>:  Blend the bird's pose from poses baked at load time (default 1)
+    // --title-cache <0|1>: Reuse the title screen's title layer while it isn't moving (default 1)
+    // --dyn-res <fps>:     Lower the resolution when the frame rate drops below <fps> (default off)
+    // --bench-font <maxThreads>: Measure SDF font bake time for 1, 2, 4, ... threads and exit
+    String recordPath;
+    String replayPath;
+    float simRate = 0;
+    bool useVAOs = true;
+    bool useRingBuffer = true;
+    bool useTextCache = true;
+    bool useTextBatching = true;
+    bool usePoseCache = true;
+    bool useTitleCache = true;
+    float dynResFPS = 0;
+    u32 benchFontThreads = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        StringView arg = argv[i];
+        if (arg == "--record") {
+            recordPath = argv[i + 1];
+        } else if (arg == "--replay") {
+            replayPath = argv[i + 1];
+        } else if (arg == "--sim-rate") {
+            simRate = StringView{argv[i + 1]}.to<float>(0);
+        } else if (arg == "--vaos") {
+            useVAOs = (StringView{argv[i + 1]} != "0");
+        } else if (arg == "--ring-buffer") {
+            useRingBuffer = (StringView{argv[i + 1]} != "0");
+        } else if (arg == "--text-cache") {
+            useTextCache = (StringView{argv[i + 1]} != "0");
+        } else if (arg == "--text-batch") {
+            useTextBatching = (StringView{argv[i + 1]} != "0");
+        } else if (arg == "--pose-cache") {
+            usePoseCache = (StringView{argv[i + 1]} != "0");
+        } else if (arg == "--title-cache") {
+            useTitleCache = (StringView{argv[i + 1]} != "0");
+        } else if (arg == "--dyn-res") {
+            dynResFPS = StringView{argv[i + 1]}.to<float>(0);
+        } else if (arg == "--bench-font") {
+            benchFontThreads = StringView{argv[i + 1]}.to<u32>(0);
+        }
+    }
+
+    if (benchFontThreads > 0) {
+        return runFontBakeBenchmark(NativePath::join(FLAPGAME_REPO_FOLDER, "data"),
+                                    benchFontThreads);
+    }
+
     // Initialize GLFW
     glfwSetErrorCallback(error_callback);
 
@@ -113,7 +204,18 @@ int main(int argc, char* argv[]) {
     GL_CHECK(BindVertexArray(vao));
 
     // Init game
-    flap::init(NativePath::join(FLAPGAME_REPO_FOLDER, "data"));
+    flap::init(NativePath::join(FLAPGAME_REPO_FOLDER, "data"),
+               NativePath::join(FLAPGAME_REPO_FOLDER, "cache"));
+    {
+        flap::LoadStats ls = flap::getLoadStats();
+        if (ls.fontFromCache) {
+            StdOut::text().format("SDF font loaded from cache in {} ms, saving {} ms\n",
+                                  ls.fontSeconds * 1000.0,
+                                  (ls.fontBakeSeconds - ls.fontSeconds) * 1000.0);
+        } else {
+            StdOut::text().format("SDF font baked in {} ms\n", ls.fontSeconds * 1000.0);
+        }
+    }
 
     // Create gf
     flap::GameFlow* gf = flap::createGameFlow();
@@ -121,6 +223,28 @@ int main(int argc, char* argv[]) {
     glfwSetKeyCallback(window, key_callback);
     glfwSetMouseButtonCallback(window, mousebutton_callback);
 
+    flap::setUseMeshVAOs(useVAOs);
+    flap::setUseRingBuffer(gf, useRingBuffer);
+    flap::setUseTextLayoutCache(gf, useTextCache);
+    flap::setUseTextBatching(gf, useTextBatching);
+    flap::setUseBirdPoseCache(usePoseCache);
+    flap::setUseTitleLayerCache(gf, useTitleCache);
+    if (dynResFPS > 0) {
+        flap::setDynamicResolution(gf, 1.f / dynResFPS);
+    }
+    if (simRate > 0) {
+        flap::setSimulationRate(gf, simRate, true);
+    }
+    if (replayPath) {
+        if (!flap::startReplay(gf, replayPath, 200, replayPath + ".hashes")) {
+            StdErr::text().format("Error: Can't load recording '{}'\n", replayPath);
+        }
+    } else if (recordPath) {
+        flap::startRecording(gf);
+    }
+    u32 numReplayFrames = 0;
+    double replayStartTime = glfwGetTime();
+
     // Main loop
     double lastTime = glfwGetTime();
     while (!glfwWindowShouldClose(window)) {
@@ -131,7 +255,40 @@ int main(int argc, char* argv[]) {
         glfwGetFramebufferSize(window, &renderWidth, &renderHeight);
 
         // Update the gf
+        bool wasReplaying = flap::isReplaying(gf);
         update(gf, (float) (now - lastTime));
+        if (wasReplaying) {
+            numReplayFrames++;
+            if (!flap::isReplaying(gf)) {
+                StdOut::text().format("Replay finished: {} frames, average frame time {} ms\n",
+                                      numReplayFrames,
+                                      (now - replayStartTime) * 1000.0 / numReplayFrames);
+                const flap::RenderStats& rs = flap::getRenderStats(gf);
+                double frames = (double) max<u64>(rs.numFrames, 1);
+                StdOut::text().format(
+                    "Sorted draws per frame: {}, program changes: {} (unsorted {}), texture "
+                    "changes: {} (unsorted {}), mesh changes: {} (unsorted {})\n",
+                    rs.numSortedDraws / frames, rs.numProgramChanges / frames,
+                    rs.numUnsortedProgramChanges / frames, rs.numTextureChanges / frames,
+                    rs.numUnsortedTextureChanges / frames, rs.numMeshChanges / frames,
+                    rs.numUnsortedMeshChanges / frames);
+                StdOut::text().format("GL state calls per frame: {} issued, {} skipped\n",
+                                      rs.numStateCallsIssued / frames,
+                                      rs.numStateCallsSkipped / frames);
+                StdOut::text().format("Dynamic data per frame: {} bytes, {} buffers created\n",
+                                      rs.numBytesUploaded / frames,
+                                      rs.numBuffersCreated / frames);
+                StdOut::text().format("Text layouts per frame: {}, text draw calls: {}\n",
+                                      rs.numTextLayouts / frames, rs.numTextDrawCalls / frames);
+                StdOut::text().format("Title redraws per frame: {}\n",
+                                      rs.numTitleRedraws / frames);
+                StdOut::text().format("Render scale: average {}, min {}, {} changes\n",
+                                      rs.sumRenderScale / frames, rs.minRenderScale,
+                                      rs.numRenderScaleChanges);
+                StdOut::text().format("CPU time in render per frame: {} ms\n",
+                                      rs.cpuSeconds * 1000.0 / frames);
+            }
+        }
         if (renderWidth > 0 && renderHeight > 0) {
             render(gf, {(float) renderWidth, (float) renderHeight}, (float) (now - lastTime));
         }
@@ -143,6 +300,12 @@ int main(int argc, char* argv[]) {
         lastTime = now;
     }
 
+    if (recordPath) {
+        if (!flap::saveRecording(gf, recordPath)) {
+            StdErr::text().format("Error: Can't save recording '{}'\n", recordPath);
+        }
+    }
+
     // Destroy gf
     destroy(gf);
 
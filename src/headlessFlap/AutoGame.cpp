@@ -0,0 +1,57 @@
+#include <flapGame/Core.h>
+#include <AutoGame.h>
+
+namespace flap {
+
+Owned<GameState> startGame(GameState::OuterContext* ctx) {
+    Owned<GameState> gs = new GameState;
+    gs->outerCtx = ctx;
+    UpdateContext uc;
+    uc.gs = gs;
+    PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+    gs->startPlaying();
+    return gs;
+}
+
+void sendInput(GameState* gs, bool down) {
+    UpdateContext uc;
+    uc.gs = gs;
+    PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+    doInput(gs, {240, 320}, down);
+}
+
+// Very simple autopilot: flap whenever the bird falls below the middle of the screen.
+bool wantsToFlap(const GameState* gs) {
+    if (gs->lifeState.dead())
+        return true; // Tap to play again
+    if (auto playing = gs->mode.playing())
+        return gs->bird.pos[0].z < 0.f && playing->zVel[0] < 0.f;
+    return false;
+}
+
+AutoGame::AutoGame(u64 seed) {
+    this->ctx.gameSeeds = Random{seed};
+    this->gs = startGame(&this->ctx);
+    this->numGames = 1;
+}
+
+void AutoGame::step() {
+    if (wantsToFlap(this->gs)) {
+        sendInput(this->gs, true);
+        sendInput(this->gs, false);
+    }
+    if (this->ctx.needsRestart) {
+        this->ctx.needsRestart = false;
+        this->totalScore += this->gs->score;
+        this->numCollisionQueries += this->gs->playfield.index.numQueries;
+        this->numCollisionTests += this->gs->playfield.index.numResults;
+        this->gs = startGame(&this->ctx);
+        this->numGames++;
+    }
+    UpdateContext uc;
+    uc.gs = this->gs;
+    PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+    timeStep(&uc);
+}
+
+} // namespace flap
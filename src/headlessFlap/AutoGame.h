@@ -0,0 +1,31 @@
+#pragma once
+#include <flapGame/Core.h>
+#include <flapGame/GameState.h>
+
+namespace flap {
+
+// A game played by a simple autopilot, restarted whenever the bird dies. Doesn't touch any global
+// state other than the read-only SimAssets::instance, so separate AutoGames can be stepped on
+// separate threads.
+struct AutoGame {
+    struct Context final : GameState::OuterContext {
+        bool needsRestart = false;
+
+        virtual void onRestart() override {
+            this->needsRestart = true;
+        }
+    };
+
+    Context ctx;
+    Owned<GameState> gs;
+    u32 numGames = 0;
+    u64 totalScore = 0; // Doesn't include the game in progress
+    // Obstacle index statistics, not including the game in progress
+    u64 numCollisionQueries = 0;
+    u64 numCollisionTests = 0;
+
+    AutoGame(u64 seed);
+    void step();
+};
+
+} // namespace flap
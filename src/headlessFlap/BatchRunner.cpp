@@ -0,0 +1,47 @@
+#include <flapGame/Core.h>
+#include <BatchRunner.h>
+#include <atomic>
+#include <thread>
+
+namespace flap {
+
+BatchRunner::BatchRunner(u32 numGames, u64 seed) {
+    Random seeds{seed};
+    this->games.reserve(numGames);
+    for (u32 i = 0; i < numGames; i++) {
+        this->games.append(new AutoGame{seeds.next64()});
+    }
+}
+
+void BatchRunner::run(u32 numThreads, u32 numSteps) {
+    u32 numChunks = (this->games.numItems() + GamesPerChunk - 1) / GamesPerChunk;
+    std::atomic<u32> nextChunk{0};
+
+    auto worker = [&] {
+        for (;;) {
+            u32 chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= numChunks)
+                break;
+            u32 start = chunk * GamesPerChunk;
+            u32 end = min(start + GamesPerChunk, this->games.numItems());
+            // Step each game to completion while its state is hot in the cache
+            for (u32 i = start; i < end; i++) {
+                AutoGame* game = this->games[i];
+                for (u32 s = 0; s < numSteps; s++) {
+                    game->step();
+                }
+            }
+        }
+    };
+
+    Array<std::thread> threads;
+    for (u32 t = 1; t < numThreads; t++) {
+        threads.append(std::thread{worker});
+    }
+    worker(); // The calling thread works too
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace flap
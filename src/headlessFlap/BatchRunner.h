@@ -0,0 +1,21 @@
+#pragma once
+#include <flapGame/Core.h>
+#include <AutoGame.h>
+
+namespace flap {
+
+// Steps many independent AutoGames in parallel. The games are divided into small chunks, and each
+// worker thread repeatedly claims the next unclaimed chunk from a shared atomic counter until none
+// are left. Threads that finish their chunks early simply claim more, which keeps all cores busy
+// even when some games take longer to step than others (for example, while restarting).
+struct BatchRunner {
+    static constexpr u32 GamesPerChunk = 16;
+
+    Array<Owned<AutoGame>> games;
+
+    BatchRunner(u32 numGames, u64 seed);
+    // Advances every game by numSteps simulation steps
+    void run(u32 numThreads, u32 numSteps);
+};
+
+} // namespace flap
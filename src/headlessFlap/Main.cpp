@@ -0,0 +1,616 @@
+#include <flapGame/Core.h>
+#include <flapGame/GameState.h>
+#include <flapGame/SimAssets.h>
+#include <flapGame/Replay.h>
+#include <flapGame/BirdBatch.h>
+#include <flapGame/Snapshot.h>
+#include <flapGame/Collision.h>
+#include <AutoGame.h>
+#include <BatchRunner.h>
+#include <chrono>
+#include <thread>
+
+using namespace flap;
+
+//---------------------------------------------------------------------------
+//  Replay
+//---------------------------------------------------------------------------
+// Follows the same game flow as GameFlow.cpp, minus rendering and audio, so that a recording made
+// in the full game produces the same state hashes here.
+struct ReplayContext final : GameState::OuterContext {
+    Owned<GameState> gameState;
+    Owned<GameState> oldGameState; // Non-null during a transition
+    float transFrac = 0.f;
+
+    void resetGame(bool isPlaying) {
+        this->gameState = new GameState;
+        this->gameState->outerCtx = this;
+        UpdateContext uc;
+        uc.gs = this->gameState;
+        if (UpdateContext::instance_) {
+            uc.bounds2D = UpdateContext::instance_->bounds2D;
+        }
+        PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+        if (isPlaying) {
+            this->gameState->startPlaying();
+        } else {
+            this->gameState->startTitle();
+        }
+    }
+
+    virtual void onRestart() override {
+        this->oldGameState = std::move(this->gameState);
+        this->transFrac = 0.f;
+        this->resetGame(true);
+    }
+
+    virtual void backToTitle() override {
+        if (!this->oldGameState) {
+            this->oldGameState = std::move(this->gameState);
+            this->transFrac = 0.f;
+            this->resetGame(false);
+        }
+    }
+};
+
+int runReplay(StringView path, u32 hashInterval) {
+    String data = FileSystem::native()->loadBinary(path);
+    if (FileSystem::native()->lastResult() != FSResult::OK) {
+        StdErr::text().format("Error: Can't read '{}'\n", path);
+        return 1;
+    }
+    Replay replay;
+    replay.recording = Recording::load(data);
+    if (!replay.recording) {
+        StdErr::text().format("Error: '{}' is not a valid recording\n", path);
+        return 1;
+    }
+    replay.hashInterval = hashInterval;
+
+    ReplayContext ctx;
+    ctx.gameSeeds = Random{replay.recording->seed};
+    ctx.simulationTimeStep = replay.recording->simulationTimeStep;
+    ctx.sweptCollision = replay.recording->sweptCollision;
+    ctx.resetGame(false);
+
+    u32 step = 0;
+    while (!replay.isFinished(step)) {
+        while (const Recording::Event* event = replay.popEvent(step)) {
+            applyInput(ctx.gameState, *event);
+        }
+
+        {
+            UpdateContext uc;
+            PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+            uc.gs = ctx.gameState;
+            timeStep(&uc);
+            if (ctx.gameState->score >= ctx.bestScore) {
+                ctx.bestScore = ctx.gameState->score;
+            }
+        }
+
+        step++;
+        replay.onStepComplete(ctx.gameState, step);
+
+        if (ctx.oldGameState) {
+            ctx.transFrac += ctx.simulationTimeStep * 2.f;
+            if (ctx.transFrac >= 1.f) {
+                ctx.oldGameState.clear();
+            } else {
+                UpdateContext uc;
+                PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+                uc.gs = ctx.oldGameState;
+                timeStep(&uc);
+            }
+        }
+    }
+
+    StdOut::text() << replay.hashesToText();
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+//  Batch
+//---------------------------------------------------------------------------
+// Measures throughput of BatchRunner for 1, 2, 4, ... threads up to maxThreads.
+void runBatchBenchmark(u32 numGames, u32 numSteps, u32 maxThreads) {
+    StdOut::text().format("{} games x {} steps\n", numGames, numSteps);
+    for (u32 numThreads = 1;; numThreads = min(numThreads * 2, maxThreads)) {
+        BatchRunner runner{numGames, 1};
+        auto startTime = std::chrono::steady_clock::now();
+        runner.run(numThreads, numSteps);
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        StdOut::text().format("{} threads: {} game-steps/sec\n", numThreads,
+                              (double) numGames * numSteps / seconds);
+        if (numThreads >= maxThreads)
+            break;
+    }
+}
+
+//---------------------------------------------------------------------------
+//  Birds
+//---------------------------------------------------------------------------
+void initBirds(BirdBatch* batch, u32 numBirds) {
+    Random random{1};
+    batch->resize(numBirds);
+    for (u32 i = 0; i < numBirds; i++) {
+        batch->posX[i] = 0.f;
+        batch->posY[i] = 0.f;
+        batch->posZ[i] = mix(-10.f, 10.f, random.nextFloat());
+        batch->zVel[i] = mix(-50.f, 31.5f, random.nextFloat());
+        batch->curGravity[i] = mix(20.f, 150.f, random.nextFloat());
+        batch->gravApproach[i] = mix(20.f, GameState::NormalGravity, random.nextFloat());
+        batch->angle[i] = mix(-Pi, Pi, random.nextFloat());
+        batch->timeScale[i] = (random.next32() % 4 == 0) ? GameState::SlowMotionFactor : 1.f;
+    }
+}
+
+bool sameBits(const Array<float>& a, const Array<float>& b) {
+    return a.stringView() == b.stringView();
+}
+
+// Compares BirdBatch::step against BirdBatch::stepScalar, and checks that the results match
+// bit-for-bit.
+int runBirdBenchmark(u32 numBirds, u32 numSteps) {
+    float dt = GameState::OuterContext{}.simulationTimeStep;
+    BirdBatch scalar;
+    BirdBatch batch;
+    initBirds(&scalar, numBirds);
+    initBirds(&batch, numBirds);
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (u32 s = 0; s < numSteps; s++) {
+        scalar.stepScalar(dt);
+    }
+    auto midTime = std::chrono::steady_clock::now();
+    for (u32 s = 0; s < numSteps; s++) {
+        batch.step(dt);
+    }
+    auto endTime = std::chrono::steady_clock::now();
+
+    double scalarSeconds = std::chrono::duration<double>(midTime - startTime).count();
+    double batchSeconds = std::chrono::duration<double>(endTime - midTime).count();
+    double birdSteps = (double) numBirds * numSteps;
+    StdOut::text().format("{} birds x {} steps\n", numBirds, numSteps);
+    StdOut::text().format("scalar: {} bird-steps/sec\n", birdSteps / scalarSeconds);
+    StdOut::text().format("batch:  {} bird-steps/sec\n", birdSteps / batchSeconds);
+
+    bool identical = sameBits(scalar.posX, batch.posX) && sameBits(scalar.posY, batch.posY) &&
+                     sameBits(scalar.posZ, batch.posZ) && sameBits(scalar.zVel, batch.zVel) &&
+                     sameBits(scalar.curGravity, batch.curGravity) &&
+                     sameBits(scalar.angle, batch.angle);
+    StdOut::text().format("results {}\n", identical ? "are bit-identical" : "DIFFER");
+    return identical ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
+//  Pipes
+//---------------------------------------------------------------------------
+// Spawns pipes by advancing the playfield's obstacle sequences directly, removing old pipes as it
+// goes, and counts the memory allocations made by the obstacle pool.
+int runPipeBenchmark(u32 numPipes) {
+    AutoGame game{1};
+    while (game.gs->playfield.sequences.isEmpty()) {
+        game.step(); // Wait for the first sequence to start
+    }
+    GameState* gs = game.gs;
+    UpdateContext uc;
+    uc.gs = gs;
+    PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+
+    ObstaclePool& pool = gs->playfield.obstacles;
+    u32 startSerial = pool.nextSerial;
+    u32 startAllocs = pool.numChunkAllocations;
+    auto startTime = std::chrono::steady_clock::now();
+    while (pool.nextSerial - startSerial < numPipes) {
+        gs->playfield.spawnedToX += GameState::PipeSpacing;
+        gs->playfield.advanceSequences(gs);
+        while (pool.numItems() > 1 && pool[0].canRemove(gs->playfield.spawnedToX - 30.f)) {
+            gs->playfield.removeOldestObstacle();
+        }
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    u32 numSpawned = pool.nextSerial - startSerial;
+    u32 numAllocs = pool.numChunkAllocations - startAllocs;
+    StdOut::text().format("{} pipes spawned in {} seconds\n", numSpawned, seconds);
+    StdOut::text().format("{} pool allocations per 1000 pipes ({} total)\n",
+                          numAllocs * 1000.0 / numSpawned, numAllocs);
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+//  Snapshot
+//---------------------------------------------------------------------------
+u64 stepAndHash(GameState* gs, u32 numSteps) {
+    UpdateContext uc;
+    uc.gs = gs;
+    PLY_SET_IN_SCOPE(UpdateContext::instance_, &uc);
+    for (u32 i = 0; i < numSteps; i++) {
+        timeStep(&uc);
+    }
+    return hashGameState(gs);
+}
+
+// Measures the latency of GameState::snapshot + restore, and checks that a restored GameState
+// continues exactly the same way as the original.
+int runSnapshotBenchmark(u32 numIterations) {
+    AutoGame game{1};
+    for (u32 i = 0; i < 2000; i++) {
+        game.step(); // Get into the middle of a game
+    }
+    GameState* gs = game.gs;
+
+    Owned<GameStateSnapshot> snap = new GameStateSnapshot;
+    if (!gs->snapshot(snap)) {
+        StdErr::text() << "Error: Can't take a snapshot of this GameState\n";
+        return 1;
+    }
+    u64 expected = stepAndHash(gs, 500);
+    gs->restore(*snap);
+    u64 actual = stepAndHash(gs, 500);
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < numIterations; i++) {
+        gs->snapshot(snap);
+        gs->restore(*snap);
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    StdOut::text().format("snapshot size: {} bytes\n", (u32) sizeof(GameStateSnapshot));
+    StdOut::text().format("snapshot + restore: {} microseconds\n",
+                          seconds * 1e6 / numIterations);
+    StdOut::text().format("restored state {}\n",
+                          expected == actual ? "matches the original" : "DIVERGED");
+    return expected == actual ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
+//  Swept collision
+//---------------------------------------------------------------------------
+struct FlightResult {
+    bool hit = false;
+    float time = 0;
+    Float3 pos = {0, 0, 0};
+};
+
+// Flies a bird through a pair of pipes without flapping, and returns the first contact that the
+// game would accept as an impact.
+FlightResult flyThroughPipes(const Float3x4* pipes, Float3 pos, float zVel, float dt, bool swept) {
+    float g = GameState::NormalGravity;
+    for (float t = 0; t < 2.f; t += dt) {
+        float zVel1 = stepZVel(zVel, g, dt);
+        Float3 pos1 = stepBirdPos(pos, zVel, zVel1, dt);
+        Float3 vel = {GameState::ScrollRate, 0, zVel};
+        FlightResult best;
+        for (u32 p = 0; p < 2; p++) {
+            SphCylCollResult result;
+            float toi = 0;
+            SphCylCollResult::Type type;
+            if (swept) {
+                type = sweptSphereCylinderCollisionTest(pos, pos1, GameState::BirdRadius, pipes[p],
+                                                        GameState::PipeRadius, &toi, &result);
+            } else {
+                type = sphereCylinderCollisionTest(pos, GameState::BirdRadius, pipes[p],
+                                                   GameState::PipeRadius, &result);
+            }
+            if (type != SphCylCollResult::None && dot(vel, result.norm) < 0) {
+                if (!best.hit || t + toi * dt < best.time) {
+                    best = {true, t + toi * dt, mix(pos, pos1, toi)};
+                }
+            }
+        }
+        if (best.hit)
+            return best;
+        pos = pos1;
+        zVel = zVel1;
+    }
+    return {};
+}
+
+// Compares contacts found at larger step sizes, with and without swept collision, against the
+// default 5 ms step size.
+int runSweptCollisionTest(u32 numTrials) {
+    struct Config {
+        const char* name;
+        float dt;
+        bool swept;
+        u32 numAgree = 0;
+        u32 numBothHit = 0;
+        u32 numMissed = 0; // Reference hit, but this config didn't
+        u32 numExtra = 0;  // This config hit, but the reference didn't
+        double totalTimeError = 0;
+        double totalPosError = 0;
+    };
+    Config configs[] = {
+        {"1/60 s discrete", 1.f / 60, false},
+        {"1/60 s swept", 1.f / 60, true},
+        {"1/120 s discrete", 1.f / 120, false},
+        {"1/120 s swept", 1.f / 120, true},
+    };
+
+    Random random{1};
+    u32 numRefHits = 0;
+    for (u32 i = 0; i < numTrials; i++) {
+        // Same layout as PipeSequence
+        float gapHeight = mix(-5.f, 5.5f, random.nextFloat());
+        Float3x4 pipes[2] = {
+            Float3x4::makeTranslation({0, 0, gapHeight - 4.f}),
+            Float3x4::makeTranslation({0, 0, gapHeight + 4.f}) *
+                Float3x4::makeRotation({1, 0, 0}, Pi),
+        };
+        Float3 startPos = {-6.f, 0, mix(-8.f, 12.f, random.nextFloat())};
+        float startZVel = mix(-30.f, 31.5f, random.nextFloat());
+
+        FlightResult ref = flyThroughPipes(pipes, startPos, startZVel, 0.005f, false);
+        numRefHits += ref.hit;
+        for (Config& config : configs) {
+            FlightResult res = flyThroughPipes(pipes, startPos, startZVel, config.dt, config.swept);
+            if (ref.hit && res.hit) {
+                config.numAgree++;
+                config.numBothHit++;
+                config.totalTimeError += fabsf(res.time - ref.time);
+                config.totalPosError += (res.pos - ref.pos).length();
+            } else if (ref.hit) {
+                config.numMissed++;
+            } else if (res.hit) {
+                config.numExtra++;
+            } else {
+                config.numAgree++;
+            }
+        }
+    }
+
+    StdOut::text().format("{} trials, {} hits at 5 ms steps\n", numTrials, numRefHits);
+    for (const Config& config : configs) {
+        StdOut::text().format(
+            "{}: {} agree, {} missed, {} extra, mean time error {} ms, mean position error {}\n",
+            config.name, config.numAgree, config.numMissed, config.numExtra,
+            config.totalTimeError * 1000.0 / max(config.numBothHit, 1u),
+            config.totalPosError / max(config.numBothHit, 1u));
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+//  Batch collision
+//---------------------------------------------------------------------------
+// Tests many bird positions against a screen's worth of pipe pairs, once with
+// sphereCylinderCollisionTest on each pipe and once with sphereCylinderCollisionTestBatch, and
+// checks that both find the same contacts.
+int runCollisionBenchmark(u32 numProbes) {
+    static constexpr u32 NumPipePairs = 8;
+    Random random{1};
+    Array<Float3x4> pipes;
+    CylinderBatch batch;
+    for (u32 i = 0; i < NumPipePairs; i++) {
+        // Same layout as PipeSequence
+        float x = i * GameState::PipeSpacing;
+        float gapHeight = mix(-5.f, 5.5f, random.nextFloat());
+        pipes.append(Float3x4::makeTranslation({x, 0, gapHeight - 4.f}));
+        pipes.append(Float3x4::makeTranslation({x, 0, gapHeight + 4.f}) *
+                     Float3x4::makeRotation({1, 0, 0}, Pi));
+    }
+    for (const Float3x4& pipe : pipes) {
+        batch.add(pipe);
+    }
+
+    Array<Float3> probes;
+    probes.resize(numProbes);
+    for (Float3& probe : probes) {
+        probe = {mix(-3.f, NumPipePairs * GameState::PipeSpacing, random.nextFloat()), 0,
+                 mix(-10.f, 12.f, random.nextFloat())};
+    }
+
+    struct Result {
+        SphCylCollResult::Type type = SphCylCollResult::None;
+        u32 index = 0;
+        float depth = 0;
+    };
+    Array<Result> scalarResults;
+    Array<Result> batchResults;
+    scalarResults.resize(numProbes);
+    batchResults.resize(numProbes);
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (u32 p = 0; p < numProbes; p++) {
+        Result& best = scalarResults[p];
+        for (u32 i = 0; i < pipes.numItems(); i++) {
+            SphCylCollResult result;
+            SphCylCollResult::Type type = sphereCylinderCollisionTest(
+                probes[p], GameState::BirdRadius, pipes[i], GameState::PipeRadius, &result);
+            if (type != SphCylCollResult::None &&
+                (best.type == SphCylCollResult::None || result.penetrationDepth > best.depth)) {
+                best = {type, i, result.penetrationDepth};
+            }
+        }
+    }
+    auto midTime = std::chrono::steady_clock::now();
+    for (u32 p = 0; p < numProbes; p++) {
+        Result& best = batchResults[p];
+        SphCylCollResult result;
+        best.type = sphereCylinderCollisionTestBatch(probes[p], GameState::BirdRadius, batch,
+                                                     GameState::PipeRadius, &best.index, &result);
+        best.depth = result.penetrationDepth;
+    }
+    auto endTime = std::chrono::steady_clock::now();
+
+    u32 numHits = 0;
+    bool identical = true;
+    for (u32 p = 0; p < numProbes; p++) {
+        const Result& a = scalarResults[p];
+        const Result& b = batchResults[p];
+        if (a.type != SphCylCollResult::None) {
+            numHits++;
+            identical = identical && a.type == b.type && a.index == b.index && a.depth == b.depth;
+        } else {
+            identical = identical && b.type == SphCylCollResult::None;
+        }
+    }
+
+    double scalarSeconds = std::chrono::duration<double>(midTime - startTime).count();
+    double batchSeconds = std::chrono::duration<double>(endTime - midTime).count();
+    double numTests = (double) numProbes * pipes.numItems();
+    StdOut::text().format("{} probes x {} pipes, {} hits\n", numProbes, pipes.numItems(), numHits);
+    StdOut::text().format("scalar: {} tests/sec\n", numTests / scalarSeconds);
+    StdOut::text().format("batch:  {} tests/sec\n", numTests / batchSeconds);
+    StdOut::text().format("results {}\n", identical ? "match" : "DIFFER");
+    return identical ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
+//  Bird pose
+//---------------------------------------------------------------------------
+// Compares BirdAnimData::composePose with and without the wing pose cache, for speed and for the
+// largest difference between the two.
+int runPoseBenchmark(u32 numIterations) {
+    const BirdAnimData* bad = &SimAssets::instance->bad;
+    Array<Float4x4> composed;
+    Array<Float4x4> cached;
+    composed.resize(bad->birdSkel.numItems());
+    cached.resize(bad->birdSkel.numItems());
+
+    static const u32 NumWingMixes = 1000;
+    auto getWingMix = [](u32 i) { return (float) (i % NumWingMixes) / (NumWingMixes - 1); };
+    float maxDiff = 0;
+    for (u32 i = 0; i < NumWingMixes; i++) {
+        u32 eyeFrom = i % 4;
+        u32 eyeTo = (i + 1) % 4;
+        float eyeMix = (float) (i % 7) / 6;
+        bad->composePose(composed, getWingMix(i), eyeFrom, eyeTo, eyeMix, false);
+        bad->composePose(cached, getWingMix(i), eyeFrom, eyeTo, eyeMix, true);
+        for (u32 b = 0; b < composed.numItems(); b++) {
+            for (u32 c = 0; c < 4; c++) {
+                Float4 diff = composed[b][c] - cached[b][c];
+                maxDiff = max(maxDiff, max(max(fabsf(diff.x), fabsf(diff.y)),
+                                           max(fabsf(diff.z), fabsf(diff.w))));
+            }
+        }
+    }
+
+    double seconds[2] = {0, 0};
+    for (u32 useCache = 0; useCache < 2; useCache++) {
+        auto startTime = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < numIterations; i++) {
+            bad->composePose(composed, getWingMix(i), i % 4, (i + 1) % 4, 0.5f, useCache != 0);
+        }
+        seconds[useCache] =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    StdOut::text().format("{} bones, {} wing samples\n", bad->birdSkel.numItems(),
+                          BirdAnimData::NumWingSamples);
+    StdOut::text().format("composed: {} microseconds per pose\n", seconds[0] * 1e6 / numIterations);
+    StdOut::text().format("cached:   {} microseconds per pose\n", seconds[1] * 1e6 / numIterations);
+    StdOut::text().format("largest difference: {}\n", maxDiff);
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+//  Main
+//---------------------------------------------------------------------------
+// Runs AutoGame for numSteps steps and reports simulation throughput.
+int runAutoGame(u32 numSteps) {
+    AutoGame game{Random{}.next64()};
+    auto startTime = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < numSteps; i++) {
+        game.step();
+    }
+    u64 totalScore = game.totalScore + game.gs->score;
+    u64 numCollisionQueries = game.numCollisionQueries + game.gs->playfield.index.numQueries;
+    u64 numCollisionTests = game.numCollisionTests + game.gs->playfield.index.numResults;
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    StdOut::text().format("{} steps ({} simulated seconds) in {} seconds\n", numSteps,
+                          numSteps * game.ctx.simulationTimeStep, seconds);
+    StdOut::text().format("{} steps per millisecond\n", numSteps / (seconds * 1000.0));
+    StdOut::text().format("{} games, average score {}\n", game.numGames,
+                          (double) totalScore / game.numGames);
+    StdOut::text().format("{} obstacles tested per collision check on average\n",
+                          (double) numCollisionTests / max(numCollisionQueries, (u64) 1));
+    return 0;
+}
+
+// Returns args[index] as an integer, or defaultValue if it's missing.
+u32 getArg(ArrayView<const StringView> args, u32 index, u32 defaultValue) {
+    return (index < args.numItems) ? args[index].to<u32>(defaultValue) : defaultValue;
+}
+
+// Each mode receives the arguments that follow its name on the command line.
+struct Mode {
+    StringView name;
+    int (*run)(ArrayView<const StringView> args);
+};
+
+const Mode Modes[] = {
+    {"replay",
+     [](ArrayView<const StringView> args) {
+         if (args.numItems < 1) {
+             StdErr::text() << "Error: Expected a recording path\n";
+             return 1;
+         }
+         return runReplay(args[0], getArg(args, 1, 200));
+     }},
+    {"birds",
+     [](ArrayView<const StringView> args) {
+         return runBirdBenchmark(getArg(args, 0, 10000), getArg(args, 1, 10000));
+     }},
+    {"pipes",
+     [](ArrayView<const StringView> args) { return runPipeBenchmark(getArg(args, 0, 100000)); }},
+    {"snapshot",
+     [](ArrayView<const StringView> args) {
+         return runSnapshotBenchmark(getArg(args, 0, 100000));
+     }},
+    {"swept",
+     [](ArrayView<const StringView> args) {
+         return runSweptCollisionTest(getArg(args, 0, 10000));
+     }},
+    {"collide",
+     [](ArrayView<const StringView> args) {
+         return runCollisionBenchmark(getArg(args, 0, 1000000));
+     }},
+    {"pose",
+     [](ArrayView<const StringView> args) { return runPoseBenchmark(getArg(args, 0, 1000000)); }},
+    {"batch",
+     [](ArrayView<const StringView> args) {
+         u32 maxThreads = max(std::thread::hardware_concurrency(), 1u);
+         runBatchBenchmark(getArg(args, 0, 1000), getArg(args, 1, 10000),
+                           getArg(args, 2, maxThreads));
+         return 0;
+     }},
+};
+
+int main(int argc, char* argv[]) {
+    // Load only the data needed by the simulation
+    Owned<SimAssets> simAssets = SimAssets::load(NativePath::join(FLAPGAME_REPO_FOLDER, "data"));
+    SimAssets::instance = simAssets;
+
+    Array<StringView> args;
+    for (int i = 1; i < argc; i++) {
+        args.append(argv[i]);
+    }
+
+    // The first argument selects a mode. Without one, AutoGame runs for the given number of steps.
+    const Mode* mode = nullptr;
+    if (args.numItems() > 0) {
+        for (const Mode& m : Modes) {
+            if (args[0] == m.name) {
+                mode = &m;
+                break;
+            }
+        }
+    }
+    int result;
+    if (mode) {
+        result = mode->run(args.view().subView(1));
+    } else {
+        result = runAutoGame(getArg(args.view(), 0, 1000000));
+    }
+
+    SimAssets::instance = nullptr;
+    return result;
+}
@@ -0,0 +1,9 @@
+#include <ply-build-repo/Module.h>
+
+// [ply module="headlessFlap"]
+void module_headlessFlap(ModuleArgs* args) {
+    args->buildTarget->targetType = BuildTargetType::EXE;
+    args->addSourceFiles(".", false);
+    args->addIncludeDir(Visibility::Private, ".");
+    args->addTarget(Visibility::Private, "flapSim");
+}